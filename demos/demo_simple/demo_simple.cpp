@@ -171,6 +171,7 @@ void april_init(const harray<hstr>& args)
 	textureRect.y = -textureRect.h / 2;
 	// demonstrating some of the image manipulation methods
 	manualTexture = april::rendersys->createTexture((int)drawRect.w, (int)drawRect.h, april::Color::Clear, april::Image::FORMAT_RGBA, april::Texture::TYPE_MANAGED);
+	manualTexture->setDeferredUpload(true);
 	manualTexture->write(0, 0, texture->getWidth(), texture->getHeight(), 0, 0, texture);
 	manualTexture->invert(0, 0, 256, 128);
 	manualTexture->saturate(0, 128, 128, 128, 0.0f);
@@ -23,6 +23,11 @@
 #include "aprilExport.h"
 #include "Color.h"
 
+/// @brief Number of colors in the palette of FORMAT_PALETTE data, always the full range of a byte so any index is valid.
+#define APRIL_PALETTE_SIZE 256
+
+class hthread;
+
 namespace april
 {
 	class Color;
@@ -31,6 +36,7 @@ namespace april
 	{
 	public:
 		/// @note Some formats are intended to improve speed with the underlying engine if really needed. *X* formats are always 4 BPP even if that byte is not used.
+		/// *_PREMULTIPLIED formats store color channels already multiplied by alpha, pixel accessors still take and return straight colors.
 		enum Format
 		{
 			FORMAT_INVALID,
@@ -46,32 +52,148 @@ namespace april
 			FORMAT_BGR,
 			FORMAT_ALPHA,
 			FORMAT_GRAYSCALE,
-			FORMAT_PALETTE
+			/// @brief 1 byte per pixel indexing the colors in palette.
+			FORMAT_PALETTE,
+			FORMAT_RGBA_PREMULTIPLIED,
+			FORMAT_BGRA_PREMULTIPLIED,
+			/// @brief Block compressed data for the GPU, internalFormat holds the compression and compressedSize the data size.
+			FORMAT_COMPRESSED,
+			/// @brief 16 bits per pixel with red in the highest bits. Pixels are stored in the CPU's byte order like the GPU expects them.
+			FORMAT_RGB565,
+			/// @brief 16 bits per pixel with red in the highest bits and alpha in the lowest.
+			FORMAT_RGBA4444,
+			/// @brief 16 bits per pixel with red in the highest bits and a single alpha bit in the lowest.
+			FORMAT_RGBA5551
+		};
+
+		/// @brief Block compressions that can be loaded from KTX, DDS and PVR files.
+		/// @note The values are the OpenGL internal formats so they can be passed to the GPU directly.
+		enum Compression
+		{
+			COMPRESSION_BC1_RGB = 0x83F0,
+			COMPRESSION_BC1_RGBA = 0x83F1,
+			COMPRESSION_BC2 = 0x83F2,
+			COMPRESSION_BC3 = 0x83F3,
+			COMPRESSION_ETC1 = 0x8D64,
+			COMPRESSION_ETC2_RGB = 0x9274,
+			COMPRESSION_ETC2_RGB_A1 = 0x9276,
+			COMPRESSION_ETC2_RGBA = 0x9278,
+			/// @note PVRTC can only be used by GPUs that support it, there is no software decoder.
+			COMPRESSION_PVRTC_RGB_4BPP = 0x8C00,
+			COMPRESSION_PVRTC_RGB_2BPP = 0x8C01,
+			COMPRESSION_PVRTC_RGBA_4BPP = 0x8C02,
+			COMPRESSION_PVRTC_RGBA_2BPP = 0x8C03
+		};
+
+		/// @brief Resampling filter used when stretching image data.
+		/// @note Except for nearest, filters are widened when shrinking so every source pixel contributes.
+		enum Filter
+		{
+			/// @brief Uses the closest source pixel, fastest but blocky.
+			FILTER_NEAREST = 1,
+			/// @brief Linear interpolation between neighboring pixels.
+			FILTER_LINEAR = 2,
+			/// @brief Averages all covered pixels, best suited for shrinking by large factors.
+			FILTER_BOX = 3,
+			/// @brief Windowed sinc with 3 lobes, the sharpest result at the highest cost.
+			FILTER_LANCZOS3 = 4
+		};
+
+		/// @brief How colors are reduced when converting to the 16 bit formats.
+		enum Dither
+		{
+			/// @brief Rounds every pixel to the closest value, smooth gradients show bands.
+			DITHER_NONE,
+			/// @brief Adds a fixed 4x4 pattern, cheap and it can be split across threads.
+			DITHER_ORDERED,
+			/// @brief Floyd-Steinberg, spreads the rounding error to the following pixels. Looks best, but it's always done on one thread.
+			DITHER_ERROR_DIFFUSION
+		};
+
+		/// @brief Describes pixel data without owning it.
+		/// @note Rows don't have to be tightly packed so a view can describe a sub-rectangle of a larger buffer or a padded buffer (e.g. a locked GPU surface).
+		struct aprilExport View
+		{
+		public:
+			unsigned char* data;
+			int w;
+			int h;
+			/// @brief Distance in bytes between the beginnings of two consecutive rows.
+			int pitch;
+			Format format;
+			/// @brief Colors of FORMAT_PALETTE data, APRIL_PALETTE_SIZE entries in RGBA. Not owned by the view either.
+			unsigned char* palette;
+
+			View();
+			View(unsigned char* data, int w, int h, Format format);
+			View(unsigned char* data, int w, int h, int pitch, Format format);
+			~View();
+
+			int getBpp() const;
+			/// @return True if there is no padding between rows.
+			bool isContiguous() const;
+			unsigned char* getPixelData(int x, int y) const;
+			/// @note The rectangle is not clipped.
+			View getSubView(int x, int y, int w, int h) const;
+
+		};
+
+		/// @brief Image properties that can be read from the file header without decoding any pixels.
+		struct aprilExport Info
+		{
+		public:
+			int w;
+			int h;
+			/// @brief Number of channels stored in the file, palette images have 1.
+			int channels;
+			/// @brief Bits per channel stored in the file.
+			int bitDepth;
+			/// @brief Format the image is loaded in if no format is requested.
+			Format format;
+
+			Info();
+			~Info();
+
 		};
 
 		unsigned char* data;
 		int w;
 		int h;
 		Format format;
+		/// @brief Colors of FORMAT_PALETTE images, APRIL_PALETTE_SIZE entries in RGBA. NULL for all other formats.
+		unsigned char* palette;
 		int internalFormat; // needed for special platform dependent formats, usually used internally only
 		int compressedSize;
+		/// @brief Number of mipmap levels in compressed data, they are stored one after another starting with the full size.
+		int mipmapLevels;
 
 		~Image();
 		
 		int getBpp();
 		int getByteSize();
 		bool isValid();
+		View getView();
+		/// @note The rectangle is clipped to the image, an empty view is returned if nothing is left.
+		View getView(int x, int y, int w, int h);
 
 		bool clear();
 		Color getPixel(int x, int y);
 		bool setPixel(int x, int y, Color color);
 		Color getInterpolatedPixel(float x, float y);
+		/// @param[out] output Has to be able to hold w * h colors, they are stored row by row.
+		bool getPixels(int x, int y, int w, int h, Color* output);
+		/// @param[in] colors Has to hold w * h colors, row by row.
+		bool setPixels(int x, int y, int w, int h, Color* colors);
+		/// @note Positions outside of the image are returned as Color::Clear and the return value is false.
+		bool getPixels(gvec2* positions, int count, Color* output);
+		/// @note Positions outside of the image are skipped and the return value is false.
+		bool setPixels(gvec2* positions, int count, Color* colors);
 		bool fillRect(int x, int y, int w, int h, Color color);
 		bool copyPixelData(unsigned char** output, Format format);
 		bool write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
-		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
+		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, Filter filter = FILTER_LINEAR);
 		bool blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
-		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
+		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255, Filter filter = FILTER_LINEAR);
 		bool rotateHue(int x, int y, int w, int h, float degrees);
 		bool saturate(int x, int y, int w, int h, float factor);
 		bool invert(int x, int y, int w, int h);
@@ -81,20 +203,22 @@ namespace april
 		Color getPixel(gvec2 position);
 		bool setPixel(gvec2 position, Color color);
 		Color getInterpolatedPixel(gvec2 position);
+		bool getPixels(grect rect, Color* output);
+		bool setPixels(grect rect, Color* colors);
 		bool fillRect(grect rect, Color color);
 		bool copyPixelData(unsigned char** output);
 		bool write(int sx, int sy, int sw, int sh, int dx, int dy, Image* other);
 		bool write(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
 		bool write(grect srcRect, gvec2 destPosition, Image* other);
-		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other);
-		bool writeStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
-		bool writeStretch(grect srcRect, grect destRect, Image* other);
+		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other, Filter filter = FILTER_LINEAR);
+		bool writeStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, Filter filter = FILTER_LINEAR);
+		bool writeStretch(grect srcRect, grect destRect, Image* other, Filter filter = FILTER_LINEAR);
 		bool blit(int sx, int sy, int sw, int sh, int dx, int dy, Image* other, unsigned char alpha = 255);
 		bool blit(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
 		bool blit(grect srcRect, gvec2 destPosition, Image* other, unsigned char alpha = 255);
-		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other, unsigned char alpha = 255);
-		bool blitStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
-		bool blitStretch(grect srcRect, grect destRect, Image* other, unsigned char alpha = 255);
+		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other, unsigned char alpha = 255, Filter filter = FILTER_LINEAR);
+		bool blitStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255, Filter filter = FILTER_LINEAR);
+		bool blitStretch(grect srcRect, grect destRect, Image* other, unsigned char alpha = 255, Filter filter = FILTER_LINEAR);
 		bool rotateHue(grect rect, float degrees);
 		bool saturate(grect rect, float factor);
 		bool invert(grect rect);
@@ -102,29 +226,106 @@ namespace april
 
 		static Image* createFromResource(chstr filename);
 		static Image* createFromResource(chstr filename, Format format);
+		/// @param[in] downscale Divides the image size while decoding, can be 1, 2, 4 or 8. Odd sizes are rounded up.
+		/// @note The full size image is never created so this lowers both time and peak memory. Compressed formats ignore it.
+		static Image* createFromResource(chstr filename, Format format, int downscale);
 		static Image* createFromFile(chstr filename);
 		static Image* createFromFile(chstr filename, Format format);
+		/// @param[in] downscale Divides the image size while decoding, can be 1, 2, 4 or 8. Odd sizes are rounded up.
+		static Image* createFromFile(chstr filename, Format format, int downscale);
+		/// @brief Reads only the header of an image, much faster than loading it just to find out its size.
+		/// @return False if the file doesn't exist, isn't supported or the header is damaged.
+		static bool probeResource(chstr filename, Info& info);
+		static bool probeFile(chstr filename, Info& info);
+		/// @brief Decodes an image a few rows at a time so images that don't fit into memory can still be processed.
+		/// @param[in] bandHeight Number of rows passed to the callback at once, the last band can have less.
+		/// @param[in] callback Receives every band and the row it starts at, returning false stops decoding.
+		/// @note PNG and JPEG files are decoded row by row. Interlaced PNG files and other file types are decoded completely first.
+		static bool readBandsFromResource(chstr filename, Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args);
+		static bool readBandsFromFile(chstr filename, Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args);
 		static Image* create(int w, int h, unsigned char* data, Format format);
 		static Image* create(int w, int h, Color color, Format format);
 		static Image* create(Image* other);
 
 		static int getFormatBpp(Format format);
+		/// @return Size of the compressed data or 0 if the compression isn't supported.
+		static int getCompressedSize(int w, int h, int compression);
+		/// @return Size of the compressed data of all mipmap levels together.
+		static int getCompressedSize(int w, int h, int compression, int mipmapLevels);
+		/// @return True if decompress() can decode data with this compression.
+		static bool isDecompressionSupported(int compression);
+		/// @return Number of mipmap levels down to 1x1, including the full size.
+		static int getMipmapCount(int w, int h);
+		static bool isPremultipliedFormat(Format format);
+		/// @brief Sets how many threads big operations can use, 1 (default) keeps everything on the calling thread.
+		/// @note Used by rotateHue(), saturate(), invert(), insertAlphaMap(), fillRect() and convertToFormat(). The area is split into row bands and the calling thread processes bands as well.
+		static void setThreadCount(int value);
+		static int getThreadCount();
+		/// @brief Sets the number of pixels an operation needs before it is split across threads.
+		static void setParallelMinPixels(int value);
+		static int getParallelMinPixels();
+		/// @brief Stops the worker threads, they are started again by the next operation that is split across threads.
+		/// @note Called by april::destroy().
+		static void destroyThreads();
+		/// @brief Enables the disk cache of decoded PNG, JPEG and JPT images, off by default.
+		/// @note Cached images are loaded without decoding as long as the source file doesn't change. Each combination of file, format and downscale is cached separately.
+		static void setCacheEnabled(bool value);
+		static bool isCacheEnabled();
+		/// @brief Sets the directory of the cache, by default it's a subdirectory of getUserDataPath().
+		static void setCachePath(chstr value);
+		static hstr getCachePath();
+		/// @brief Sets the dithering used when converting to FORMAT_RGB565, FORMAT_RGBA4444 or FORMAT_RGBA5551, DITHER_NONE by default.
+		static void setDither(Dither value);
+		static Dither getDither();
 
 		static Color getPixel(int x, int y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat);
 		static bool setPixel(int x, int y, Color color, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
 		static Color getInterpolatedPixel(float x, float y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat);
+		static bool getPixels(int x, int y, int w, int h, Color* output, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat);
+		static bool setPixels(int x, int y, int w, int h, Color* colors, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
+		static bool getPixels(gvec2* positions, int count, Color* output, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat);
+		static bool setPixels(gvec2* positions, int count, Color* colors, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
 		static bool fillRect(int x, int y, int w, int h, Color color, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
 		static bool write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
-		static bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
+		static bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, Filter filter = FILTER_LINEAR);
 		static bool blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha = 255);
-		static bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha = 255);
+		static bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha = 255, Filter filter = FILTER_LINEAR);
 		static bool rotateHue(int x, int y, int w, int h, float degrees, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
 		static bool saturate(int x, int y, int w, int h, float factor, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
 		static bool invert(int x, int y, int w, int h, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
 		static bool insertAlphaMap(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char* destData, Format destFormat, unsigned char median, int ambiguity);
 
+		static Color getPixel(int x, int y, const View& src);
+		static bool setPixel(int x, int y, Color color, const View& dest);
+		static Color getInterpolatedPixel(float x, float y, const View& src);
+		static bool getPixels(int x, int y, int w, int h, Color* output, const View& src);
+		static bool setPixels(int x, int y, int w, int h, Color* colors, const View& dest);
+		static bool getPixels(gvec2* positions, int count, Color* output, const View& src);
+		static bool setPixels(gvec2* positions, int count, Color* colors, const View& dest);
+		static bool fillRect(int x, int y, int w, int h, Color color, const View& dest);
+		static bool write(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest);
+		static bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, Filter filter = FILTER_LINEAR);
+		static bool blit(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha = 255);
+		static bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, unsigned char alpha = 255, Filter filter = FILTER_LINEAR);
+		static bool rotateHue(int x, int y, int w, int h, float degrees, const View& dest);
+		static bool saturate(int x, int y, int w, int h, float factor, const View& dest);
+		static bool invert(int x, int y, int w, int h, const View& dest);
+		/// @note src must be at least as big as dest.
+		static bool insertAlphaMap(const View& src, const View& dest, unsigned char median, int ambiguity);
+		/// @brief Converts pixel data between two views of the same size.
+		static bool convertToFormat(const View& src, const View& dest);
+		/// @brief Decodes block compressed data in software, used if the GPU doesn't support the compression.
+		/// @param[in] compression One of the Compression values.
+		static bool decompress(int w, int h, unsigned char* srcData, int compression, unsigned char** destData, Format destFormat);
+		/// @brief Creates the next mipmap level by averaging 2x2 pixel blocks, the result is half the size (at least 1) in the same format.
+		/// @note Colors with straight alpha are weighted by their alpha so transparent pixels don't darken the edges of visible areas.
+		/// @param[in] gammaCorrect Averages the color channels in linear space which keeps bright details from darkening, but it's slower.
+		static bool createMipmap(const View& src, unsigned char** destData, bool gammaCorrect = false);
+
 		/// @param[in] preventCopy If true, will make a copy even if source and destination formats are the same.
 		static bool convertToFormat(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat, bool preventCopy = true);
+		/// @brief Same as above, but keeps the palette of the source.
+		static bool convertToFormat(const View& src, unsigned char** destData, Format destFormat, bool preventCopy = true);
 		/// @brief Checks if an image format conversion is needed.
 		/// @param[in] preventCopy If true, will return false if source and destination formats are the same.
 		/// @note Helps to determine whether there is a need to convert an image format into another. It can be helpful to avoid conversion from e.g. RGBA to RGBX if the GPU ignores the X anyway.
@@ -142,21 +343,88 @@ namespace april
 	protected:
 		Image();
 
-		static Image* _loadPng(hsbase& stream, int size);
-		static Image* _loadPng(hsbase& stream);
-		static Image* _loadJpg(hsbase& stream, int size);
-		static Image* _loadJpg(hsbase& stream);
-		static Image* _loadJpt(hsbase& stream);
+		/// @param[in] format Layout to decode into if the decoder can produce it directly, FORMAT_INVALID keeps the file's own layout.
+		/// @note The result can still have a different format if the decoder can't produce the requested one.
+		static Image* _loadPng(hsbase& stream, int size, Format format = FORMAT_INVALID, int downscale = 1);
+		static Image* _loadPng(hsbase& stream, Format format = FORMAT_INVALID, int downscale = 1);
+		static Image* _loadPng(unsigned char* compressedData, int size, Format format, int downscale);
+		/// @note Reads from stream if it's not NULL, otherwise directly from compressedData.
+		static Image* _loadPng(hsbase* stream, unsigned char* compressedData, int size, Format format, int downscale);
+		static Image* _loadJpg(hsbase& stream, int size, Format format = FORMAT_INVALID, int downscale = 1);
+		static Image* _loadJpg(hsbase& stream, Format format = FORMAT_INVALID, int downscale = 1);
+		static Image* _loadJpg(unsigned char* compressedData, int size, Format format, int downscale);
+		static Image* _loadJpt(hsbase& stream, Format format = FORMAT_INVALID, int downscale = 1);
+		static Image* _loadJpt(unsigned char* data, int size, Format format, int downscale);
+		/// @note Reads from stream if it's not NULL, otherwise directly from data.
+		static Image* _loadJpt(hsbase* stream, unsigned char* data, int size, Format format, int downscale);
+		static void _loadJptColor(hthread* thread);
+		static bool _readPngBands(hsbase& stream, Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args);
+		static bool _readJpgBands(hsbase& stream, Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args);
+		/// @brief Passes an already decoded image on in bands and deletes it.
+		static bool _readBands(Image* image, int bandHeight, bool (*callback)(const View&, int, void*), void* args);
+		/// @brief Converts a band into the requested format if necessary and passes it to the callback.
+		/// @param[in,out] convertedData Buffer for the converted rows, it's created on first use and reused for the following bands.
+		static bool _passBand(const View& band, int y, Format format, unsigned char** convertedData, bool (*callback)(const View&, int, void*), void* args);
+		/// @brief Decompresses or converts a freshly loaded image into the requested format.
+		static Image* _finishLoading(Image* image, Format format);
+		/// @return True if the cache is enabled and the file type is worth caching.
+		static bool _isCacheable(chstr filename);
+		/// @brief Loads the image from the cache if the cached data is still valid, otherwise decodes it and stores it in the cache.
+		static Image* _loadCached(chstr filename, bool fromResource, Format format, int downscale);
+		static bool _probePng(hsbase& stream, Info& info);
+		static bool _probeJpg(hsbase& stream, Info& info);
+		static bool _probeJpt(hsbase& stream, Info& info);
+		static Image* _loadKtx(hsbase& stream);
+		static bool _probeKtx(hsbase& stream, Info& info);
+		static Image* _loadDds(hsbase& stream);
+		static bool _probeDds(hsbase& stream, Info& info);
 
 		static void _getFormatIndices(Format format, int* red, int* green, int* blue, int* alpha);
 
-		static bool _convertFrom1Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat);
-		static bool _convertFrom3Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat);
-		static bool _convertFrom4Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat);
+		static bool _convertFrom1Bpp(const View& src, const View& dest);
+		static bool _convertFrom3Bpp(const View& src, const View& dest);
+		static bool _convertFrom4Bpp(const View& src, const View& dest);
+		/// @brief Converts using SIMD instructions if the CPU supports them.
+		/// @return False if there is no SIMD implementation for this conversion on this CPU and the regular path has to be used.
+		static bool _convertSimd(const View& src, const View& dest);
+		/// @brief Separable fixed-point resampling, both views need the same BPP and the rectangles have to be valid.
+		static bool _resample(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, Filter filter);
+		/// @brief Resamples and blends one row at a time, without a stretched copy of the whole source.
+		static bool _resampleBlit(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, Filter filter, unsigned char alpha);
+
+		static bool _blitFrom1Bpp(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha);
+		static bool _blitFrom3Bpp(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha);
+		static bool _blitFrom4Bpp(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha);
+		/// @brief Blends 4 BPP onto 4 BPP using SIMD instructions if the CPU supports them, the rectangles have to be valid.
+		/// @return Number of columns that were blended, the remaining columns have to be done by the regular path.
+		static int _blitSimd(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha);
+		/// @brief Blends a premultiplied 4 BPP source, the rectangles have to be valid.
+		static bool _blitFromPremultiplied(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha);
+
+		/// @brief Splits dest (and src if it has data) into row bands and runs function on them, in parallel if enabled and the area is big enough.
+		/// @note function gets src and dest views of the same rows and can be called from several threads at once.
+		static bool _runParallel(bool (*function)(const View&, const View&, void*), const View& src, const View& dest, void* args);
+		static bool _rotateHueBand(const View& src, const View& dest, void* args);
+		static bool _saturateBand(const View& src, const View& dest, void* args);
+		static bool _invertBand(const View& src, const View& dest, void* args);
+		static bool _insertAlphaMapBand(const View& src, const View& dest, void* args);
+		static bool _fillRectBand(const View& src, const View& dest, void* args);
+		static bool _convertBand(const View& src, const View& dest, void* args);
 
-		static bool _blitFrom1Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha);
-		static bool _blitFrom3Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha);
-		static bool _blitFrom4Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha);
+		/// @brief Converts from or to premultiplied formats through their straight counterparts.
+		static bool _convertPremultiplied(const View& src, const View& dest);
+		/// @brief Expands palette indices to colors or copies indices between two views that use the same palette.
+		static bool _convertPalette(const View& src, const View& dest);
+		/// @brief Converts from or to the 16 bit formats, anything else goes through RGBA rows.
+		static bool _convertPacked(const View& src, const View& dest);
+		static bool _convertPackedBand(const View& src, const View& dest, void* args);
+		/// @brief Multiplies the color channels of a 4 BPP view with alpha in place.
+		static void _premultiplyAlpha(const View& view);
+		/// @brief Divides the color channels of a 4 BPP view by alpha in place.
+		static void _unpremultiplyAlpha(const View& view);
+		/// @brief Premultiplies using SIMD instructions if the CPU supports them.
+		/// @return Number of columns that were processed, the remaining columns have to be done by the regular path.
+		static int _premultiplySimd(const View& view);
 
 	};
 	
@@ -32,6 +32,8 @@ namespace april
 		RamTexture(int w, int h);
 		~RamTexture();
 		bool load();
+		/// @note Loads right away, the image is only kept in RAM anyway.
+		bool loadAsync();
 		void unload();
 
 		bool isLoaded();
@@ -53,7 +55,8 @@ namespace april
 		void _assignFormat();
 		Lock _tryLockSystem(int x, int y, int w, int h);
 		bool _unlockSystem(Lock& lock, bool update);
-		bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
+		bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src);
+		int _getGpuByteSize();
 		
 	};
 
@@ -37,6 +37,8 @@ namespace april
 	class PixelShader;
 	class RamTexture;
 	class Texture;
+	class TextureAtlas;
+	class TiledTexture;
 	class VertexShader;
 	class Window;
 
@@ -44,6 +46,7 @@ namespace april
 	{
 	public:
 		friend class Texture;
+		friend class TiledTexture;
 		friend class Window;
 
 		struct aprilExport DisplayMode
@@ -86,6 +89,23 @@ namespace april
 		HL_DEFINE_GET(hstr, name, Name);
 		HL_DEFINE_GET(Options, options, Options);
 		HL_DEFINE_GET(harray<Texture*>, textures, Textures);
+		HL_DEFINE_GET(harray<TiledTexture*>, tiledTextures, TiledTextures);
+		/// @brief Bytes of asynchronously loaded textures that are uploaded per frame, 4 MB by default.
+		HL_DEFINE_GETSET(int, asyncUploadBytes, AsyncUploadBytes);
+		/// @brief Milliseconds per frame spent on uploading asynchronously loaded textures, 4 by default.
+		/// @note At least one texture is uploaded every frame so large textures can't get stuck.
+		HL_DEFINE_GETSET(float, asyncUploadTime, AsyncUploadTime);
+		/// @brief Set instead of textures that are still being loaded asynchronously, NULL draws them without a texture.
+		HL_DEFINE_GETSET(Texture*, asyncPlaceholder, AsyncPlaceholder);
+		/// @brief GPU memory in bytes that textures can use before the least recently used immutable ones are unloaded, 0 (default) means no limit.
+		/// @note Unloaded textures are loaded again the next time they are used.
+		HL_DEFINE_GETSET(int, textureMemoryBudget, TextureMemoryBudget);
+		/// @brief GPU memory in bytes that textures are reduced to on a low memory warning if there is a texture memory budget, 0 by default.
+		HL_DEFINE_GETSET(int, lowMemoryTextureBudget, LowMemoryTextureBudget);
+		/// @brief Textures unloaded because of the texture memory budget are loaded asynchronously, false by default.
+		HL_DEFINE_ISSET(asyncTextureReload, AsyncTextureReload);
+		/// @brief Number of frames presented so far.
+		HL_DEFINE_GET(int, frameIndex, FrameIndex);
 		HL_DEFINE_GET(grect, viewport, Viewport);
 		HL_DEFINE_GET(gmat4, modelviewMatrix, ModelviewMatrix);
 		void setModelviewMatrix(gmat4 matrix);
@@ -118,9 +138,22 @@ namespace april
 		Texture* createTextureFromFile(chstr filename, Texture::Type type = Texture::TYPE_IMMUTABLE, bool loadImmediately = true);
 		/// @note When a format is forced, it's best to use managed (but not necessary).
 		Texture* createTextureFromFile(chstr filename, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED, bool loadImmediately = true);
+		Texture* createTextureFromResource(chstr filename, Texture::Type type, Texture::LoadMode loadMode);
+		Texture* createTextureFromResource(chstr filename, Image::Format format, Texture::Type type, Texture::LoadMode loadMode);
+		Texture* createTextureFromFile(chstr filename, Texture::Type type, Texture::LoadMode loadMode);
+		Texture* createTextureFromFile(chstr filename, Image::Format format, Texture::Type type, Texture::LoadMode loadMode);
 		Texture* createTexture(int w, int h, unsigned char* data, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED);
 		Texture* createTexture(int w, int h, Color color, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED);
 		Texture* createRamTexture(chstr filename, bool loadImmediately = true); // TODOaa - will be removed in a future version
+		/// @brief Creates a texture split into tiles, for images larger than the maximum texture size.
+		/// @param[in] tileSize Maximum size of a tile, 0 uses the maximum texture size.
+		TiledTexture* createTiledTextureFromResource(chstr filename, Image::Format format = Image::FORMAT_INVALID, int tileSize = 0, bool loadImmediately = true);
+		/// @brief Creates a texture split into tiles, for images larger than the maximum texture size.
+		/// @param[in] tileSize Maximum size of a tile, 0 uses the maximum texture size.
+		TiledTexture* createTiledTextureFromFile(chstr filename, Image::Format format = Image::FORMAT_INVALID, int tileSize = 0, bool loadImmediately = true);
+		/// @brief Creates an empty atlas that images can be packed into at any time, its texture is managed so it survives unloading.
+		/// @param[in] size Width and height of the atlas texture.
+		TextureAtlas* createTextureAtlas(int size, Image::Format format = Image::FORMAT_RGBA);
 		virtual PixelShader* createPixelShader() = 0;
 		virtual PixelShader* createPixelShader(chstr filename) = 0;
 		virtual VertexShader* createVertexShader() = 0;
@@ -147,12 +180,28 @@ namespace april
 		void drawFilledRect(grect rect, Color color);
 		void drawTexturedRect(grect rect, grect src);
 		void drawTexturedRect(grect rect, grect src, Color color);
+		/// @brief Draws only the tiles that are inside of src, src covers the whole image with 0 to 1 like with a normal texture.
+		/// @note Changes the current texture.
+		void drawTexturedRect(grect rect, grect src, TiledTexture* texture);
+		/// @brief Draws only the tiles that are inside of src, src covers the whole image with 0 to 1 like with a normal texture.
+		/// @note Changes the current texture.
+		void drawTexturedRect(grect rect, grect src, TiledTexture* texture, Color color);
 
 		hstr findTextureResource(chstr filename);
 		hstr findTextureFile(chstr filename);
 		void unloadTextures();
+		/// @return GPU memory in bytes used by all loaded textures, estimated from their size and format.
+		int getTextureMemoryUsage();
+		/// @brief Unloads least recently used immutable textures until the textures use at most maxBytes.
+		/// @note Textures used in the current frame and the async placeholder are never unloaded.
+		/// @return GPU memory in bytes used by textures afterwards.
+		int trimTextureMemory(int maxBytes);
 		virtual Image::Format getNativeTextureFormat(Image::Format format) = 0;
+		/// @brief Checks if compressed image data can be used by the GPU directly, otherwise it's decompressed in software.
+		/// @param[in] compression The internalFormat of an Image with FORMAT_COMPRESSED.
+		virtual bool isCompressionSupported(int compression);
 		virtual Image* takeScreenshot(Image::Format format) = 0;
+		/// @note Asynchronously loaded textures are uploaded and the texture memory budget is applied here, after the frame was presented.
 		virtual void presentFrame();
 
 		DEPRECATED_ATTRIBUTE hstr findTextureFilename(chstr filename) { return this->findTextureResource(filename); }
@@ -164,6 +213,16 @@ namespace april
 		bool created;
 		Options options;
 		harray<Texture*> textures;
+		harray<TiledTexture*> tiledTextures;
+		/// @brief Textures with deferred changes that are uploaded at the end of the frame.
+		harray<Texture*> dirtyTextures;
+		int asyncUploadBytes;
+		float asyncUploadTime;
+		Texture* asyncPlaceholder;
+		int textureMemoryBudget;
+		int lowMemoryTextureBudget;
+		bool asyncTextureReload;
+		int frameIndex;
 		grect viewport;
 		RenderState* state;
 		Texture::Filter textureFilter;
@@ -176,6 +235,14 @@ namespace april
 
 		void _registerTexture(Texture* texture);
 		void _unregisterTexture(Texture* texture);
+		bool _loadTexture(Texture* texture, Texture::LoadMode loadMode);
+		/// @brief Marks the texture as used in this frame and starts loading it again if it was unloaded because of the texture memory budget.
+		/// @return The placeholder if the texture is still being loaded asynchronously and a placeholder is set.
+		Texture* _getDrawnTexture(Texture* texture);
+		/// @brief Uploads deferred changes and asynchronously loaded textures and applies the texture memory budget, has to be called after a frame was presented.
+		void _finishFrame();
+
+		static bool _compareLastUse(Texture* a, Texture* b);
 
 		virtual void _setModelviewMatrix(const gmat4& matrix) = 0;
 		virtual void _setProjectionMatrix(const gmat4& matrix) = 0;
@@ -184,6 +251,8 @@ namespace april
 
 		unsigned int _numPrimitives(RenderOperation renderOperation, int nVertices);
 		unsigned int _limitPrimitives(RenderOperation renderOperation, int nVertices);
+		TiledTexture* _createTiledTexture(chstr filename, bool fromResource, Image::Format format, int tileSize, bool loadImmediately);
+		void _drawTiledTexturedRect(grect rect, grect src, TiledTexture* texture, Color* color);
 
 	};
 
@@ -28,6 +28,7 @@
 namespace april
 {
 	class Image;
+	struct AsyncTextureRequest;
 	
 	class aprilExport Texture
 	{
@@ -48,6 +49,10 @@ namespace april
 		{
 			FILTER_NEAREST = 1,
 			FILTER_LINEAR = 2,
+			/// @brief Trilinear filtering between mipmap levels.
+			/// @note Mipmaps are created when the texture is loaded with a mipmap filter, until then the texture is filtered as if it didn't use mipmaps.
+			FILTER_LINEAR_MIPMAP_LINEAR = 3,
+			FILTER_NEAREST_MIPMAP_NEAREST = 4,
 			FILTER_UNDEFINED = 0x7FFFFFFF
 		};
 
@@ -58,25 +63,80 @@ namespace april
 			ADDRESS_UNDEFINED = 0x7FFFFFFF
 		};
 
+		enum LoadMode
+		{
+			/// @brief Loaded the first time the texture is used.
+			LOAD_ON_DEMAND = 0,
+			/// @brief Loaded right away when the texture is created.
+			LOAD_IMMEDIATE = 1,
+			/// @brief Decoded on a background thread and uploaded by RenderSystem::presentFrame() within the upload budget.
+			LOAD_ASYNC = 2
+		};
+
+		enum LoadState
+		{
+			LOAD_STATE_UNLOADED = 0,
+			/// @brief Waiting for a background thread or being decoded on one.
+			LOAD_STATE_DECODING = 1,
+			/// @brief Decoded and waiting for the upload at the end of a frame.
+			LOAD_STATE_UPLOAD_PENDING = 2,
+			LOAD_STATE_LOADED = 3,
+			/// @brief The last asynchronous load failed.
+			LOAD_STATE_FAILED = 4
+		};
+
 		DEPRECATED_ATTRIBUTE static Image::Format FORMAT_ALPHA;
 		DEPRECATED_ATTRIBUTE static Image::Format FORMAT_ARGB;
 
 		Texture(bool fromResource);
 		virtual ~Texture();
+		/// @note Returns false without loading while an asynchronous load is in progress.
 		virtual bool load();
+		/// @brief Decodes the image on a background thread, the texture is uploaded later by RenderSystem::presentFrame().
+		/// @return False if loading failed right away, e.g. if no decoding was needed and the upload failed.
+		/// @note Textures that don't have to be decoded are loaded right away.
+		virtual bool loadAsync();
 		virtual void unload() = 0;
+		LoadState getLoadState();
 
 		HL_DEFINE_GET(hstr, filename, Filename);
 		HL_DEFINE_GET(Image::Format, format, Format);
 		HL_DEFINE_GETSET(Filter, filter, Filter);
 		HL_DEFINE_GETSET(AddressMode, addressMode, AddressMode);
 		HL_DEFINE_IS(fromResource, FromResource);
+		/// @brief Each step halves the size of the image when it's loaded from a file, up to 3 steps (1/8 size).
+		/// @note Affects only the next load. Width and height are those of the reduced image.
+		HL_DEFINE_GETSET(int, lodBias, LodBias);
+		/// @brief Number of mipmap levels on the GPU, 1 if the texture has no mipmaps.
+		HL_DEFINE_GET(int, mipmapLevels, MipmapLevels);
+		/// @brief Averages colors in linear space when creating mipmaps. Slower, but keeps bright details on dark backgrounds from fading.
+		/// @note Affects only the next load.
+		HL_DEFINE_ISSET(gammaCorrectMipmaps, GammaCorrectMipmaps);
+		/// @brief Changes to the RAM copy are uploaded only when the texture is used or the frame ends, merged into as few uploads as possible.
+		/// @note Affects only textures that have a RAM copy, e.g. managed textures. Turning it off uploads the pending changes.
+		HL_DEFINE_IS(deferredUpload, DeferredUpload);
+		void setDeferredUpload(bool value);
+		/// @note If the texture wasn't loaded yet, the size is read from the file header without loading it.
 		int getWidth();
+		/// @note If the texture wasn't loaded yet, the size is read from the file header without loading it.
 		int getHeight();
 		int getBpp();
 		int getByteSize();
 
 		virtual bool isLoaded() = 0;
+		/// @brief Uploads the changes that were deferred and recreates the mipmaps that were changed.
+		/// @note Called automatically before the texture is drawn and at the end of each frame.
+		bool flushUploads();
+
+		/// @brief LOD bias added to that of every texture, e.g. for low-memory devices.
+		static void setGlobalLodBias(int value);
+		static int getGlobalLodBias();
+		/// @brief Number of background threads that decode asynchronously loaded textures, 1 by default.
+		static void setAsyncThreadCount(int value);
+		static int getAsyncThreadCount();
+		/// @brief Cancels all asynchronous loads and stops the threads after the images that are being decoded are finished.
+		/// @note Called by april::destroy().
+		static void destroyAsyncThreads();
 		
 		bool clear();
 		Color getPixel(int x, int y);
@@ -85,29 +145,44 @@ namespace april
 		bool setPixel(gvec2 position, Color color);
 		Color getInterpolatedPixel(float x, float y);
 		Color getInterpolatedPixel(gvec2 position);
+		/// @param[out] output Has to be able to hold w * h colors, they are stored row by row.
+		bool getPixels(int x, int y, int w, int h, Color* output);
+		bool getPixels(grect rect, Color* output);
+		/// @param[in] colors Has to hold w * h colors, row by row.
+		bool setPixels(int x, int y, int w, int h, Color* colors);
+		bool setPixels(grect rect, Color* colors);
+		/// @note Positions outside of the texture are returned as Color::Clear and the return value is false.
+		bool getPixels(gvec2* positions, int count, Color* output);
+		/// @note Positions outside of the texture are skipped and the return value is false.
+		bool setPixels(gvec2* positions, int count, Color* colors);
 		bool fillRect(int x, int y, int w, int h, Color color);
 		bool fillRect(grect rect, Color color);
 		bool copyPixelData(unsigned char** output, Image::Format format);
 		bool copyPixelData(unsigned char** output);
 		bool write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
+		/// @note The source rows don't have to be tightly packed.
+		bool write(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src);
 		bool write(int sx, int sy, int sw, int sh, int dx, int dy, Texture* texture);
 		bool write(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
 		bool write(grect srcRect, gvec2 destPosition, Texture* texture);
 		bool write(int sx, int sy, int sw, int sh, int dx, int dy, Image* image);
 		bool write(grect srcRect, gvec2 destPosition, Image* image);
 		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
+		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const Image::View& src);
 		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Texture* texture);
 		bool writeStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
 		bool writeStretch(grect srcRect, grect destRect, Texture* texture);
 		bool writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* image);
 		bool writeStretch(grect srcRect, grect destRect, Image* image);
 		bool blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
+		bool blit(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src, unsigned char alpha = 255);
 		bool blit(int sx, int sy, int sw, int sh, int dx, int dy, Texture* texture, unsigned char alpha = 255);
 		bool blit(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
 		bool blit(grect srcRect, gvec2 destPosition, Texture* texture, unsigned char alpha = 255);
 		bool blit(int sx, int sy, int sw, int sh, int dx, int dy, Image* image, unsigned char alpha = 255);
 		bool blit(grect srcRect, gvec2 destPosition, Image* image, unsigned char alpha = 255);
 		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
+		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const Image::View& src, unsigned char alpha = 255);
 		bool blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Texture* texture, unsigned char alpha = 255);
 		bool blitStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha = 255);
 		bool blitStretch(grect srcRect, grect destRect, Texture* texture, unsigned char alpha = 255);
@@ -139,6 +214,8 @@ namespace april
 			int dataWidth;
 			int dataHeight;
 			Image::Format format;
+			/// @brief Palette of FORMAT_PALETTE data, owned by the texture.
+			unsigned char* palette;
 			bool locked;
 			bool failed;
 			bool renderTarget;
@@ -149,7 +226,18 @@ namespace april
 			void activateFail();
 			void activateLock(int x, int y, int w, int h, int dx, int dy, unsigned char* data, int dataWidth, int dataHeight, Image::Format format);
 			void activateRenderTarget(int x, int y, int w, int h, int dx, int dy, unsigned char* data, int dataWidth, int dataHeight, Image::Format format);
+			/// @brief All of the locked data, not only the locked area.
+			Image::View getView() const;
+
+		};
 
+		/// @brief Area of the RAM copy that was changed, but not uploaded yet.
+		struct DirtyRect
+		{
+			int x;
+			int y;
+			int w;
+			int h;
 		};
 
 		hstr filename;
@@ -161,7 +249,27 @@ namespace april
 		Filter filter;
 		AddressMode addressMode;
 		unsigned char* data;
+		/// @brief Colors of the RAM copy if it's in FORMAT_PALETTE. The GPU always gets the expanded colors.
+		unsigned char* palette;
 		bool fromResource;
+		int lodBias;
+		/// @brief Width and height were only read from the file header, the texture hasn't been loaded yet.
+		bool sizeProbed;
+		int mipmapLevels;
+		bool gammaCorrectMipmaps;
+		/// @brief Set while the texture is being loaded asynchronously, only used on the thread that renders.
+		AsyncTextureRequest* asyncRequest;
+		bool asyncFailed;
+		/// @brief RenderSystem::getFrameIndex() of the last time the texture was used or loaded.
+		int lastUsedFrame;
+		/// @brief Unloaded because of the texture memory budget, it is loaded again the next time it's used.
+		bool evicted;
+		bool deferredUpload;
+		harray<DirtyRect> dirtyRects;
+		/// @brief The full size level was changed, the smaller levels are recreated when the texture is drawn or the frame ends.
+		bool mipmapsDirty;
+
+		static int globalLodBias;
 
 		virtual bool _create(chstr filename, Type type);
 		virtual bool _create(chstr filename, Image::Format format, Type type);
@@ -172,6 +280,25 @@ namespace april
 		virtual void _assignFormat() = 0;
 
 		hstr _getInternalName();
+		Image::View _getDataView(unsigned char* data);
+		/// @return Estimated GPU memory in bytes used by the texture, 0 if it isn't loaded.
+		virtual int _getGpuByteSize();
+		/// @brief The format the image is decoded to, the native format if no RAM copy is kept.
+		Image::Format _getDecodeFormat();
+		/// @brief Takes over size, format and data of a decoded image and deletes it.
+		/// @return The pixel data that still has to be uploaded.
+		unsigned char* _takeImageData(Image* image, int& size);
+		/// @brief Creates the GPU texture, uploads the data and keeps or deletes it depending on the type.
+		bool _uploadData(unsigned char* currentData, int size);
+		/// @brief Finishes an asynchronous load, image is NULL if decoding failed.
+		bool _finishAsyncLoad(Image* image);
+		void _cancelAsyncLoad();
+		/// @brief Sets width and height from the file header, like they will be after loading.
+		bool _probeSize();
+		/// @return The filter without mipmapping if the texture doesn't have mipmaps, sampling missing levels would make the texture incomplete.
+		Filter _getUsedFilter();
+		/// @brief Creates and uploads all mipmap levels from the full size data if the filter uses them.
+		void _createMipmaps(unsigned char* data, Image::Format format);
 
 		Lock _tryLock(int x, int y, int w, int h);
 		Lock _tryLock();
@@ -179,7 +306,25 @@ namespace april
 		virtual Lock _tryLockSystem(int x, int y, int w, int h) = 0;
 		virtual bool _unlockSystem(Lock& lock, bool update) = 0;
 		bool _uploadDataToGpu(int x, int y, int w, int h);
-		virtual bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat) = 0;
+		/// @brief Merges the area with the pending ones if that doesn't upload too many unchanged pixels.
+		void _addDirtyRect(int x, int y, int w, int h);
+		virtual bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src) = 0;
+		/// @param[in] src Data of the whole level in the native format.
+		/// @return False if the render system doesn't support mipmaps.
+		virtual bool _uploadMipmapToGpu(int level, const Image::View& src);
+
+		/// @brief Decodes an image file, block compressed data is kept as it is.
+		/// @note Safe to call from any thread.
+		static Image* _decodeImage(chstr filename, bool fromResource, Image::Format format, int downscale);
+		/// @brief Decompresses block compressed data that the GPU can't use, the image is deleted if that fails.
+		/// @note Only called on the thread that renders since it asks the render system.
+		/// @return The image or NULL if it couldn't be decompressed.
+		static Image* _decompressUnsupported(Image* image);
+		/// @brief Uploads decoded textures in the order they were finished until the budget is used up, at least one is always uploaded.
+		static void _uploadAsyncLoaded(int maxBytes, float maxTime);
+		static void _asyncWorkerProcess(hthread* thread);
+		/// @brief Starts threads for queued requests, up to the thread count. The caller has to hold the lock of the queues.
+		static void _startAsyncWorkers();
 
 	};
 	
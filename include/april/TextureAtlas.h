@@ -0,0 +1,99 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+///
+/// @section DESCRIPTION
+///
+/// Defines a texture that many small images are packed into so they can be drawn without switching textures.
+
+#ifndef APRIL_TEXTURE_ATLAS_H
+#define APRIL_TEXTURE_ATLAS_H
+
+#include <gtypes/Rectangle.h>
+#include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+#include "aprilExport.h"
+#include "Image.h"
+
+namespace april
+{
+	class Texture;
+
+	class aprilExport TextureAtlas
+	{
+	public:
+		friend class RenderSystem;
+
+		/// @brief Part of the atlas texture that one image was packed into.
+		struct aprilExport Region
+		{
+			hstr name;
+			/// @brief Position and size in pixels, without the padding.
+			int x;
+			int y;
+			int w;
+			int h;
+			/// @brief UVs in the atlas texture, can be used as src in RenderSystem::drawTexturedRect() after setting the atlas texture.
+			/// @note Other UVs of the image are mapped with src.x + u * src.w and src.y + v * src.h.
+			grect src;
+		};
+
+		~TextureAtlas();
+
+		HL_DEFINE_GET(int, size, Size);
+		HL_DEFINE_GET(Texture*, texture, Texture);
+		/// @brief Pixels around each image that are filled with its edge pixels so filtering doesn't pick up the neighbors, 1 by default.
+		/// @note Affects only images that are added afterwards.
+		HL_DEFINE_GETSET(int, padding, Padding);
+		HL_DEFINE_GET(harray<Region*>, regions, Regions);
+		/// @return Fraction of the atlas that is covered by images, including their padding.
+		float getUsage();
+		/// @return NULL if no image with this name was added.
+		Region* getRegion(chstr name);
+
+		/// @brief Packs the image into the atlas and uploads only the part of the texture that it covers.
+		/// @return NULL if the image doesn't fit anymore.
+		Region* add(chstr name, const Image::View& src);
+		Region* add(chstr name, Image* image);
+		/// @note The filename is used as name.
+		Region* addFromResource(chstr filename);
+		/// @note The filename is used as name.
+		Region* addFromFile(chstr filename);
+		/// @brief Removes all images, the regions that were returned can't be used anymore.
+		void clear();
+
+	protected:
+		/// @brief A horizontal segment of the top edge of the packed images, everything below it is used.
+		struct Node
+		{
+			int x;
+			int y;
+			int w;
+		};
+
+		int size;
+		Texture* texture;
+		int padding;
+		harray<Region*> regions;
+		harray<Node> skyline;
+		int usedArea;
+
+		TextureAtlas(int size, Texture* texture);
+
+		/// @brief Finds the lowest position where a rect of this size fits, index is the skyline node it starts at or -1 if it doesn't fit.
+		void _findPosition(int w, int h, int& x, int& y, int& index);
+		/// @brief Raises the skyline over the rect that was placed at the given node.
+		void _addRect(int index, int x, int y, int w, int h);
+
+	};
+
+}
+
+#endif
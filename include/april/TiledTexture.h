@@ -0,0 +1,84 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+///
+/// @section DESCRIPTION
+///
+/// Defines a texture split into tiles for images larger than the maximum texture size.
+
+#ifndef APRIL_TILED_TEXTURE_H
+#define APRIL_TILED_TEXTURE_H
+
+#include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+#include "aprilExport.h"
+#include "Image.h"
+#include "Texture.h"
+
+namespace april
+{
+	class aprilExport TiledTexture
+	{
+	public:
+		friend class RenderSystem;
+
+		~TiledTexture();
+		/// @brief Decodes the image a few rows at a time and uploads them straight into the tiles so the whole image is never in RAM.
+		/// @note The tiles are volatile textures, after RenderSystem::unloadTextures() this has to be called again.
+		bool load();
+		void unload();
+
+		HL_DEFINE_GET(hstr, filename, Filename);
+		HL_DEFINE_GET(Image::Format, format, Format);
+		HL_DEFINE_IS(fromResource, FromResource);
+		/// @brief Maximum width and height of a single tile.
+		HL_DEFINE_GET(int, tileSize, TileSize);
+		HL_DEFINE_GET(int, columns, Columns);
+		HL_DEFINE_GET(int, rows, Rows);
+		HL_DEFINE_GET(harray<Texture*>, tiles, Tiles);
+		HL_DEFINE_GET(Texture::Filter, filter, Filter);
+		void setFilter(Texture::Filter value);
+		/// @note If the texture wasn't loaded yet, the size is read from the file header without loading it.
+		int getWidth();
+		/// @note If the texture wasn't loaded yet, the size is read from the file header without loading it.
+		int getHeight();
+		/// @return NULL if the texture isn't loaded or the tile doesn't exist.
+		Texture* getTile(int column, int row);
+
+		bool isLoaded();
+
+	protected:
+		hstr filename;
+		Image::Format format;
+		bool fromResource;
+		int tileSize;
+		int width;
+		int height;
+		int columns;
+		int rows;
+		/// @brief Width and height of the part of a tile that is drawn, the rest is a border shared with the neighboring tiles.
+		int stepWidth;
+		int stepHeight;
+		Texture::Filter filter;
+		harray<Texture*> tiles;
+
+		TiledTexture(chstr filename, bool fromResource, Image::Format format, int tileSize);
+
+		/// @brief Sets width and height from the file header and calculates the tile layout.
+		bool _probeSize(Image::Info& info);
+		/// @brief Region of the image that a tile contains, including the border.
+		void _getTileRect(int column, int row, int& x, int& y, int& w, int& h);
+		static bool _writeBand(const Image::View& band, int y, void* args);
+
+	};
+
+}
+
+#endif
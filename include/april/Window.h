@@ -208,6 +208,7 @@ namespace april
 		virtual void handleFocusChangeEvent(bool focused);
 		virtual void handleActivityChangeEvent(bool active);
 		virtual void handleVirtualKeyboardChangeEvent(bool visible, float heightRatio);
+		/// @note Reduces the textures to RenderSystem::getLowMemoryTextureBudget() if there is a texture memory budget.
 		virtual void handleLowMemoryWarning();
 
 		void handleKeyOnlyEvent(KeyEventType type, Key keyCode);
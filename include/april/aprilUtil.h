@@ -39,6 +39,7 @@ namespace april
 		BM_ADD = 2,
 		BM_SUBTRACT = 3,
 		BM_OVERWRITE = 4,
+		BM_PREMULTIPLIED = 5,
 		BM_UNDEFINED = 0x7FFFFFFF
 	};
 
@@ -124,6 +124,7 @@ namespace april
 		this->blendStateAdd = nullptr;
 		this->blendStateSubtract = nullptr;
 		this->blendStateOverwrite = nullptr;
+		this->blendStatePremultiplied = nullptr;
 		this->samplerLinearWrap = nullptr;
 		this->samplerLinearClamp = nullptr;
 		this->samplerNearestWrap = nullptr;
@@ -178,6 +179,7 @@ namespace april
 		this->blendStateAdd = nullptr;
 		this->blendStateSubtract = nullptr;
 		this->blendStateOverwrite = nullptr;
+		this->blendStatePremultiplied = nullptr;
 		this->samplerLinearWrap = nullptr;
 		this->samplerLinearClamp = nullptr;
 		this->samplerNearestWrap = nullptr;
@@ -229,6 +231,7 @@ namespace april
 		this->blendStateAdd = nullptr;
 		this->blendStateSubtract = nullptr;
 		this->blendStateOverwrite = nullptr;
+		this->blendStatePremultiplied = nullptr;
 		this->renderTargetView = nullptr;
 		this->rasterState = nullptr;
 #ifndef _WINP8
@@ -538,6 +541,14 @@ namespace april
 		blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
 		blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ZERO;
 		this->d3dDevice->CreateBlendState(&blendDesc, &this->blendStateOverwrite);
+		// premultiplied
+		blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+		blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+		blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		this->d3dDevice->CreateBlendState(&blendDesc, &this->blendStatePremultiplied);
 		// texture samplers
 		D3D11_SAMPLER_DESC samplerDesc;
 		memset(&samplerDesc, 0, sizeof(samplerDesc));
@@ -695,6 +706,7 @@ namespace april
 		case ADD:
 		case SUBTRACT:
 		case OVERWRITE:
+		case BM_PREMULTIPLIED:
 			this->activeTextureBlendMode = textureBlendMode;
 			break;
 		default:
@@ -729,6 +741,13 @@ namespace april
 		case Texture::FILTER_NEAREST:
 			this->textureFilter = textureFilter;
 			break;
+		// the samplers already filter between mipmap levels, but textures are created with a single level
+		case Texture::FILTER_LINEAR_MIPMAP_LINEAR:
+			this->textureFilter = Texture::FILTER_LINEAR;
+			break;
+		case Texture::FILTER_NEAREST_MIPMAP_NEAREST:
+			this->textureFilter = Texture::FILTER_NEAREST;
+			break;
 		default:
 			hlog::warn(april::logTag, "Trying to set unsupported texture filter!");
 			break;
@@ -751,10 +770,10 @@ namespace april
 
 	void DirectX11_RenderSystem::setTexture(Texture* texture)
 	{
-		this->activeTexture = (DirectX11_Texture*)texture;
+		this->activeTexture = (DirectX11_Texture*)this->_getDrawnTexture(texture);
 		if (this->activeTexture != NULL)
 		{
-			Texture::Filter filter = this->activeTexture->getFilter();
+			Texture::Filter filter = this->activeTexture->_getUsedFilter();
 			if (this->textureFilter != filter)
 			{
 				this->setTextureFilter(filter);
@@ -982,6 +1001,9 @@ namespace april
 			case OVERWRITE:
 				this->d3dDeviceContext->OMSetBlendState(this->blendStateOverwrite.Get(), blendFactor, 0xFFFFFFFF);
 				break;
+			case BM_PREMULTIPLIED:
+				this->d3dDeviceContext->OMSetBlendState(this->blendStatePremultiplied.Get(), blendFactor, 0xFFFFFFFF);
+				break;
 			}
 		}
 	}
@@ -1169,6 +1191,7 @@ namespace april
 		this->swapChain->Present(2, 0);
 		// has to use GetAddressOf(), because the parameter is a pointer to an array of render target views
 		this->d3dDeviceContext->OMSetRenderTargets(1, this->renderTargetView.GetAddressOf(), NULL);
+		this->_finishFrame();
 	}
 
 }
@@ -146,6 +146,7 @@ namespace april
 		ComPtr<ID3D11BlendState> blendStateAdd;
 		ComPtr<ID3D11BlendState> blendStateSubtract;
 		ComPtr<ID3D11BlendState> blendStateOverwrite;
+		ComPtr<ID3D11BlendState> blendStatePremultiplied;
 		ComPtr<ID3D11SamplerState> samplerLinearWrap;
 		ComPtr<ID3D11SamplerState> samplerLinearClamp;
 		ComPtr<ID3D11SamplerState> samplerNearestWrap;
@@ -381,6 +381,14 @@ namespace april
 			this->d3dDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_ONE);
 			this->d3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_ZERO);
 			break;
+		case BM_PREMULTIPLIED:
+			this->d3dDevice->SetRenderState(D3DRS_BLENDOPALPHA, D3DBLENDOP_ADD);
+			this->d3dDevice->SetRenderState(D3DRS_SRCBLENDALPHA, D3DBLEND_ONE);
+			this->d3dDevice->SetRenderState(D3DRS_DESTBLENDALPHA, D3DBLEND_INVSRCALPHA);
+			this->d3dDevice->SetRenderState(D3DRS_BLENDOP, D3DBLENDOP_ADD);
+			this->d3dDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_ONE);
+			this->d3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+			break;
 		default:
 			hlog::warn(april::logTag, "Trying to set unsupported texture blend mode!");
 			break;
@@ -434,10 +442,23 @@ namespace april
 		case Texture::FILTER_LINEAR:
 			this->d3dDevice->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
 			this->d3dDevice->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
 			break;
 		case Texture::FILTER_NEAREST:
 			this->d3dDevice->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
 			this->d3dDevice->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+			break;
+		// textures are created with a single level so these only matter once mipmaps are uploaded
+		case Texture::FILTER_LINEAR_MIPMAP_LINEAR:
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_LINEAR);
+			break;
+		case Texture::FILTER_NEAREST_MIPMAP_NEAREST:
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+			this->d3dDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_POINT);
 			break;
 		default:
 			hlog::warn(april::logTag, "Trying to set unsupported texture filter!");
@@ -466,10 +487,10 @@ namespace april
 
 	void DirectX9_RenderSystem::setTexture(Texture* texture)
 	{
-		this->activeTexture = (DirectX9_Texture*)texture;
+		this->activeTexture = (DirectX9_Texture*)this->_getDrawnTexture(texture);
 		if (this->activeTexture != NULL)
 		{
-			Texture::Filter filter = this->activeTexture->getFilter();
+			Texture::Filter filter = this->activeTexture->_getUsedFilter();
 			if (this->textureFilter != filter)
 			{
 				this->setTextureFilter(filter);
@@ -755,7 +776,14 @@ namespace april
 		case Image::FORMAT_ARGB:
 		case Image::FORMAT_BGRA:
 		case Image::FORMAT_ABGR:
+		case Image::FORMAT_PALETTE: // the palette is expanded when uploading
+		// D3D only has these with alpha in the highest bits
+		case Image::FORMAT_RGBA4444:
+		case Image::FORMAT_RGBA5551:
 			return Image::FORMAT_BGRA;
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
+			return Image::FORMAT_BGRA_PREMULTIPLIED;
 		case Image::FORMAT_RGBX:
 		case Image::FORMAT_XRGB:
 		case Image::FORMAT_BGRX:
@@ -767,8 +795,8 @@ namespace april
 			return Image::FORMAT_ALPHA;
 		case Image::FORMAT_GRAYSCALE:
 			return Image::FORMAT_GRAYSCALE;
-		case Image::FORMAT_PALETTE:
-			return Image::FORMAT_PALETTE;
+		case Image::FORMAT_RGB565:
+			return Image::FORMAT_RGB565;
 		}
 		return Image::FORMAT_INVALID;
 	}
@@ -895,6 +923,7 @@ namespace april
 			}
 			this->d3dDevice->BeginScene();
 		}
+		this->_finishFrame();
 	}
 
 }
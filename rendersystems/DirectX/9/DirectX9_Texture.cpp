@@ -69,6 +69,7 @@ namespace april
 		switch (nativeFormat)
 		{
 		case Image::FORMAT_BGRA:
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
 			this->d3dFormat = D3DFMT_A8R8G8B8;
 			break;
 		case Image::FORMAT_BGRX:
@@ -80,8 +81,8 @@ namespace april
 		case Image::FORMAT_GRAYSCALE:
 			this->d3dFormat = D3DFMT_L8;
 			break;
-		case Image::FORMAT_PALETTE: // TODOaa - needs changing, ARGB shouldn't be here
-			this->d3dFormat = D3DFMT_A8R8G8B8;
+		case Image::FORMAT_RGB565:
+			this->d3dFormat = D3DFMT_R5G6B5;
 			break;
 		}
 	}
@@ -237,7 +238,7 @@ namespace april
 		return true;
 	}
 
-	bool DirectX9_Texture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool DirectX9_Texture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src)
 	{
 		this->load();
 		Lock lock = this->_tryLockSystem(dx, dy, sw, sh);
@@ -245,7 +246,7 @@ namespace april
 		{
 			return false;
 		}
-		bool result = Image::write(sx, sy, sw, sh, lock.x, lock.y, srcData, srcWidth, srcHeight, srcFormat, lock.data, lock.dataWidth, lock.dataHeight, lock.format);
+		bool result = Image::write(sx, sy, sw, sh, lock.x, lock.y, src, Image::View(lock.data, lock.dataWidth, lock.dataHeight, lock.format));
 		this->_unlockSystem(lock, true);
 		return result;
 	}
@@ -51,7 +51,7 @@ namespace april
 
 		Lock _tryLockSystem(int x, int y, int w, int h);
 		bool _unlockSystem(Lock& lock, bool update);
-		bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
+		bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src);
 
 	};
 
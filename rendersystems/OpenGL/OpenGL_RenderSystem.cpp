@@ -186,6 +186,22 @@ namespace april
 		this->setMatrixMode(GL_MODELVIEW);
 		glLoadIdentity();
 		this->orthoProjection.setSize(window->getSize());
+#if !defined(_WIN32) || defined(_OPENGLES)
+		// the context is only current on this thread so the formats can't be queried later when textures are decoded on other threads
+		this->compressions.clear();
+		int count = 0;
+		glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+		if (count > 0)
+		{
+			int* values = new int[count];
+			glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, values);
+			for_iter (i, 0, count)
+			{
+				this->compressions += values[i];
+			}
+			delete [] values;
+		}
+#endif
 	}
 
 	void OpenGL_RenderSystem::reset()
@@ -364,6 +380,10 @@ namespace april
 		{
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 		}
+		else if (textureBlendMode == BM_PREMULTIPLIED)
+		{
+			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		}
 		else
 		{
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -434,6 +454,14 @@ namespace april
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 			break;
+		case Texture::FILTER_LINEAR_MIPMAP_LINEAR:
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			break;
+		case Texture::FILTER_NEAREST_MIPMAP_NEAREST:
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+			break;
 		default:
 			hlog::warn(april::logTag, "Trying to set unsupported texture filter!");
 			break;
@@ -466,14 +494,14 @@ namespace april
 
 	void OpenGL_RenderSystem::setTexture(Texture* texture)
 	{
-		this->activeTexture = (OpenGL_Texture*)texture;
+		this->activeTexture = (OpenGL_Texture*)this->_getDrawnTexture(texture);
 		if (this->activeTexture == NULL)
 		{
 			this->bindTexture(0);
 		}
 		else
 		{
-			this->setTextureFilter(this->activeTexture->getFilter());
+			this->setTextureFilter(this->activeTexture->_getUsedFilter());
 			this->setTextureAddressMode(this->activeTexture->getAddressMode());
 			// filtering and wrapping applied before loading texture data, iOS OpenGL guidelines suggest it as an optimization
 			this->activeTexture->load();
@@ -736,6 +764,8 @@ namespace april
 		case Image::FORMAT_ABGR:
 		case Image::FORMAT_RGBA:
 			return Image::FORMAT_RGBA;
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
+			return Image::FORMAT_RGBA_PREMULTIPLIED;
 		case Image::FORMAT_XRGB:
 		case Image::FORMAT_RGBX:
 		case Image::FORMAT_XBGR:
@@ -751,6 +781,13 @@ namespace april
 #endif
 #else
 			return Image::FORMAT_RGBA;
+#endif
+		// for optimizations
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
+#if !defined(_ANDROID) && !defined(_WIN32)
+			return Image::FORMAT_BGRA_PREMULTIPLIED;
+#else
+			return Image::FORMAT_RGBA_PREMULTIPLIED;
 #endif
 		case Image::FORMAT_RGB:
 			return Image::FORMAT_RGB;
@@ -771,13 +808,37 @@ namespace april
 		case Image::FORMAT_GRAYSCALE:
 			return Image::FORMAT_GRAYSCALE;
 			break;
-		case Image::FORMAT_PALETTE: // TODOaa - does palette use RGBA?
-			return Image::FORMAT_PALETTE;
-			break;
+		case Image::FORMAT_PALETTE: // the palette is expanded when uploading
+			return Image::FORMAT_RGBA;
+		// the 16 bit types are core since OpenGL 1.2 and OpenGL ES 1.0, older headers don't have them
+		case Image::FORMAT_RGB565:
+#ifdef GL_UNSIGNED_SHORT_5_6_5
+			return Image::FORMAT_RGB565;
+#else
+			return Image::FORMAT_RGBX;
+#endif
+		case Image::FORMAT_RGBA4444:
+		case Image::FORMAT_RGBA5551:
+#ifdef GL_UNSIGNED_SHORT_5_6_5
+			return format;
+#else
+			return Image::FORMAT_RGBA;
+#endif
+		case Image::FORMAT_COMPRESSED:
+			return Image::FORMAT_COMPRESSED;
 		}
 		return Image::FORMAT_INVALID;
 	}
 
+	bool OpenGL_RenderSystem::isCompressionSupported(int compression)
+	{
+#if !defined(_WIN32) || defined(_OPENGLES)
+		return this->compressions.contains(compression);
+#else
+		return false;
+#endif
+	}
+
 	Image* OpenGL_RenderSystem::takeScreenshot(Image::Format format)
 	{
 #ifdef _DEBUG
@@ -17,6 +17,7 @@
 #ifndef APRIL_OPENGL_RENDER_SYSTEM_H
 #define APRIL_OPENGL_RENDER_SYSTEM_H
 
+#include <hltypes/harray.h>
 #include <hltypes/hplatform.h>
 #include <hltypes/hstring.h>
 
@@ -75,12 +76,16 @@ namespace april
 		void render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices);
 		
 		Image::Format getNativeTextureFormat(Image::Format format);
+		/// @note Always false with desktop OpenGL on Win32 where opengl32.dll only exports OpenGL 1.1 without glCompressedTexImage2D(), compressed data is always decompressed in software there.
+		bool isCompressionSupported(int compression);
 		Image* takeScreenshot(Image::Format format);
 
 	protected:
 		OpenGL_State deviceState;
 		OpenGL_State currentState;
 		OpenGL_Texture* activeTexture;
+		/// @brief Compressed formats that glCompressedTexImage2D() accepts, queried when the window is assigned.
+		harray<int> compressions;
 
 		virtual void _setupDefaultParameters();
 		virtual void _applyStateChanges();
@@ -46,7 +46,7 @@ namespace april
         return (x > 0) && ((x & (x - 1)) == 0);
     }
 
-	OpenGL_Texture::OpenGL_Texture(bool fromResource) : Texture(fromResource), textureId(0), glFormat(0), internalFormat(0)
+	OpenGL_Texture::OpenGL_Texture(bool fromResource) : Texture(fromResource), textureId(0), glFormat(0), internalFormat(0), glType(GL_UNSIGNED_BYTE)
 	{
 		this->firstUpload = true;
 	}
@@ -57,10 +57,25 @@ namespace april
 		this->firstUpload = true;
 		this->_setCurrentTexture();
 		// required first call of glTexImage2D() to prevent problems
-#if TARGET_OS_IPHONE
-		if (this->dataFormat == GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG || this->dataFormat == GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG)
+#if !defined(_WIN32) || defined(_OPENGLES)
+		// compressed data can't be written later so it's uploaded right away, including all mipmap levels (Win32 desktop OpenGL always gets decompressed data)
+		if (this->dataFormat != 0)
 		{
-			glCompressedTexImage2D(GL_TEXTURE_2D, 0, this->dataFormat, this->width, this->height, 0, size, data);
+			int w = 0;
+			int h = 0;
+			int levelSize = 0;
+			for_iter (i, 0, this->mipmapLevels)
+			{
+				w = hmax(this->width >> i, 1);
+				h = hmax(this->height >> i, 1);
+				levelSize = Image::getCompressedSize(w, h, this->dataFormat);
+				if (levelSize == 0 && this->mipmapLevels == 1)
+				{
+					levelSize = size;
+				}
+				glCompressedTexImage2D(GL_TEXTURE_2D, i, this->dataFormat, w, h, 0, levelSize, data);
+				data += levelSize;
+			}
 			this->firstUpload = false;
 		}
 #endif
@@ -74,6 +89,7 @@ namespace april
 	
 	void OpenGL_Texture::_assignFormat()
 	{
+		this->glType = GL_UNSIGNED_BYTE;
 		switch (this->format)
 		{
 		case Image::FORMAT_ARGB:
@@ -82,11 +98,13 @@ namespace april
 		case Image::FORMAT_RGBX:
 		case Image::FORMAT_ABGR:
 		case Image::FORMAT_XBGR:
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
 			this->glFormat = this->internalFormat = GL_RGBA;
 			break;
 		// for optimizations
 		case Image::FORMAT_BGRA:
 		case Image::FORMAT_BGRX:
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
 #if !defined(_ANDROID) && !defined(_WIN32)
 #ifndef __APPLE__
 			this->glFormat = GL_BGRA;
@@ -119,9 +137,23 @@ namespace april
 		case Image::FORMAT_GRAYSCALE:
 			this->glFormat = this->internalFormat = GL_LUMINANCE;
 			break;
-		case Image::FORMAT_PALETTE: // TODOaa - does palette use RGBA?
+		case Image::FORMAT_PALETTE: // the palette is expanded when uploading
+			this->glFormat = this->internalFormat = GL_RGBA;
+			break;
+#ifdef GL_UNSIGNED_SHORT_5_6_5
+		case Image::FORMAT_RGB565:
+			this->glFormat = this->internalFormat = GL_RGB;
+			this->glType = GL_UNSIGNED_SHORT_5_6_5;
+			break;
+		case Image::FORMAT_RGBA4444:
 			this->glFormat = this->internalFormat = GL_RGBA;
+			this->glType = GL_UNSIGNED_SHORT_4_4_4_4;
 			break;
+		case Image::FORMAT_RGBA5551:
+			this->glFormat = this->internalFormat = GL_RGBA;
+			this->glType = GL_UNSIGNED_SHORT_5_5_5_1;
+			break;
+#endif
 		default:
 			this->glFormat = this->internalFormat = GL_RGBA;
 			break;
@@ -137,8 +169,9 @@ namespace april
 	{
 		APRIL_OGL_RENDERSYS->currentState.textureId = APRIL_OGL_RENDERSYS->deviceState.textureId = this->textureId;
 		glBindTexture(GL_TEXTURE_2D, this->textureId);
-		APRIL_OGL_RENDERSYS->currentState.textureFilter = APRIL_OGL_RENDERSYS->deviceState.textureFilter = this->filter;
-		APRIL_OGL_RENDERSYS->_setTextureFilter(this->filter);
+		Filter filter = this->_getUsedFilter();
+		APRIL_OGL_RENDERSYS->currentState.textureFilter = APRIL_OGL_RENDERSYS->deviceState.textureFilter = filter;
+		APRIL_OGL_RENDERSYS->_setTextureFilter(filter);
 		APRIL_OGL_RENDERSYS->currentState.textureAddressMode = APRIL_OGL_RENDERSYS->deviceState.textureAddressMode = this->addressMode;
 		APRIL_OGL_RENDERSYS->_setTextureAddressMode(this->addressMode);
 	}
@@ -176,24 +209,25 @@ namespace april
 		}
 		if (update)
 		{
-			if (this->format != Image::FORMAT_PALETTE)
+			if (this->format != Image::FORMAT_COMPRESSED)
 			{
 				this->_setCurrentTexture();
 				if (this->width == lock.w && this->height == lock.h)
 				{
-					glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, GL_UNSIGNED_BYTE, lock.data);
+					glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, this->glType, lock.data);
 				}
 				else
 				{
 					if (this->firstUpload)
 					{
-						int size = this->getByteSize();
+						// the GPU format can have more bytes per pixel than the texture's format, e.g. with palettes
+						int size = this->width * this->height * Image::getFormatBpp(april::rendersys->getNativeTextureFormat(this->format));
 						unsigned char* clearColor = new unsigned char[size];
 						memset(clearColor, 0, size);
-						glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, GL_UNSIGNED_BYTE, clearColor);
+						glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, this->glType, clearColor);
 						delete [] clearColor;
 					}
-					glTexSubImage2D(GL_TEXTURE_2D, 0, lock.dx, lock.dy, lock.w, lock.h, this->glFormat, GL_UNSIGNED_BYTE, lock.data);
+					glTexSubImage2D(GL_TEXTURE_2D, 0, lock.dx, lock.dy, lock.w, lock.h, this->glFormat, this->glType, lock.data);
 				}
 			}
 			delete [] lock.data;
@@ -202,38 +236,48 @@ namespace april
 		return update;
 	}
 
-	bool OpenGL_Texture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool OpenGL_Texture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src)
 	{
-		if (this->format == Image::FORMAT_PALETTE)
+		if (this->format == Image::FORMAT_COMPRESSED)
 		{
 			return false;
 		}
 		this->load();
 		this->_setCurrentTexture();
-		if (sx == 0 && dx == 0 && sy == 0 && dy == 0 && sw == this->width && srcWidth == this->width && sh == this->height && srcHeight == this->height)
+		if (sx == 0 && dx == 0 && sy == 0 && dy == 0 && sw == this->width && src.w == this->width && sh == this->height && src.h == this->height && src.isContiguous())
 		{
-			glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, GL_UNSIGNED_BYTE, srcData);
+			glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, this->glType, src.data);
 		}
 		else
 		{
 			if (this->firstUpload)
 			{
-				int size = this->getByteSize();
+				// the GPU format can have more bytes per pixel than the texture's format, e.g. with palettes
+				int size = this->width * this->height * Image::getFormatBpp(april::rendersys->getNativeTextureFormat(this->format));
 				unsigned char* clearColor = new unsigned char[size];
 				memset(clearColor, 0, size);
-				glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, GL_UNSIGNED_BYTE, clearColor);
+				glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, this->width, this->height, 0, this->glFormat, this->glType, clearColor);
 				delete [] clearColor;
 			}
-			int srcBpp = Image::getFormatBpp(srcFormat);
-			if (sx == 0 && dx == 0 && srcWidth == this->width && sw == this->width)
+			int srcBpp = src.getBpp();
+			if (sx == 0 && dx == 0 && src.w == this->width && sw == this->width && src.isContiguous())
 			{
-				glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy, sw, sh, this->glFormat, GL_UNSIGNED_BYTE, &srcData[(sx + sy * srcWidth) * srcBpp]);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy, sw, sh, this->glFormat, this->glType, src.getPixelData(sx, sy));
 			}
+#ifdef GL_UNPACK_ROW_LENGTH
+			else if (src.pitch % srcBpp == 0)
+			{
+				// the driver skips the rest of each source row so the whole rectangle can be uploaded at once
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, src.pitch / srcBpp);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy, sw, sh, this->glFormat, this->glType, src.getPixelData(sx, sy));
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			}
+#endif
 			else
 			{
 				for_iter (j, 0, sh)
 				{
-					glTexSubImage2D(GL_TEXTURE_2D, 0, dx, (dy + j), sw, 1, this->glFormat, GL_UNSIGNED_BYTE, &srcData[(sx + (sy + j) * srcWidth) * srcBpp]);
+					glTexSubImage2D(GL_TEXTURE_2D, 0, dx, (dy + j), sw, 1, this->glFormat, this->glType, src.getPixelData(sx, sy + j));
 				}
 			}
 		}
@@ -241,5 +285,16 @@ namespace april
 		return true;
 	}
 
+	bool OpenGL_Texture::_uploadMipmapToGpu(int level, const Image::View& src)
+	{
+		if (this->format == Image::FORMAT_COMPRESSED || !src.isContiguous())
+		{
+			return false;
+		}
+		this->_setCurrentTexture();
+		glTexImage2D(GL_TEXTURE_2D, level, this->internalFormat, src.w, src.h, 0, this->glFormat, this->glType, src.data);
+		return true;
+	}
+
 }
 #endif
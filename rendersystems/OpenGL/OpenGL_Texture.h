@@ -37,6 +37,8 @@ namespace april
 		unsigned int textureId;
 		int glFormat;
 		int internalFormat;
+		/// @brief GL_UNSIGNED_BYTE or one of the packed 16 bit types.
+		int glType;
 		bool firstUpload;
 
 		void _setCurrentTexture();
@@ -46,7 +48,8 @@ namespace april
 
 		Lock _tryLockSystem(int x, int y, int w, int h);
 		bool _unlockSystem(Lock& lock, bool update);
-		bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat);
+		bool _uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src);
+		bool _uploadMipmapToGpu(int level, const Image::View& src);
 
 	};
 
@@ -61,6 +61,11 @@ namespace april
 		}
 		return false;
 	}
+
+	bool RamTexture::loadAsync()
+	{
+		return (this->load() || this->isLoaded());
+	}
 	
 	void RamTexture::unload()
 	{
@@ -100,6 +105,11 @@ namespace april
 		return true;
 	}
 
+	int RamTexture::_getGpuByteSize()
+	{
+		return 0;
+	}
+
 	void RamTexture::_assignFormat()
 	{
 	}
@@ -114,7 +124,7 @@ namespace april
 		return true;
 	}
 
-	bool RamTexture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool RamTexture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src)
 	{
 		return true;
 	}
@@ -29,6 +29,8 @@
 #include "RenderSystem.h"
 #include "Platform.h"
 #include "Texture.h"
+#include "TextureAtlas.h"
+#include "TiledTexture.h"
 #include "Window.h"
 
 namespace april
@@ -95,6 +97,13 @@ namespace april
 		this->state = NULL;
 		this->textureFilter = Texture::FILTER_UNDEFINED;
 		this->textureAddressMode = Texture::ADDRESS_UNDEFINED;
+		this->asyncUploadBytes = 4 * 1024 * 1024;
+		this->asyncUploadTime = 4.0f;
+		this->asyncPlaceholder = NULL;
+		this->textureMemoryBudget = 0;
+		this->lowMemoryTextureBudget = 0;
+		this->asyncTextureReload = false;
+		this->frameIndex = 0;
 	}
 	
 	RenderSystem::~RenderSystem()
@@ -121,6 +130,11 @@ namespace april
 		if (this->created)
 		{
 			hlog::writef(april::logTag, "Destroying rendersystem '%s'.", this->name.c_str());
+			// tiled textures delete their own tiles
+			while (this->tiledTextures.size() > 0)
+			{
+				delete this->tiledTextures[0];
+			}
 			while (this->textures.size() > 0)
 			{
 				delete this->textures[0];
@@ -178,6 +192,11 @@ namespace april
 	}
 
 	Texture* RenderSystem::createTextureFromResource(chstr filename, Texture::Type type, bool loadImmediately)
+	{
+		return this->createTextureFromResource(filename, type, (loadImmediately ? Texture::LOAD_IMMEDIATE : Texture::LOAD_ON_DEMAND));
+	}
+
+	Texture* RenderSystem::createTextureFromResource(chstr filename, Texture::Type type, Texture::LoadMode loadMode)
 	{
 		hstr name = this->findTextureResource(filename);
 		if (name == "")
@@ -185,7 +204,7 @@ namespace april
 			return NULL;
 		}
 		Texture* texture = this->_createTexture(true);
-		if (!texture->_create(name, type) || (loadImmediately && !texture->load() && !texture->isLoaded()))
+		if (!texture->_create(name, type) || !this->_loadTexture(texture, loadMode))
 		{
 			delete texture;
 			return NULL;
@@ -194,6 +213,11 @@ namespace april
 	}
 
 	Texture* RenderSystem::createTextureFromResource(chstr filename, Image::Format format, Texture::Type type, bool loadImmediately)
+	{
+		return this->createTextureFromResource(filename, format, type, (loadImmediately ? Texture::LOAD_IMMEDIATE : Texture::LOAD_ON_DEMAND));
+	}
+
+	Texture* RenderSystem::createTextureFromResource(chstr filename, Image::Format format, Texture::Type type, Texture::LoadMode loadMode)
 	{
 		hstr name = this->findTextureResource(filename);
 		if (name == "")
@@ -201,7 +225,7 @@ namespace april
 			return NULL;
 		}
 		Texture* texture = this->_createTexture(true);
-		if (!texture->_create(name, format, type) || (loadImmediately && !texture->load() && !texture->isLoaded()))
+		if (!texture->_create(name, format, type) || !this->_loadTexture(texture, loadMode))
 		{
 			delete texture;
 			return NULL;
@@ -210,6 +234,11 @@ namespace april
 	}
 
 	Texture* RenderSystem::createTextureFromFile(chstr filename, Texture::Type type, bool loadImmediately)
+	{
+		return this->createTextureFromFile(filename, type, (loadImmediately ? Texture::LOAD_IMMEDIATE : Texture::LOAD_ON_DEMAND));
+	}
+
+	Texture* RenderSystem::createTextureFromFile(chstr filename, Texture::Type type, Texture::LoadMode loadMode)
 	{
 		hstr name = this->findTextureFile(filename);
 		if (name == "")
@@ -217,7 +246,7 @@ namespace april
 			return NULL;
 		}
 		Texture* texture = this->_createTexture(false);
-		if (!texture->_create(name, type) || (loadImmediately && !texture->load() && !texture->isLoaded()))
+		if (!texture->_create(name, type) || !this->_loadTexture(texture, loadMode))
 		{
 			delete texture;
 			return NULL;
@@ -226,6 +255,11 @@ namespace april
 	}
 
 	Texture* RenderSystem::createTextureFromFile(chstr filename, Image::Format format, Texture::Type type, bool loadImmediately)
+	{
+		return this->createTextureFromFile(filename, format, type, (loadImmediately ? Texture::LOAD_IMMEDIATE : Texture::LOAD_ON_DEMAND));
+	}
+
+	Texture* RenderSystem::createTextureFromFile(chstr filename, Image::Format format, Texture::Type type, Texture::LoadMode loadMode)
 	{
 		hstr name = this->findTextureFile(filename);
 		if (name == "")
@@ -233,7 +267,7 @@ namespace april
 			return NULL;
 		}
 		Texture* texture = this->_createTexture(false);
-		if (!texture->_create(name, format, type) || (loadImmediately && !texture->load() && !texture->isLoaded()))
+		if (!texture->_create(name, format, type) || !this->_loadTexture(texture, loadMode))
 		{
 			delete texture;
 			return NULL;
@@ -241,6 +275,70 @@ namespace april
 		return texture;
 	}
 
+	bool RenderSystem::_loadTexture(Texture* texture, Texture::LoadMode loadMode)
+	{
+		switch (loadMode)
+		{
+		case Texture::LOAD_IMMEDIATE:
+			return (texture->load() || texture->isLoaded());
+		case Texture::LOAD_ASYNC:
+			return texture->loadAsync();
+		default:
+			break;
+		}
+		return true;
+	}
+
+	Texture* RenderSystem::_getDrawnTexture(Texture* texture)
+	{
+		if (texture == NULL)
+		{
+			return NULL;
+		}
+		texture->lastUsedFrame = this->frameIndex;
+		if (texture->evicted)
+		{
+			texture->evicted = false;
+			// otherwise the render system loads it right away
+			if (this->asyncTextureReload)
+			{
+				texture->loadAsync();
+			}
+		}
+		if (texture->dirtyRects.size() > 0 || texture->mipmapsDirty)
+		{
+			texture->flushUploads();
+		}
+		if (this->asyncPlaceholder != NULL && texture != this->asyncPlaceholder && texture->asyncRequest != NULL)
+		{
+			this->asyncPlaceholder->lastUsedFrame = this->frameIndex;
+			return this->asyncPlaceholder;
+		}
+		return texture;
+	}
+
+	void RenderSystem::_finishFrame()
+	{
+		// flushing removes the texture from the list
+		harray<Texture*> textures = this->dirtyTextures;
+		foreach (Texture*, it, textures)
+		{
+			(*it)->flushUploads();
+		}
+		// uploading between frames keeps the time spent on it out of the frame that is being drawn
+		Texture::_uploadAsyncLoaded(this->asyncUploadBytes, this->asyncUploadTime);
+		if (this->textureMemoryBudget > 0)
+		{
+			this->trimTextureMemory(this->textureMemoryBudget);
+		}
+		++this->frameIndex;
+	}
+
+	bool RenderSystem::_compareLastUse(Texture* a, Texture* b)
+	{
+		return (a->lastUsedFrame < b->lastUsedFrame);
+	}
+
 	Texture* RenderSystem::createTexture(int w, int h, unsigned char* data, Image::Format format, Texture::Type type)
 	{
 		Texture* texture = this->_createTexture(true);
@@ -279,12 +377,129 @@ namespace april
 		return texture;
 	}
 	
+	TiledTexture* RenderSystem::createTiledTextureFromResource(chstr filename, Image::Format format, int tileSize, bool loadImmediately)
+	{
+		hstr name = this->findTextureResource(filename);
+		if (name == "")
+		{
+			return NULL;
+		}
+		return this->_createTiledTexture(name, true, format, tileSize, loadImmediately);
+	}
+
+	TiledTexture* RenderSystem::createTiledTextureFromFile(chstr filename, Image::Format format, int tileSize, bool loadImmediately)
+	{
+		hstr name = this->findTextureFile(filename);
+		if (name == "")
+		{
+			return NULL;
+		}
+		return this->_createTiledTexture(name, false, format, tileSize, loadImmediately);
+	}
+
+	TiledTexture* RenderSystem::_createTiledTexture(chstr filename, bool fromResource, Image::Format format, int tileSize, bool loadImmediately)
+	{
+		int maxSize = this->getMaxTextureSize();
+		if (tileSize <= 0 || tileSize > maxSize)
+		{
+			tileSize = maxSize;
+		}
+		if (tileSize < 3) // tiles need room for a border on both sides
+		{
+			hlog::errorf(april::logTag, "Cannot create tiles with size %d!", tileSize);
+			return NULL;
+		}
+		TiledTexture* texture = new TiledTexture(filename, fromResource, format, tileSize);
+		if (loadImmediately && !texture->load())
+		{
+			delete texture;
+			return NULL;
+		}
+		return texture;
+	}
+
+	TextureAtlas* RenderSystem::createTextureAtlas(int size, Image::Format format)
+	{
+		if (size <= 0 || size > this->getMaxTextureSize())
+		{
+			hlog::errorf(april::logTag, "Cannot create texture atlas with size %d, the maximum is %d!", size, this->getMaxTextureSize());
+			return NULL;
+		}
+		// managed, so the packed images don't have to be added again after the textures were unloaded
+		Texture* texture = this->createTexture(size, size, Color::Clear, format, Texture::TYPE_MANAGED);
+		if (texture == NULL)
+		{
+			return NULL;
+		}
+		return new TextureAtlas(size, texture);
+	}
+
 	void RenderSystem::unloadTextures()
 	{
+		// the tiles can't be reloaded on their own
+		foreach (TiledTexture*, it, this->tiledTextures)
+		{
+			(*it)->unload();
+		}
+		foreach (Texture*, it, this->textures)
+		{
+			(*it)->unload();
+		}
+	}
+
+	int RenderSystem::getTextureMemoryUsage()
+	{
+		int result = 0;
 		foreach (Texture*, it, this->textures)
 		{
+			result += (*it)->_getGpuByteSize();
+		}
+		return result;
+	}
+
+	int RenderSystem::trimTextureMemory(int maxBytes)
+	{
+		int usage = 0;
+		int size = 0;
+		harray<Texture*> candidates;
+		foreach (Texture*, it, this->textures)
+		{
+			size = (*it)->_getGpuByteSize();
+			usage += size;
+			// only immutable textures can be loaded again without losing anything
+			if (size > 0 && (*it)->type == Texture::TYPE_IMMUTABLE && (*it)->lastUsedFrame < this->frameIndex && (*it) != this->asyncPlaceholder)
+			{
+				candidates += (*it);
+			}
+		}
+		// nothing can be unloaded while all textures are still in use, e.g. if those of the current frame alone exceed the budget
+		if (usage <= maxBytes || candidates.size() == 0)
+		{
+			return usage;
+		}
+		std::stable_sort(candidates.begin(), candidates.end(), &RenderSystem::_compareLastUse);
+		int count = 0;
+		foreach (Texture*, it, candidates)
+		{
+			if (usage <= maxBytes)
+			{
+				break;
+			}
+			usage -= (*it)->_getGpuByteSize();
 			(*it)->unload();
+			(*it)->evicted = true;
+			++count;
 		}
+		if (count > 0)
+		{
+			hlog::writef(april::logTag, "Unloaded %d textures to stay within %d bytes of texture memory, %d bytes are used.", count, maxBytes, usage);
+		}
+		return usage;
+	}
+	
+	bool RenderSystem::isCompressionSupported(int compression)
+	{
+		return false;
 	}
 	
 	void RenderSystem::setIdentityTransform()
@@ -366,9 +581,74 @@ namespace april
 		this->render(RO_TRIANGLE_STRIP, tv, 4, color);
 	}
 	
+	void RenderSystem::drawTexturedRect(grect rect, grect src, TiledTexture* texture)
+	{
+		this->_drawTiledTexturedRect(rect, src, texture, NULL);
+	}
+
+	void RenderSystem::drawTexturedRect(grect rect, grect src, TiledTexture* texture, Color color)
+	{
+		this->_drawTiledTexturedRect(rect, src, texture, &color);
+	}
+
+	void RenderSystem::_drawTiledTexturedRect(grect rect, grect src, TiledTexture* texture, Color* color)
+	{
+		if (!texture->isLoaded() || src.w <= 0.0f || src.h <= 0.0f)
+		{
+			return;
+		}
+		// everything is calculated in pixels of the whole image
+		float srcLeft = src.x * texture->width;
+		float srcTop = src.y * texture->height;
+		float srcRight = (src.x + src.w) * texture->width;
+		float srcBottom = (src.y + src.h) * texture->height;
+		float scaleX = rect.w / (srcRight - srcLeft);
+		float scaleY = rect.h / (srcBottom - srcTop);
+		float left = 0.0f;
+		float top = 0.0f;
+		float right = 0.0f;
+		float bottom = 0.0f;
+		int x = 0;
+		int y = 0;
+		int w = 0;
+		int h = 0;
+		for_iter (j, 0, texture->rows)
+		{
+			// only the part of a tile without the border is drawn
+			top = hmax((float)(j * texture->stepHeight), srcTop);
+			bottom = hmin((float)hmin((j + 1) * texture->stepHeight, texture->height), srcBottom);
+			if (top >= bottom)
+			{
+				continue;
+			}
+			for_iter (i, 0, texture->columns)
+			{
+				left = hmax((float)(i * texture->stepWidth), srcLeft);
+				right = hmin((float)hmin((i + 1) * texture->stepWidth, texture->width), srcRight);
+				if (left >= right)
+				{
+					continue;
+				}
+				texture->_getTileRect(i, j, x, y, w, h);
+				this->setTexture(texture->tiles[j * texture->columns + i]);
+				grect destRect(rect.x + (left - srcLeft) * scaleX, rect.y + (top - srcTop) * scaleY, (right - left) * scaleX, (bottom - top) * scaleY);
+				grect tileRect((left - x) / w, (top - y) / h, (right - left) / w, (bottom - top) / h);
+				if (color != NULL)
+				{
+					this->drawTexturedRect(destRect, tileRect, *color);
+				}
+				else
+				{
+					this->drawTexturedRect(destRect, tileRect);
+				}
+			}
+		}
+	}
+
 	void RenderSystem::presentFrame()
 	{
 		april::window->presentFrame();
+		this->_finishFrame();
 	}
 	
 	hstr RenderSystem::findTextureResource(chstr filename)
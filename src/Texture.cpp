@@ -22,12 +22,16 @@
 
 #define HROUND_GRECT(rect) hround(rect.x), hround(rect.y), hround(rect.w), hround(rect.h)
 #define HROUND_GVEC2(vec2) hround(vec2.x), hround(vec2.y)
+// more separate uploads per texture and frame cost more than uploading some unchanged pixels
+#define MAX_DIRTY_RECTS 8
 
 namespace april
 {
 	Image::Format Texture::FORMAT_ALPHA = Image::FORMAT_ALPHA; // DEPRECATED
 	Image::Format Texture::FORMAT_ARGB = Image::FORMAT_RGBA; // DEPRECATED
 
+	int Texture::globalLodBias = 0;
+
 	Texture::Lock::Lock()
 	{
 		this->systemBuffer = NULL;
@@ -41,6 +45,7 @@ namespace april
 		this->dataWidth = 0;
 		this->dataHeight = 0;
 		this->format = Image::FORMAT_INVALID;
+		this->palette = NULL;
 		this->locked = false;
 		this->failed = true;
 		this->renderTarget = false;
@@ -91,6 +96,13 @@ namespace april
 		this->renderTarget = true;
 	}
 
+	Image::View Texture::Lock::getView() const
+	{
+		Image::View view(this->data, this->dataWidth, this->dataHeight, this->format);
+		view.palette = this->palette;
+		return view;
+	}
+
 	Texture::Texture(bool fromResource)
 	{
 		this->filename = "";
@@ -102,7 +114,18 @@ namespace april
 		this->filter = FILTER_LINEAR;
 		this->addressMode = ADDRESS_WRAP;
 		this->data = NULL;
+		this->palette = NULL;
 		this->fromResource = fromResource;
+		this->lodBias = 0;
+		this->sizeProbed = false;
+		this->mipmapLevels = 1;
+		this->gammaCorrectMipmaps = false;
+		this->asyncRequest = NULL;
+		this->asyncFailed = false;
+		this->lastUsedFrame = -1;
+		this->evicted = false;
+		this->deferredUpload = false;
+		this->mipmapsDirty = false;
 		april::rendersys->textures += this;
 	}
 
@@ -112,6 +135,7 @@ namespace april
 		this->type = type;
 		this->width = 0;
 		this->height = 0;
+		this->sizeProbed = false;
 		this->type = type;
 		this->format = Image::FORMAT_INVALID;
 		this->dataFormat = 0;
@@ -126,6 +150,7 @@ namespace april
 		this->type = type;
 		this->width = 0;
 		this->height = 0;
+		this->sizeProbed = false;
 		this->type = type;
 		this->format = format;
 		this->dataFormat = 0;
@@ -208,15 +233,51 @@ namespace april
 
 	Texture::~Texture()
 	{
+		this->_cancelAsyncLoad();
 		april::rendersys->textures -= this;
+		if (this->dirtyRects.size() > 0 || this->mipmapsDirty)
+		{
+			april::rendersys->dirtyTextures -= this;
+		}
+		if (april::rendersys->asyncPlaceholder == this)
+		{
+			april::rendersys->asyncPlaceholder = NULL;
+		}
 		if (this->data != NULL)
 		{
 			delete this->data;
 		}
+		if (this->palette != NULL)
+		{
+			delete [] this->palette;
+		}
+	}
+
+	void Texture::setGlobalLodBias(int value)
+	{
+		Texture::globalLodBias = value;
+	}
+
+	int Texture::getGlobalLodBias()
+	{
+		return Texture::globalLodBias;
+	}
+
+	void Texture::setDeferredUpload(bool value)
+	{
+		this->deferredUpload = value;
+		if (!value)
+		{
+			this->flushUploads();
+		}
 	}
 
 	int Texture::getWidth()
 	{
+		if (this->width == 0 && this->filename != "")
+		{
+			this->_probeSize();
+		}
 		if (this->width == 0)
 		{
 			hlog::warnf(april::logTag, "Texture '%s' has width = 0 (possibly not loaded yet?)", this->filename.c_str());
@@ -226,6 +287,10 @@ namespace april
 
 	int Texture::getHeight()
 	{
+		if (this->height == 0 && this->filename != "")
+		{
+			this->_probeSize();
+		}
 		if (this->height == 0)
 		{
 			hlog::warnf(april::logTag, "Texture '%s' has height = 0 (possibly not loaded yet?)", this->filename.c_str());
@@ -277,54 +342,229 @@ namespace april
 		return result;
 	}
 
+	Image::View Texture::_getDataView(unsigned char* data)
+	{
+		Image::View view(data, this->width, this->height, this->format);
+		view.palette = this->palette;
+		return view;
+	}
+
+	int Texture::_getGpuByteSize()
+	{
+		if (!this->isLoaded())
+		{
+			return 0;
+		}
+		if (this->dataFormat != 0)
+		{
+			return Image::getCompressedSize(this->width, this->height, this->dataFormat, this->mipmapLevels);
+		}
+		int result = this->width * this->height * Image::getFormatBpp(april::rendersys->getNativeTextureFormat(this->format));
+		// the mipmap levels add up to a third of the base level
+		if (this->mipmapLevels > 1)
+		{
+			result += result / 3;
+		}
+		return result;
+	}
+
+	bool Texture::_probeSize()
+	{
+		Image::Info info;
+		if (!(this->fromResource ? Image::probeResource(this->filename, info) : Image::probeFile(this->filename, info)))
+		{
+			return false;
+		}
+		// same rounding as the decoders use when reducing the resolution
+		int downscale = 1 << hclamp(this->lodBias + Texture::globalLodBias, 0, 3);
+		this->width = (info.w + downscale - 1) / downscale;
+		this->height = (info.h + downscale - 1) / downscale;
+		this->sizeProbed = true;
+		return true;
+	}
+
+	Texture::Filter Texture::_getUsedFilter()
+	{
+		// an incomplete mipmap chain can't be sampled either
+		if (this->mipmapLevels < Image::getMipmapCount(this->width, this->height))
+		{
+			if (this->filter == FILTER_LINEAR_MIPMAP_LINEAR)
+			{
+				return FILTER_LINEAR;
+			}
+			if (this->filter == FILTER_NEAREST_MIPMAP_NEAREST)
+			{
+				return FILTER_NEAREST;
+			}
+		}
+		return this->filter;
+	}
+
+	void Texture::_createMipmaps(unsigned char* data, Image::Format format)
+	{
+		this->mipmapLevels = 1;
+		// volatile textures keep no data that the levels could be recreated from after writing to them
+		if (this->type == TYPE_VOLATILE || (this->filter != FILTER_LINEAR_MIPMAP_LINEAR && this->filter != FILTER_NEAREST_MIPMAP_NEAREST))
+		{
+			return;
+		}
+		// the levels are created in the native format so they can be uploaded directly
+		Image::Format nativeFormat = april::rendersys->getNativeTextureFormat(format);
+		Image::View level(data, this->width, this->height, format);
+		level.palette = this->palette;
+		unsigned char* levelData = NULL;
+		if (Image::needsConversion(format, nativeFormat))
+		{
+			if (!Image::convertToFormat(level, &levelData, nativeFormat))
+			{
+				return;
+			}
+			level = Image::View(levelData, this->width, this->height, nativeFormat);
+		}
+		unsigned char* nextData = NULL;
+		int count = Image::getMipmapCount(this->width, this->height);
+		for_iter (i, 1, count)
+		{
+			nextData = NULL;
+			if (!Image::createMipmap(level, &nextData, this->gammaCorrectMipmaps))
+			{
+				break;
+			}
+			if (levelData != NULL)
+			{
+				delete [] levelData;
+			}
+			levelData = nextData;
+			level = Image::View(levelData, hmax(level.w / 2, 1), hmax(level.h / 2, 1), level.format);
+			if (!this->_uploadMipmapToGpu(i, level))
+			{
+				break;
+			}
+			this->mipmapLevels = i + 1;
+		}
+		if (levelData != NULL)
+		{
+			delete [] levelData;
+		}
+	}
+
+	bool Texture::_uploadMipmapToGpu(int level, const Image::View& src)
+	{
+		return false;
+	}
+
 	bool Texture::load()
 	{
 		if (this->isLoaded())
 		{
 			return true;
 		}
+		// the decoded image is uploaded at the end of a frame, loading it again here would defeat the upload budget
+		if (this->asyncRequest != NULL)
+		{
+			return false;
+		}
 		hlog::write(april::logTag, "Loading texture: " + this->_getInternalName());
 		int size = 0;
 		unsigned char* currentData = NULL;
 		if (this->data != NULL) // reload from memory
 		{
 			currentData = this->data;
-			size = this->getByteSize();
+			size = (this->dataFormat == 0 ? this->getByteSize() : Image::getCompressedSize(this->width, this->height, this->dataFormat, this->mipmapLevels));
 		}
 		// if no cached data and not a volatile texture that was previously loaded and thus has a width and height
-		if (currentData == NULL && (type != TYPE_VOLATILE || this->width == 0 || this->height == 0))
+		if (currentData == NULL && (type != TYPE_VOLATILE || this->sizeProbed || this->width == 0 || this->height == 0))
 		{
 			if (this->filename == "")
 			{
 				hlog::error(april::logTag, "No filename for texture specified!");
 				return false;
 			}
-			Image* image = NULL;
-			if (this->format == Image::FORMAT_INVALID)
+			int downscale = 1 << hclamp(this->lodBias + Texture::globalLodBias, 0, 3);
+			Image* image = Texture::_decodeImage(this->filename, this->fromResource, this->_getDecodeFormat(), downscale);
+			if (image != NULL)
 			{
-				image = (this->fromResource ? Image::createFromResource(this->filename) : Image::createFromFile(this->filename));
-			}
-			else
-			{
-				image = (this->fromResource ? Image::createFromResource(this->filename, this->format) : Image::createFromFile(this->filename, this->format));
+				image = Texture::_decompressUnsupported(image);
 			}
 			if (image == NULL)
 			{
 				hlog::error(april::logTag, "Failed to load texture: " + this->_getInternalName());
 				return false;
 			}
-			this->width = image->w;
-			this->height = image->h;
-			this->format = image->format;
-			this->dataFormat = image->internalFormat;
-			if (this->dataFormat != 0)
+			currentData = this->_takeImageData(image, size);
+		}
+		return this->_uploadData(currentData, size);
+	}
+
+	Image::Format Texture::_getDecodeFormat()
+	{
+		Image::Format format = this->format;
+		// without intermediate data the texture ends up in the native format anyway so the image can be decoded directly into it
+		if (format != Image::FORMAT_INVALID && (this->type == TYPE_VOLATILE || this->type == TYPE_IMMUTABLE))
+		{
+			Image::Format nativeFormat = april::rendersys->getNativeTextureFormat(format);
+			if (nativeFormat != Image::FORMAT_INVALID)
+			{
+				format = nativeFormat;
+			}
+		}
+		return format;
+	}
+
+	Image* Texture::_decodeImage(chstr filename, bool fromResource, Image::Format format, int downscale)
+	{
+		return (fromResource ? Image::createFromResource(filename, format, downscale) : Image::createFromFile(filename, format, downscale));
+	}
+
+	Image* Texture::_decompressUnsupported(Image* image)
+	{
+		if (image->format == Image::FORMAT_COMPRESSED && !april::rendersys->isCompressionSupported(image->internalFormat))
+		{
+			unsigned char* decompressedData = NULL;
+			Image::Format nativeFormat = april::rendersys->getNativeTextureFormat(Image::FORMAT_RGBA);
+			if (!Image::decompress(image->w, image->h, image->data, image->internalFormat, &decompressedData, nativeFormat))
 			{
-				size = image->compressedSize;
+				delete image;
+				return NULL;
 			}
-			currentData = image->data;
-			image->data = NULL;
-			delete image;
+			delete [] image->data;
+			image->data = decompressedData;
+			image->format = nativeFormat;
+			image->internalFormat = 0;
+			image->compressedSize = 0;
+			image->mipmapLevels = 1;
 		}
+		return image;
+	}
+
+	unsigned char* Texture::_takeImageData(Image* image, int& size)
+	{
+		this->width = image->w;
+		this->height = image->h;
+		this->sizeProbed = false;
+		this->format = image->format;
+		if (this->palette != NULL)
+		{
+			delete [] this->palette;
+		}
+		this->palette = image->palette;
+		image->palette = NULL;
+		this->dataFormat = image->internalFormat;
+		this->mipmapLevels = 1;
+		size = 0;
+		if (this->dataFormat != 0)
+		{
+			size = image->compressedSize;
+			this->mipmapLevels = image->mipmapLevels;
+		}
+		unsigned char* data = image->data;
+		image->data = NULL;
+		delete image;
+		return data;
+	}
+
+	bool Texture::_uploadData(unsigned char* currentData, int size)
+	{
 		this->_assignFormat();
 		if (!this->_createInternalTexture(currentData, size, this->type))
 		{
@@ -336,10 +576,15 @@ namespace april
 		}
 		if (currentData != NULL)
 		{
-			Type type = this->type;
-			this->type = TYPE_VOLATILE; // so the write call right below goes through
-			this->write(0, 0, this->width, this->height, 0, 0, currentData, this->width, this->height, format);
-			this->type = type;
+			// compressed data was already uploaded when the internal texture was created
+			if (this->dataFormat == 0)
+			{
+				Type type = this->type;
+				this->type = TYPE_VOLATILE; // so the write call right below goes through
+				this->write(0, 0, this->width, this->height, 0, 0, this->_getDataView(currentData));
+				this->type = type;
+				this->_createMipmaps(currentData, this->format);
+			}
 			if (this->type != TYPE_VOLATILE && (this->type != TYPE_IMMUTABLE || this->filename == ""))
 			{
 				if (this->data != currentData)
@@ -356,8 +601,22 @@ namespace april
 				delete [] currentData;
 				// the used format will be the native format, because there is no intermediate data
 				this->format = april::rendersys->getNativeTextureFormat(this->format);
+				if (this->palette != NULL)
+				{
+					delete [] this->palette;
+					this->palette = NULL;
+				}
 			}
 		}
+		// everything was uploaded, including deferred changes and the mipmaps
+		if (this->dirtyRects.size() > 0 || this->mipmapsDirty)
+		{
+			this->dirtyRects.clear();
+			this->mipmapsDirty = false;
+			april::rendersys->dirtyTextures -= this;
+		}
+		// a texture that was just loaded shouldn't be the first one to be unloaded again
+		this->lastUsedFrame = april::rendersys->frameIndex;
 		return true;
 	}
 
@@ -387,7 +646,7 @@ namespace april
 		}
 		if (this->data != NULL)
 		{
-			color = Image::getPixel(x, y, this->data, this->width, this->height, this->format);
+			color = Image::getPixel(x, y, this->_getDataView(this->data));
 		}
 		return color;
 	}
@@ -417,11 +676,112 @@ namespace april
 		}
 		if (this->data != NULL)
 		{
-			color = Image::getInterpolatedPixel(x, y, this->data, this->width, this->height, this->format);
+			color = Image::getInterpolatedPixel(x, y, this->_getDataView(this->data));
 		}
 		return color;
 	}
 
+	bool Texture::getPixels(int x, int y, int w, int h, Color* output)
+	{
+		if (this->type != TYPE_MANAGED)
+		{
+			hlog::warn(april::logTag, "Cannot read texture: " + this->_getInternalName());
+			return false;
+		}
+		return (this->data != NULL && Image::getPixels(x, y, w, h, output, this->_getDataView(this->data)));
+	}
+
+	bool Texture::setPixels(int x, int y, int w, int h, Color* colors)
+	{
+		if (this->type == TYPE_IMMUTABLE)
+		{
+			hlog::warn(april::logTag, "Cannot write texture: " + this->_getInternalName());
+			return false;
+		}
+		if (!Image::checkRect(x, y, w, h, this->width, this->height))
+		{
+			return false;
+		}
+		Lock lock = this->_tryLock(x, y, w, h);
+		if (lock.failed)
+		{
+			return false;
+		}
+		return this->_unlock(lock, Image::setPixels(lock.x, lock.y, lock.w, lock.h, colors, lock.data, lock.dataWidth, lock.dataHeight, lock.format));
+	}
+
+	bool Texture::getPixels(gvec2* positions, int count, Color* output)
+	{
+		if (this->type != TYPE_MANAGED)
+		{
+			hlog::warn(april::logTag, "Cannot read texture: " + this->_getInternalName());
+			return false;
+		}
+		return (this->data != NULL && Image::getPixels(positions, count, output, this->_getDataView(this->data)));
+	}
+
+	bool Texture::setPixels(gvec2* positions, int count, Color* colors)
+	{
+		if (this->type == TYPE_IMMUTABLE)
+		{
+			hlog::warn(april::logTag, "Cannot write texture: " + this->_getInternalName());
+			return false;
+		}
+		bool result = true;
+		// without a RAM copy a locked rectangle isn't filled with the current pixels so each pixel is written on its own
+		if (this->data == NULL)
+		{
+			for_iter (i, 0, count)
+			{
+				if (!this->setPixel(hround(positions[i].x), hround(positions[i].y), colors[i]))
+				{
+					result = false;
+				}
+			}
+			return result;
+		}
+		// only the bounding rectangle of all valid positions is locked
+		int x0 = this->width;
+		int y0 = this->height;
+		int x1 = -1;
+		int y1 = -1;
+		int x = 0;
+		int y = 0;
+		for_iter (i, 0, count)
+		{
+			x = hround(positions[i].x);
+			y = hround(positions[i].y);
+			if (Image::checkRect(x, y, this->width, this->height))
+			{
+				x0 = hmin(x0, x);
+				y0 = hmin(y0, y);
+				x1 = hmax(x1, x);
+				y1 = hmax(y1, y);
+			}
+		}
+		if (x1 < x0 || y1 < y0)
+		{
+			return false;
+		}
+		Lock lock = this->_tryLock(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+		if (lock.failed)
+		{
+			return false;
+		}
+		for_iter (i, 0, count)
+		{
+			x = hround(positions[i].x);
+			y = hround(positions[i].y);
+			if (!Image::checkRect(x, y, this->width, this->height) ||
+				!Image::setPixel(x - x0 + lock.x, y - y0 + lock.y, colors[i], lock.data, lock.dataWidth, lock.dataHeight, lock.format))
+			{
+				result = false;
+			}
+		}
+		this->_unlock(lock, true);
+		return result;
+	}
+
 	bool Texture::fillRect(int x, int y, int w, int h, Color color)
 	{
 		if (this->type == TYPE_IMMUTABLE)
@@ -457,20 +817,25 @@ namespace april
 		{
 			return false;
 		}
-		bool result = Image::convertToFormat(lock.dataWidth, lock.dataHeight, lock.data, lock.format, output, format, false);
+		bool result = Image::convertToFormat(lock.getView(), output, format, false);
 		this->_unlock(lock, false);
 		return result;
 	}
 
 	bool Texture::write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	{
+		return this->write(sx, sy, sw, sh, dx, dy, Image::View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Texture::write(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src)
 	{
 		if (this->type == TYPE_IMMUTABLE)
 		{
 			hlog::warn(april::logTag, "Cannot write texture: " + this->_getInternalName());
 			return false;
 		}
-		if (this->type == TYPE_VOLATILE && !Image::needsConversion(srcFormat, april::rendersys->getNativeTextureFormat(this->format)) &&
-			this->_uploadToGpu(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat))
+		if (this->type == TYPE_VOLATILE && !Image::needsConversion(src.format, april::rendersys->getNativeTextureFormat(this->format)) &&
+			this->_uploadToGpu(sx, sy, sw, sh, dx, dy, src))
 		{
 			return true;
 		}
@@ -479,7 +844,7 @@ namespace april
 		{
 			return false;
 		}
-		return this->_unlock(lock, Image::write(sx, sy, sw, sh, lock.x, lock.y, srcData, srcWidth, srcHeight, srcFormat, lock.data, lock.dataWidth, lock.dataHeight, lock.format));
+		return this->_unlock(lock, Image::write(sx, sy, sw, sh, lock.x, lock.y, src, lock.getView()));
 	}
 
 	bool Texture::write(int sx, int sy, int sw, int sh, int dx, int dy, Texture* texture)
@@ -503,12 +868,17 @@ namespace april
 		{
 			return false;
 		}
-		bool result = this->write(lock.dx, lock.dy, lock.w, lock.h, dx, dy, lock.data, lock.dataWidth, lock.dataHeight, lock.format);
+		bool result = this->write(lock.dx, lock.dy, lock.w, lock.h, dx, dy, lock.getView());
 		texture->_unlock(lock, false);
 		return result;
 	}
 
 	bool Texture::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	{
+		return this->writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, Image::View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Texture::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const Image::View& src)
 	{
 		if (this->type == TYPE_IMMUTABLE)
 		{
@@ -520,7 +890,7 @@ namespace april
 		{
 			return false;
 		}
-		return this->_unlock(lock, Image::writeStretch(sx, sy, sw, sh, lock.x, lock.y, lock.w, lock.h, srcData, srcWidth, srcHeight, srcFormat, lock.data, lock.dataWidth, lock.dataHeight, lock.format));
+		return this->_unlock(lock, Image::writeStretch(sx, sy, sw, sh, lock.x, lock.y, lock.w, lock.h, src, lock.getView()));
 	}
 
 	bool Texture::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Texture* texture)
@@ -544,12 +914,17 @@ namespace april
 		{
 			return false;
 		}
-		bool result = this->writeStretch(lock.dx, lock.dy, lock.w, lock.h, dx, dy, dw, dh, lock.data, lock.dataWidth, lock.dataHeight, lock.format);
+		bool result = this->writeStretch(lock.dx, lock.dy, lock.w, lock.h, dx, dy, dw, dh, lock.getView());
 		texture->_unlock(lock, false);
 		return result;
 	}
 
 	bool Texture::blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
+	{
+		return this->blit(sx, sy, sw, sh, dx, dy, Image::View(srcData, srcWidth, srcHeight, srcFormat), alpha);
+	}
+
+	bool Texture::blit(int sx, int sy, int sw, int sh, int dx, int dy, const Image::View& src, unsigned char alpha)
 	{
 		if (this->type != TYPE_MANAGED)
 		{
@@ -561,7 +936,7 @@ namespace april
 		{
 			return false;
 		}
-		return this->_unlock(lock, Image::blit(sx, sy, sw, sh, lock.x, lock.y, srcData, srcWidth, srcHeight, srcFormat, lock.data, lock.dataWidth, lock.dataHeight, lock.format, alpha));
+		return this->_unlock(lock, Image::blit(sx, sy, sw, sh, lock.x, lock.y, src, lock.getView(), alpha));
 	}
 
 	bool Texture::blit(int sx, int sy, int sw, int sh, int dx, int dy, Texture* texture, unsigned char alpha)
@@ -585,12 +960,17 @@ namespace april
 		{
 			return false;
 		}
-		bool result = this->blit(lock.dx, lock.dy, lock.w, lock.h, dx, dy, lock.data, lock.dataWidth, lock.dataHeight, lock.format, alpha);
+		bool result = this->blit(lock.dx, lock.dy, lock.w, lock.h, dx, dy, lock.getView(), alpha);
 		texture->_unlock(lock, false);
 		return result;
 	}
 
 	bool Texture::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
+	{
+		return this->blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, Image::View(srcData, srcWidth, srcHeight, srcFormat), alpha);
+	}
+
+	bool Texture::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const Image::View& src, unsigned char alpha)
 	{
 		if (this->type != TYPE_MANAGED)
 		{
@@ -602,7 +982,7 @@ namespace april
 		{
 			return false;
 		}
-		return this->_unlock(lock, Image::blitStretch(sx, sy, sw, sh, lock.x, lock.y, lock.w, lock.h, srcData, srcWidth, srcHeight, srcFormat, lock.data, lock.dataWidth, lock.dataHeight, lock.format, alpha));
+		return this->_unlock(lock, Image::blitStretch(sx, sy, sw, sh, lock.x, lock.y, lock.w, lock.h, src, lock.getView(), alpha));
 	}
 
 	bool Texture::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Texture* texture, unsigned char alpha)
@@ -626,7 +1006,7 @@ namespace april
 		{
 			return false;
 		}
-		bool result = this->blitStretch(lock.dx, lock.dy, lock.w, lock.h, dx, dy, dw, dh, lock.data, lock.dataWidth, lock.dataHeight, lock.format, alpha);
+		bool result = this->blitStretch(lock.dx, lock.dy, lock.w, lock.h, dx, dy, dw, dh, lock.getView(), alpha);
 		texture->_unlock(lock, false);
 		return result;
 	}
@@ -734,6 +1114,16 @@ namespace april
 		return this->getInterpolatedPixel(position.x, position.y);
 	}
 
+	bool Texture::getPixels(grect rect, Color* output)
+	{
+		return this->getPixels(HROUND_GRECT(rect), output);
+	}
+
+	bool Texture::setPixels(grect rect, Color* colors)
+	{
+		return this->setPixels(HROUND_GRECT(rect), colors);
+	}
+
 	bool Texture::fillRect(grect rect, Color color)
 	{
 		return this->fillRect(HROUND_GRECT(rect), color);
@@ -756,12 +1146,12 @@ namespace april
 
 	bool Texture::write(int sx, int sy, int sw, int sh, int dx, int dy, Image* image)
 	{
-		return this->write(sx, sy, sw, sh, dx, dy, image->data, image->w, image->h, image->format);
+		return this->write(sx, sy, sw, sh, dx, dy, image->getView());
 	}
 
 	bool Texture::write(grect srcRect, gvec2 destPosition, Image* image)
 	{
-		return this->write(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), image->data, image->w, image->h, image->format);
+		return this->write(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), image);
 	}
 
 	bool Texture::writeStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
@@ -776,12 +1166,12 @@ namespace april
 
 	bool Texture::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* image)
 	{
-		return this->writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, image->data, image->w, image->h, image->format);
+		return this->writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, image->getView());
 	}
 
 	bool Texture::writeStretch(grect srcRect, grect destRect, Image* image)
 	{
-		return this->writeStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), image->data, image->w, image->h, image->format);
+		return this->writeStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), image);
 	}
 
 	bool Texture::blit(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
@@ -796,12 +1186,12 @@ namespace april
 
 	bool Texture::blit(int sx, int sy, int sw, int sh, int dx, int dy, Image* image, unsigned char alpha)
 	{
-		return this->blit(sx, sy, sw, sh, dx, dy, image->data, image->w, image->h, image->format, alpha);
+		return this->blit(sx, sy, sw, sh, dx, dy, image->getView(), alpha);
 	}
 
 	bool Texture::blit(grect srcRect, gvec2 destPosition, Image* image, unsigned char alpha)
 	{
-		return this->blit(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), image->data, image->w, image->h, image->format, alpha);
+		return this->blit(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), image, alpha);
 	}
 
 	bool Texture::blitStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
@@ -816,12 +1206,12 @@ namespace april
 
 	bool Texture::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* image, unsigned char alpha)
 	{
-		return this->blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, image->data, image->w, image->h, image->format, alpha);
+		return this->blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, image->getView(), alpha);
 	}
 
 	bool Texture::blitStretch(grect srcRect, grect destRect, Image* image, unsigned char alpha)
 	{
-		return this->blitStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), image->data, image->w, image->h, image->format, alpha);
+		return this->blitStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), image, alpha);
 	}
 
 	bool Texture::rotateHue(grect rect, float degrees)
@@ -854,6 +1244,7 @@ namespace april
 		if (this->data != NULL)
 		{
 			lock.activateLock(x, y, w, h, x, y, this->data, this->width, this->height, this->format);
+			lock.palette = this->palette;
 		}
 		else
 		{
@@ -870,17 +1261,31 @@ namespace april
 
 	bool Texture::_unlock(Texture::Lock lock, bool update)
 	{
+		if (update && this->deferredUpload && !lock.failed && lock.systemBuffer == NULL && lock.data != NULL && lock.data == this->data && this->dataFormat == 0)
+		{
+			this->_addDirtyRect(lock.dx, lock.dy, lock.w, lock.h);
+			return true;
+		}
 		if (!this->_unlockSystem(lock, update) && !lock.failed && update)
 		{
 			update = this->_uploadDataToGpu(lock.dx, lock.dy, lock.w, lock.h);
 		}
+		// the smaller levels are recreated only once before the texture is drawn, not for every small change
+		if (update && this->mipmapLevels > 1 && this->data != NULL && this->dataFormat == 0 && !this->mipmapsDirty)
+		{
+			if (this->dirtyRects.size() == 0)
+			{
+				april::rendersys->dirtyTextures += this;
+			}
+			this->mipmapsDirty = true;
+		}
 		return update;
 	}
 
 	bool Texture::_uploadDataToGpu(int x, int y, int w, int h)
 	{
 		if (!Image::needsConversion(this->format, april::rendersys->getNativeTextureFormat(this->format)) &&
-			this->_uploadToGpu(x, y, w, h, x, y, this->data, this->width, this->height, this->format))
+			this->_uploadToGpu(x, y, w, h, x, y, this->_getDataView(this->data)))
 		{
 			return true;
 		}
@@ -890,9 +1295,105 @@ namespace april
 		{
 			return false;
 		}
-		bool result = Image::write(x, y, w, h, lock.x, lock.y, this->data, this->width, this->height, this->format, lock.data, lock.dataWidth, lock.dataHeight, lock.format);
+		bool result = Image::write(x, y, w, h, lock.x, lock.y, this->_getDataView(this->data), lock.getView());
 		this->_unlockSystem(lock, true);
 		return result;
 	}
 
+	bool Texture::flushUploads()
+	{
+		if (this->dirtyRects.size() == 0 && !this->mipmapsDirty)
+		{
+			return true;
+		}
+		harray<DirtyRect> rects = this->dirtyRects;
+		this->dirtyRects.clear();
+		this->mipmapsDirty = false;
+		april::rendersys->dirtyTextures -= this;
+		// an unloaded texture gets all of the RAM copy when it's loaded again
+		if (!this->isLoaded())
+		{
+			return true;
+		}
+		bool result = true;
+		foreach (DirtyRect, it, rects)
+		{
+			if (!this->_uploadDataToGpu((*it).x, (*it).y, (*it).w, (*it).h))
+			{
+				result = false;
+			}
+		}
+		// the smaller levels are recreated only once for all changes
+		if (this->mipmapLevels > 1 && this->data != NULL && this->dataFormat == 0)
+		{
+			this->_createMipmaps(this->data, this->format);
+		}
+		return result;
+	}
+
+	void Texture::_addDirtyRect(int x, int y, int w, int h)
+	{
+		if (!Image::correctRect(x, y, w, h, this->width, this->height) || w <= 0 || h <= 0)
+		{
+			return;
+		}
+		if (this->dirtyRects.size() == 0 && !this->mipmapsDirty)
+		{
+			april::rendersys->dirtyTextures += this;
+		}
+		int left = 0;
+		int top = 0;
+		int right = 0;
+		int bottom = 0;
+		int area = 0;
+		int bestIndex = -1;
+		int bestGrowth = 0;
+		bool merged = true;
+		// a merged rect can reach other rects so merging is repeated until nothing changes
+		while (merged)
+		{
+			merged = false;
+			bestIndex = -1;
+			for_iter (i, 0, this->dirtyRects.size())
+			{
+				const DirtyRect& other = this->dirtyRects[i];
+				left = hmin(x, other.x);
+				top = hmin(y, other.y);
+				right = hmax(x + w, other.x + other.w);
+				bottom = hmax(y + h, other.y + other.h);
+				area = (right - left) * (bottom - top);
+				// overlapping or nearly adjacent rects are merged if at most a quarter of the merged rect wasn't changed
+				if ((area - w * h - other.w * other.h) * 4 <= area)
+				{
+					bestIndex = i;
+					break;
+				}
+				// otherwise the rect that grows the least is used if there are too many
+				if (this->dirtyRects.size() >= MAX_DIRTY_RECTS && (bestIndex < 0 || area - other.w * other.h < bestGrowth))
+				{
+					bestIndex = i;
+					bestGrowth = area - other.w * other.h;
+				}
+			}
+			if (bestIndex >= 0)
+			{
+				const DirtyRect& other = this->dirtyRects[bestIndex];
+				left = hmin(x, other.x);
+				top = hmin(y, other.y);
+				w = hmax(x + w, other.x + other.w) - left;
+				h = hmax(y + h, other.y + other.h) - top;
+				x = left;
+				y = top;
+				this->dirtyRects.remove_at(bestIndex);
+				merged = true;
+			}
+		}
+		DirtyRect rect;
+		rect.x = x;
+		rect.y = y;
+		rect.w = w;
+		rect.h = h;
+		this->dirtyRects += rect;
+	}
+
 }
@@ -0,0 +1,299 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/harray.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hstring.h>
+#include <hltypes/hthread.h>
+
+#include "april.h"
+#include "Image.h"
+#include "Texture.h"
+#include "Timer.h"
+
+namespace april
+{
+	/// @brief Everything a background thread needs to decode a texture, it never touches the texture itself.
+	struct AsyncTextureRequest
+	{
+		Texture* texture;
+		hstr filename;
+		bool fromResource;
+		Image::Format format;
+		int downscale;
+		Image* image;
+		bool decoded;
+		/// @brief The texture was destroyed while the image was being decoded, the thread deletes the request when it's done.
+		bool cancelled;
+	};
+
+	static int asyncThreadCount = 1;
+	static harray<hthread*> workers;
+	static harray<hthread*> idleWorkers;
+	static hmutex asyncMutex;
+	// requests waiting for a thread, those being decoded and those waiting for the upload, each in the order they were made
+	static harray<AsyncTextureRequest*> queuedRequests;
+	static harray<AsyncTextureRequest*> decodingRequests;
+	static harray<AsyncTextureRequest*> decodedRequests;
+
+	// a thread runs until there's nothing left to decode and is restarted when new requests arrive
+	void Texture::_asyncWorkerProcess(hthread* thread)
+	{
+		AsyncTextureRequest* request = NULL;
+		Image* image = NULL;
+		while (true)
+		{
+			asyncMutex.lock();
+			if (queuedRequests.size() == 0)
+			{
+				// threads that are being destroyed aren't in the list anymore
+				if (workers.contains(thread))
+				{
+					idleWorkers += thread;
+				}
+				asyncMutex.unlock();
+				break;
+			}
+			request = queuedRequests.remove_first();
+			decodingRequests += request;
+			asyncMutex.unlock();
+			image = Texture::_decodeImage(request->filename, request->fromResource, request->format, request->downscale);
+			asyncMutex.lock();
+			decodingRequests -= request;
+			if (request->cancelled)
+			{
+				if (image != NULL)
+				{
+					delete image;
+				}
+				delete request;
+			}
+			else
+			{
+				request->image = image;
+				request->decoded = true;
+				decodedRequests += request;
+			}
+			asyncMutex.unlock();
+		}
+	}
+
+	// has to be called with the mutex locked
+	void Texture::_startAsyncWorkers()
+	{
+		int running = workers.size() - idleWorkers.size();
+		hthread* thread = NULL;
+		while (running < asyncThreadCount && running < queuedRequests.size() + decodingRequests.size())
+		{
+			if (idleWorkers.size() > 0)
+			{
+				// the thread has already left its loop, it only has to finish returning
+				thread = idleWorkers.remove_last();
+				thread->join();
+			}
+			else
+			{
+				thread = new hthread(&Texture::_asyncWorkerProcess, "april async texture");
+				workers += thread;
+			}
+			thread->start();
+			++running;
+		}
+	}
+
+	void Texture::setAsyncThreadCount(int value)
+	{
+		asyncMutex.lock();
+		asyncThreadCount = hmax(value, 1);
+		while (workers.size() > asyncThreadCount && idleWorkers.size() > 0)
+		{
+			hthread* thread = idleWorkers.remove_last();
+			workers -= thread;
+			thread->join();
+			delete thread;
+		}
+		asyncMutex.unlock();
+	}
+
+	int Texture::getAsyncThreadCount()
+	{
+		return asyncThreadCount;
+	}
+
+	void Texture::destroyAsyncThreads()
+	{
+		asyncMutex.lock();
+		harray<AsyncTextureRequest*> requests = queuedRequests;
+		requests += decodedRequests;
+		queuedRequests.clear();
+		decodedRequests.clear();
+		foreach (AsyncTextureRequest*, it, requests)
+		{
+			(*it)->texture->asyncRequest = NULL;
+			if ((*it)->image != NULL)
+			{
+				delete (*it)->image;
+			}
+			delete (*it);
+		}
+		// the threads delete these requests when they are done decoding them
+		foreach (AsyncTextureRequest*, it, decodingRequests)
+		{
+			(*it)->texture->asyncRequest = NULL;
+			(*it)->cancelled = true;
+		}
+		harray<hthread*> threads = workers;
+		workers.clear();
+		idleWorkers.clear();
+		asyncMutex.unlock();
+		// without queued requests the threads stop as soon as they finish their current image
+		foreach (hthread*, it, threads)
+		{
+			(*it)->join();
+			delete (*it);
+		}
+	}
+
+	bool Texture::loadAsync()
+	{
+		if (this->isLoaded() || this->asyncRequest != NULL)
+		{
+			return true;
+		}
+		// data in RAM or an empty volatile texture don't need any decoding
+		if (this->data != NULL || this->filename == "" || (this->type == TYPE_VOLATILE && !this->sizeProbed && this->width > 0 && this->height > 0))
+		{
+			return this->load();
+		}
+		hlog::write(april::logTag, "Loading texture asynchronously: " + this->_getInternalName());
+		this->asyncFailed = false;
+		AsyncTextureRequest* request = new AsyncTextureRequest();
+		request->texture = this;
+		request->filename = this->filename;
+		request->fromResource = this->fromResource;
+		// the render system is only asked on this thread
+		request->format = this->_getDecodeFormat();
+		request->downscale = 1 << hclamp(this->lodBias + Texture::globalLodBias, 0, 3);
+		request->image = NULL;
+		request->decoded = false;
+		request->cancelled = false;
+		this->asyncRequest = request;
+		asyncMutex.lock();
+		queuedRequests += request;
+		Texture::_startAsyncWorkers();
+		asyncMutex.unlock();
+		return true;
+	}
+
+	Texture::LoadState Texture::getLoadState()
+	{
+		if (this->asyncRequest != NULL)
+		{
+			asyncMutex.lock();
+			bool decoded = this->asyncRequest->decoded;
+			asyncMutex.unlock();
+			return (decoded ? LOAD_STATE_UPLOAD_PENDING : LOAD_STATE_DECODING);
+		}
+		if (this->isLoaded())
+		{
+			return LOAD_STATE_LOADED;
+		}
+		return (this->asyncFailed ? LOAD_STATE_FAILED : LOAD_STATE_UNLOADED);
+	}
+
+	bool Texture::_finishAsyncLoad(Image* image)
+	{
+		this->asyncRequest = NULL;
+		if (image != NULL)
+		{
+			image = Texture::_decompressUnsupported(image);
+		}
+		if (image == NULL)
+		{
+			hlog::error(april::logTag, "Failed to load texture: " + this->_getInternalName());
+			this->asyncFailed = true;
+			return false;
+		}
+		int size = 0;
+		unsigned char* currentData = this->_takeImageData(image, size);
+		if (!this->_uploadData(currentData, size))
+		{
+			hlog::error(april::logTag, "Failed to upload texture: " + this->_getInternalName());
+			this->asyncFailed = true;
+			return false;
+		}
+		return true;
+	}
+
+	void Texture::_cancelAsyncLoad()
+	{
+		if (this->asyncRequest == NULL)
+		{
+			return;
+		}
+		AsyncTextureRequest* request = this->asyncRequest;
+		this->asyncRequest = NULL;
+		asyncMutex.lock();
+		if (decodingRequests.contains(request))
+		{
+			request->cancelled = true;
+			request = NULL;
+		}
+		else if (queuedRequests.contains(request))
+		{
+			queuedRequests -= request;
+		}
+		else if (decodedRequests.contains(request))
+		{
+			decodedRequests -= request;
+		}
+		asyncMutex.unlock();
+		if (request != NULL)
+		{
+			if (request->image != NULL)
+			{
+				delete request->image;
+			}
+			delete request;
+		}
+	}
+
+	void Texture::_uploadAsyncLoaded(int maxBytes, float maxTime)
+	{
+		Timer timer;
+		float start = timer.getTime();
+		int bytes = 0;
+		AsyncTextureRequest* request = NULL;
+		Texture* texture = NULL;
+		while (true)
+		{
+			asyncMutex.lock();
+			request = (decodedRequests.size() > 0 ? decodedRequests.remove_first() : NULL);
+			asyncMutex.unlock();
+			if (request == NULL)
+			{
+				break;
+			}
+			if (request->image != NULL)
+			{
+				bytes += (request->image->compressedSize > 0 ? request->image->compressedSize : request->image->getByteSize());
+			}
+			texture = request->texture;
+			texture->_finishAsyncLoad(request->image);
+			delete request;
+			if (bytes >= maxBytes || timer.getTime() - start >= maxTime)
+			{
+				break;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,243 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/harray.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+#include "april.h"
+#include "Image.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+
+namespace april
+{
+	TextureAtlas::TextureAtlas(int size, Texture* texture)
+	{
+		this->size = size;
+		this->texture = texture;
+		this->padding = 1;
+		this->usedArea = 0;
+		Node node;
+		node.x = 0;
+		node.y = 0;
+		node.w = size;
+		this->skyline += node;
+	}
+
+	TextureAtlas::~TextureAtlas()
+	{
+		foreach (Region*, it, this->regions)
+		{
+			delete (*it);
+		}
+		delete this->texture;
+	}
+
+	float TextureAtlas::getUsage()
+	{
+		return ((float)this->usedArea / (this->size * this->size));
+	}
+
+	TextureAtlas::Region* TextureAtlas::getRegion(chstr name)
+	{
+		foreach (Region*, it, this->regions)
+		{
+			if ((*it)->name == name)
+			{
+				return (*it);
+			}
+		}
+		return NULL;
+	}
+
+	TextureAtlas::Region* TextureAtlas::add(chstr name, const Image::View& src)
+	{
+		if (src.data == NULL || src.w <= 0 || src.h <= 0)
+		{
+			hlog::error(april::logTag, "Cannot add empty image to texture atlas: " + name);
+			return NULL;
+		}
+		int p = this->padding;
+		int w = src.w + p * 2;
+		int h = src.h + p * 2;
+		int x = 0;
+		int y = 0;
+		int index = -1;
+		this->_findPosition(w, h, x, y, index);
+		if (index < 0)
+		{
+			hlog::errorf(april::logTag, "Image '%s' (%dx%d) doesn't fit into the texture atlas anymore!", name.c_str(), src.w, src.h);
+			return NULL;
+		}
+		// the image and its padding are put together in RAM first so the texture is only uploaded once
+		Image::Format format = this->texture->getFormat();
+		unsigned char* data = new unsigned char[w * h * Image::getFormatBpp(format)];
+		Image::View padded(data, w, h, format);
+		if (!Image::write(0, 0, src.w, src.h, p, p, src, padded))
+		{
+			delete [] data;
+			return NULL;
+		}
+		// columns first so the rows copied afterwards fill the corners as well
+		for_iter (i, 0, p)
+		{
+			Image::write(p, p, 1, src.h, i, p, padded, padded);
+			Image::write(p + src.w - 1, p, 1, src.h, p + src.w + i, p, padded, padded);
+		}
+		for_iter (i, 0, p)
+		{
+			Image::write(0, p, w, 1, 0, i, padded, padded);
+			Image::write(0, p + src.h - 1, w, 1, 0, p + src.h + i, padded, padded);
+		}
+		bool result = this->texture->write(0, 0, w, h, x, y, padded);
+		delete [] data;
+		if (!result)
+		{
+			hlog::error(april::logTag, "Failed to write image into texture atlas: " + name);
+			return NULL;
+		}
+		this->_addRect(index, x, y, w, h);
+		this->usedArea += w * h;
+		Region* region = new Region();
+		region->name = name;
+		region->x = x + p;
+		region->y = y + p;
+		region->w = src.w;
+		region->h = src.h;
+		region->src = grect((float)region->x / this->size, (float)region->y / this->size, (float)region->w / this->size, (float)region->h / this->size);
+		this->regions += region;
+		return region;
+	}
+
+	TextureAtlas::Region* TextureAtlas::add(chstr name, Image* image)
+	{
+		Image::View src(image->data, image->w, image->h, image->format);
+		src.palette = image->palette;
+		return this->add(name, src);
+	}
+
+	TextureAtlas::Region* TextureAtlas::addFromResource(chstr filename)
+	{
+		Image* image = Image::createFromResource(filename, this->texture->getFormat());
+		if (image == NULL)
+		{
+			hlog::error(april::logTag, "Failed to load image for texture atlas: " + filename);
+			return NULL;
+		}
+		Region* region = this->add(filename, image);
+		delete image;
+		return region;
+	}
+
+	TextureAtlas::Region* TextureAtlas::addFromFile(chstr filename)
+	{
+		Image* image = Image::createFromFile(filename, this->texture->getFormat());
+		if (image == NULL)
+		{
+			hlog::error(april::logTag, "Failed to load image for texture atlas: " + filename);
+			return NULL;
+		}
+		Region* region = this->add(filename, image);
+		delete image;
+		return region;
+	}
+
+	void TextureAtlas::clear()
+	{
+		foreach (Region*, it, this->regions)
+		{
+			delete (*it);
+		}
+		this->regions.clear();
+		this->skyline.clear();
+		Node node;
+		node.x = 0;
+		node.y = 0;
+		node.w = this->size;
+		this->skyline += node;
+		this->usedArea = 0;
+		this->texture->clear();
+	}
+
+	void TextureAtlas::_findPosition(int w, int h, int& x, int& y, int& index)
+	{
+		index = -1;
+		int bestTop = this->size + 1;
+		int bestWidth = 0;
+		int top = 0;
+		int remaining = 0;
+		int count = this->skyline.size();
+		for_iter (i, 0, count)
+		{
+			if (this->skyline[i].x + w > this->size)
+			{
+				break;
+			}
+			// the rect rests on the highest node it spans
+			top = 0;
+			remaining = w;
+			for (int j = i; remaining > 0; ++j)
+			{
+				top = hmax(top, this->skyline[j].y);
+				remaining -= this->skyline[j].w;
+			}
+			if (top + h > this->size)
+			{
+				continue;
+			}
+			// lowest top edge first, the narrower node on ties leaves wider gaps for larger images
+			if (top + h < bestTop || (top + h == bestTop && this->skyline[i].w < bestWidth))
+			{
+				bestTop = top + h;
+				bestWidth = this->skyline[i].w;
+				index = i;
+				x = this->skyline[i].x;
+				y = top;
+			}
+		}
+	}
+
+	void TextureAtlas::_addRect(int index, int x, int y, int w, int h)
+	{
+		Node node;
+		node.x = x;
+		node.y = y + h;
+		node.w = w;
+		this->skyline.insert_at(index, node);
+		// nodes under the new one are shortened or removed
+		int right = x + w;
+		int i = index + 1;
+		while (i < this->skyline.size() && this->skyline[i].x < right)
+		{
+			if (this->skyline[i].x + this->skyline[i].w <= right)
+			{
+				this->skyline.remove_at(i);
+				continue;
+			}
+			this->skyline[i].w -= right - this->skyline[i].x;
+			this->skyline[i].x = right;
+			break;
+		}
+		// neighbors at the same height are merged so the skyline stays short
+		i = 0;
+		while (i < this->skyline.size() - 1)
+		{
+			if (this->skyline[i].y == this->skyline[i + 1].y)
+			{
+				this->skyline[i].w += this->skyline[i + 1].w;
+				this->skyline.remove_at(i + 1);
+				continue;
+			}
+			++i;
+		}
+	}
+
+}
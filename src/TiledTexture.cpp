@@ -0,0 +1,233 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/harray.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+#include "april.h"
+#include "Color.h"
+#include "Image.h"
+#include "RenderSystem.h"
+#include "Texture.h"
+#include "TiledTexture.h"
+
+// rows decoded at once, keeps the RAM needed for loading at a few MB even for very wide images
+#define BAND_HEIGHT 64
+
+namespace april
+{
+	// a single tile doesn't need a border, otherwise each tile shares 1 pixel with its neighbors so linear filtering doesn't show seams
+	static void _getTileLayout(int size, int tileSize, int& step, int& count)
+	{
+		if (size <= tileSize)
+		{
+			step = size;
+			count = 1;
+			return;
+		}
+		step = tileSize - 2;
+		count = (size + step - 1) / step;
+	}
+
+	static void _getTileSpan(int index, int count, int step, int size, int& start, int& length)
+	{
+		start = index * step;
+		int end = hmin(start + step, size);
+		if (count > 1)
+		{
+			start = hmax(start - 1, 0);
+			end = hmin(end + 1, size);
+		}
+		length = end - start;
+	}
+
+	TiledTexture::TiledTexture(chstr filename, bool fromResource, Image::Format format, int tileSize)
+	{
+		this->filename = filename;
+		this->format = format;
+		this->fromResource = fromResource;
+		this->tileSize = tileSize;
+		this->width = 0;
+		this->height = 0;
+		this->columns = 0;
+		this->rows = 0;
+		this->stepWidth = 0;
+		this->stepHeight = 0;
+		this->filter = Texture::FILTER_LINEAR;
+		april::rendersys->tiledTextures += this;
+	}
+
+	TiledTexture::~TiledTexture()
+	{
+		this->unload();
+		april::rendersys->tiledTextures -= this;
+	}
+
+	void TiledTexture::setFilter(Texture::Filter value)
+	{
+		this->filter = value;
+		foreach (Texture*, it, this->tiles)
+		{
+			(*it)->setFilter(value);
+		}
+	}
+
+	int TiledTexture::getWidth()
+	{
+		if (this->width == 0)
+		{
+			Image::Info info;
+			this->_probeSize(info);
+		}
+		return this->width;
+	}
+
+	int TiledTexture::getHeight()
+	{
+		if (this->height == 0)
+		{
+			Image::Info info;
+			this->_probeSize(info);
+		}
+		return this->height;
+	}
+
+	Texture* TiledTexture::getTile(int column, int row)
+	{
+		if (!this->isLoaded() || column < 0 || column >= this->columns || row < 0 || row >= this->rows)
+		{
+			return NULL;
+		}
+		return this->tiles[row * this->columns + column];
+	}
+
+	bool TiledTexture::isLoaded()
+	{
+		return (this->tiles.size() > 0);
+	}
+
+	bool TiledTexture::load()
+	{
+		if (this->isLoaded())
+		{
+			return true;
+		}
+		hlog::write(april::logTag, "Loading tiled texture: " + this->filename);
+		Image::Info info;
+		if (!this->_probeSize(info))
+		{
+			hlog::error(april::logTag, "Failed to load tiled texture: " + this->filename);
+			return false;
+		}
+		// decoding straight into the GPU's format allows the rows to be uploaded without another copy
+		Image::Format format = april::rendersys->getNativeTextureFormat(this->format != Image::FORMAT_INVALID ? this->format : info.format);
+		Texture* tile = NULL;
+		int x = 0;
+		int y = 0;
+		int w = 0;
+		int h = 0;
+		for_iter (j, 0, this->rows)
+		{
+			for_iter (i, 0, this->columns)
+			{
+				this->_getTileRect(i, j, x, y, w, h);
+				tile = april::rendersys->createTexture(w, h, Color::Clear, format, Texture::TYPE_VOLATILE);
+				if (tile == NULL)
+				{
+					hlog::error(april::logTag, "Failed to create tile for tiled texture: " + this->filename);
+					this->unload();
+					return false;
+				}
+				// the border only works if sampling doesn't wrap around to the other side of the tile
+				tile->setAddressMode(Texture::ADDRESS_CLAMP);
+				tile->setFilter(this->filter);
+				this->tiles += tile;
+			}
+		}
+		if (!(this->fromResource ? Image::readBandsFromResource(this->filename, format, BAND_HEIGHT, &TiledTexture::_writeBand, this) :
+			Image::readBandsFromFile(this->filename, format, BAND_HEIGHT, &TiledTexture::_writeBand, this)))
+		{
+			hlog::error(april::logTag, "Failed to load tiled texture: " + this->filename);
+			this->unload();
+			return false;
+		}
+		return true;
+	}
+
+	void TiledTexture::unload()
+	{
+		if (this->tiles.size() > 0)
+		{
+			hlog::write(april::logTag, "Unloading tiled texture: " + this->filename);
+			foreach (Texture*, it, this->tiles)
+			{
+				delete (*it);
+			}
+			this->tiles.clear();
+		}
+	}
+
+	bool TiledTexture::_probeSize(Image::Info& info)
+	{
+		if (!(this->fromResource ? Image::probeResource(this->filename, info) : Image::probeFile(this->filename, info)))
+		{
+			return false;
+		}
+		this->width = info.w;
+		this->height = info.h;
+		_getTileLayout(this->width, this->tileSize, this->stepWidth, this->columns);
+		_getTileLayout(this->height, this->tileSize, this->stepHeight, this->rows);
+		return true;
+	}
+
+	void TiledTexture::_getTileRect(int column, int row, int& x, int& y, int& w, int& h)
+	{
+		_getTileSpan(column, this->columns, this->stepWidth, this->width, x, w);
+		_getTileSpan(row, this->rows, this->stepHeight, this->height, y, h);
+	}
+
+	bool TiledTexture::_writeBand(const Image::View& band, int y, void* args)
+	{
+		TiledTexture* texture = (TiledTexture*)args;
+		if (band.w != texture->width || y + band.h > texture->height)
+		{
+			hlog::error(april::logTag, "Image size doesn't match the file header: " + texture->filename);
+			return false;
+		}
+		int tileX = 0;
+		int tileY = 0;
+		int tileWidth = 0;
+		int tileHeight = 0;
+		int start = 0;
+		int end = 0;
+		for_iter (j, 0, texture->rows)
+		{
+			_getTileSpan(j, texture->rows, texture->stepHeight, texture->height, tileY, tileHeight);
+			start = hmax(tileY, y);
+			end = hmin(tileY + tileHeight, y + band.h);
+			if (start >= end)
+			{
+				continue;
+			}
+			// border rows are written into both tiles that share them
+			for_iter (i, 0, texture->columns)
+			{
+				_getTileSpan(i, texture->columns, texture->stepWidth, texture->width, tileX, tileWidth);
+				if (!texture->tiles[j * texture->columns + i]->write(tileX, start - y, tileWidth, end - start, 0, start - tileY, band))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+}
@@ -549,6 +549,10 @@ namespace april
 
 	void Window::handleLowMemoryWarning()
 	{
+		if (april::rendersys != NULL && april::rendersys->getTextureMemoryBudget() > 0)
+		{
+			april::rendersys->trimTextureMemory(april::rendersys->getLowMemoryTextureBudget());
+		}
 		if (this->systemDelegate != NULL)
 		{
 			this->systemDelegate->onLowMemoryWarning();
@@ -28,7 +28,9 @@
 #include <hltypes/hstring.h>
 
 #include "april.h"
+#include "Image.h"
 #include "RenderSystem.h"
+#include "Texture.h"
 #ifdef _DIRECTX9
 #include "DirectX9_RenderSystem.h"
 #endif
@@ -182,6 +184,8 @@ namespace april
 		extensions += ".jpt";
 		extensions += ".png";
 		extensions += ".jpg";
+		extensions += ".ktx";
+		extensions += ".dds";
 #if TARGET_OS_IPHONE
 		extensions += ".pvr";
 #endif
@@ -376,6 +380,8 @@ namespace april
 		{
 			hlog::write(april::logTag, "Destroying APRIL.");
 		}
+		// decoding threads must not outlive the textures and the render system
+		Texture::destroyAsyncThreads();
 		if (april::window != NULL)
 		{
 			april::window->unassign();
@@ -402,6 +408,7 @@ namespace april
 			april::egl = NULL;
 		}
 #endif
+		Image::destroyThreads();
 	}
 	
 	void addTextureExtension(chstr extension)
@@ -19,12 +19,21 @@
 #include "april.h"
 #include "Color.h"
 #include "Image.h"
+#include "ImagePacked.h"
 #include "RenderSystem.h"
 
 #ifdef __APPLE__
 #include <TargetConditionals.h>
 #endif
 
+#if defined(_LINUX) || defined(__linux__) || (defined(__APPLE__) && !TARGET_OS_IPHONE)
+#define _IMAGE_FILE_MAPPING
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define CHECK_SHIFT_FORMATS(format1, format2) (\
 	((format1) == FORMAT_RGBA || (format1) == FORMAT_RGBX || (format1) == FORMAT_BGRA || (format1) == FORMAT_BGRX) && \
 	((format2) == FORMAT_ARGB || (format2) == FORMAT_XRGB || (format2) == FORMAT_ABGR || (format2) == FORMAT_XBGR) \
@@ -35,37 +44,43 @@
 )
 #define CHECK_LEFT_RGB(format) \
 	((format) == FORMAT_RGBA || (format) == FORMAT_RGBX || (format) == FORMAT_BGRA || (format) == FORMAT_BGRX)
+#define CHECK_PREMULTIPLIED_FORMAT(format) \
+	((format) == FORMAT_RGBA_PREMULTIPLIED || (format) == FORMAT_BGRA_PREMULTIPLIED)
 #define CHECK_ALPHA_FORMAT(format) \
-	((format) == FORMAT_RGBA || (format) == FORMAT_ARGB || (format) == FORMAT_BGRA || (format) == FORMAT_ABGR)
+	((format) == FORMAT_RGBA || (format) == FORMAT_ARGB || (format) == FORMAT_BGRA || (format) == FORMAT_ABGR || CHECK_PREMULTIPLIED_FORMAT(format))
 
 #define FOR_EACH_4BPP_PIXEL(macro) \
 	for_iterx (y, 0, h) \
 	{ \
+		srcRow = (unsigned int*)&srcData[y * srcPitch]; \
+		destRow = (unsigned int*)&destData[y * destPitch]; \
 		for_iterx (x, 0, w) \
 		{ \
-			i = (x + y * w); \
-			dest[i] = macro(src[i]); \
+			destRow[x] = macro(srcRow[x]); \
 		} \
 	}
 #define FOR_EACH_3BPP_TO_4BPP_PIXEL(exec) \
 	for_iterx (y, 0, h) \
 	{ \
+		srcRow = &srcData[y * srcPitch]; \
+		destRow = (unsigned int*)&destData[y * destPitch]; \
 		for_iterx (x, 0, w) \
 		{ \
-			i = (x + y * w) * srcBpp; \
-			dest[x + y * w] = (exec); \
+			i = x * srcBpp; \
+			destRow[x] = (exec); \
 		} \
 	}
 #define FOR_EACH_4BPP_TO_3BPP_PIXEL(exec1, exec2, exec3) \
 	for_iterx (y, 0, h) \
 	{ \
+		srcRow = (unsigned int*)&srcData[y * srcPitch]; \
+		destRow = &destData[y * destPitch]; \
 		for_iterx (x, 0, w) \
 		{ \
-			i = x + y * w; \
-			j = (x + y * w) * destBpp; \
-			dest[j] = (unsigned char)(exec1); \
-			dest[j + 1] = (unsigned char)(exec2); \
-			dest[j + 2] = (unsigned char)(exec3); \
+			j = x * destBpp; \
+			destRow[j] = (unsigned char)(exec1); \
+			destRow[j + 1] = (unsigned char)(exec2); \
+			destRow[j + 2] = (unsigned char)(exec3); \
 		} \
 	}
 
@@ -107,14 +122,129 @@ namespace april
 	Image* _tryLoadingPVR(chstr filename);
 #endif
 
+#ifdef _IMAGE_FILE_MAPPING
+	/// @brief Maps a whole file read-only into memory so decoders can read it without copying.
+	/// @note data is NULL if the file couldn't be mapped.
+	class FileMapping
+	{
+	public:
+		unsigned char* data;
+		int size;
+
+		FileMapping(chstr filename)
+		{
+			this->data = NULL;
+			this->size = 0;
+			int fd = open(filename.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				return;
+			}
+			struct stat info;
+			if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && info.st_size <= 0x7FFFFFFF)
+			{
+				void* mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped != MAP_FAILED)
+				{
+					// the kernel can page in the file while the decoder is being set up
+					madvise(mapped, (size_t)info.st_size, MADV_WILLNEED);
+					this->data = (unsigned char*)mapped;
+					this->size = (int)info.st_size;
+				}
+			}
+			close(fd); // the mapping stays valid after the descriptor is closed
+		}
+
+		~FileMapping()
+		{
+			if (this->data != NULL)
+			{
+				munmap(this->data, (size_t)this->size);
+			}
+		}
+
+	};
+#endif
+
+	Image::View::View()
+	{
+		this->data = NULL;
+		this->w = 0;
+		this->h = 0;
+		this->pitch = 0;
+		this->format = FORMAT_INVALID;
+		this->palette = NULL;
+	}
+
+	Image::View::View(unsigned char* data, int w, int h, Format format)
+	{
+		this->data = data;
+		this->w = w;
+		this->h = h;
+		this->pitch = w * Image::getFormatBpp(format);
+		this->format = format;
+		this->palette = NULL;
+	}
+
+	Image::View::View(unsigned char* data, int w, int h, int pitch, Format format)
+	{
+		this->data = data;
+		this->w = w;
+		this->h = h;
+		this->pitch = pitch;
+		this->format = format;
+		this->palette = NULL;
+	}
+
+	Image::View::~View()
+	{
+	}
+
+	int Image::View::getBpp() const
+	{
+		return Image::getFormatBpp(this->format);
+	}
+
+	bool Image::View::isContiguous() const
+	{
+		return (this->pitch == this->w * Image::getFormatBpp(this->format));
+	}
+
+	unsigned char* Image::View::getPixelData(int x, int y) const
+	{
+		return &this->data[y * this->pitch + x * Image::getFormatBpp(this->format)];
+	}
+
+	Image::View Image::View::getSubView(int x, int y, int w, int h) const
+	{
+		View view(this->getPixelData(x, y), w, h, this->pitch, this->format);
+		view.palette = this->palette;
+		return view;
+	}
+
+	Image::Info::Info()
+	{
+		this->w = 0;
+		this->h = 0;
+		this->channels = 0;
+		this->bitDepth = 0;
+		this->format = FORMAT_INVALID;
+	}
+
+	Image::Info::~Info()
+	{
+	}
+
 	Image::Image()
 	{
 		this->data = NULL;
 		this->w = 0;
 		this->h = 0;
 		this->format = FORMAT_INVALID;
+		this->palette = NULL;
 		this->internalFormat = 0;
 		this->compressedSize = 0;
+		this->mipmapLevels = 1;
 	}
 	
 	Image::~Image()
@@ -123,6 +253,10 @@ namespace april
 		{
 			delete [] this->data;
 		}
+		if (this->palette != NULL)
+		{
+			delete [] this->palette;
+		}
 	}
 
 	int Image::getBpp()
@@ -150,64 +284,100 @@ namespace april
 		return (result);
 	}
 
+	Image::View Image::getView()
+	{
+		View view(this->data, this->w, this->h, this->format);
+		view.palette = this->palette;
+		return view;
+	}
+
+	Image::View Image::getView(int x, int y, int w, int h)
+	{
+		if (!Image::correctRect(x, y, w, h, this->w, this->h))
+		{
+			return View();
+		}
+		return this->getView().getSubView(x, y, w, h);
+	}
+
 	Color Image::getPixel(int x, int y)
 	{
-		return (this->isValid() ? Image::getPixel(x, y, this->data, this->w, this->h, this->format) : Color::Clear);
+		return (this->isValid() ? Image::getPixel(x, y, this->getView()) : Color::Clear);
 	}
 	
 	bool Image::setPixel(int x, int y, Color color)
 	{
-		return (this->isValid() && Image::setPixel(x, y, color, this->data, this->w, this->h, this->format));
+		return (this->isValid() && Image::setPixel(x, y, color, this->getView()));
 	}
 	
 	Color Image::getInterpolatedPixel(float x, float y)
 	{
-		return (this->isValid() ? Image::getInterpolatedPixel(x, y, this->data, this->w, this->h, this->format) : Color::Clear);
+		return (this->isValid() ? Image::getInterpolatedPixel(x, y, this->getView()) : Color::Clear);
 	}
 	
+	bool Image::getPixels(int x, int y, int w, int h, Color* output)
+	{
+		return (this->isValid() && Image::getPixels(x, y, w, h, output, this->getView()));
+	}
+
+	bool Image::setPixels(int x, int y, int w, int h, Color* colors)
+	{
+		return (this->isValid() && Image::setPixels(x, y, w, h, colors, this->getView()));
+	}
+
+	bool Image::getPixels(gvec2* positions, int count, Color* output)
+	{
+		return (this->isValid() && Image::getPixels(positions, count, output, this->getView()));
+	}
+
+	bool Image::setPixels(gvec2* positions, int count, Color* colors)
+	{
+		return (this->isValid() && Image::setPixels(positions, count, colors, this->getView()));
+	}
+
 	bool Image::fillRect(int x, int y, int w, int h, Color color)
 	{
-		return (this->isValid() && Image::fillRect(x, y, w, h, color, this->data, this->w, this->h, this->format));
+		return (this->isValid() && Image::fillRect(x, y, w, h, color, this->getView()));
 	}
 
 	bool Image::copyPixelData(unsigned char** output, Format format)
 	{
-		return (this->isValid() && Image::convertToFormat(this->w, this->h, this->data, this->format, output, format, false));
+		return (this->isValid() && Image::convertToFormat(this->getView(), output, format, false));
 	}
 
 	bool Image::write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
 	{
-		return (this->isValid() && Image::write(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, this->data, this->w, this->h, this->format));
+		return (this->isValid() && Image::write(sx, sy, sw, sh, dx, dy, View(srcData, srcWidth, srcHeight, srcFormat), this->getView()));
 	}
 
-	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, Filter filter)
 	{
-		return (this->isValid() && Image::writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, srcData, srcWidth, srcHeight, srcFormat, this->data, this->w, this->h, this->format));
+		return (this->isValid() && Image::writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, View(srcData, srcWidth, srcHeight, srcFormat), this->getView(), filter));
 	}
 
 	bool Image::blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
 	{
-		return (this->isValid() && Image::blit(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, this->data, this->w, this->h, this->format, alpha));
+		return (this->isValid() && Image::blit(sx, sy, sw, sh, dx, dy, View(srcData, srcWidth, srcHeight, srcFormat), this->getView(), alpha));
 	}
 
-	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
+	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha, Filter filter)
 	{
-		return (this->isValid() && Image::blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, srcData, srcWidth, srcHeight, srcFormat, this->data, this->w, this->h, this->format, alpha));
+		return (this->isValid() && Image::blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, View(srcData, srcWidth, srcHeight, srcFormat), this->getView(), alpha, filter));
 	}
 
 	bool Image::rotateHue(int x, int y, int w, int h, float degrees)
 	{
-		return (this->isValid() && Image::rotateHue(x, y, w, h, degrees, this->data, this->w, this->h, this->format));
+		return (this->isValid() && Image::rotateHue(x, y, w, h, degrees, this->getView()));
 	}
 
 	bool Image::saturate(int x, int y, int w, int h, float factor)
 	{
-		return (this->isValid() && Image::saturate(x, y, w, h, factor, this->data, this->w, this->h, this->format));
+		return (this->isValid() && Image::saturate(x, y, w, h, factor, this->getView()));
 	}
 
 	bool Image::insertAlphaMap(unsigned char* srcData, Format srcFormat, unsigned char median, int ambiguity)
 	{
-		return (this->isValid() && Image::insertAlphaMap(this->w, this->h, srcData, srcFormat, this->data, this->format, median, ambiguity));
+		return (this->isValid() && Image::insertAlphaMap(View(srcData, this->w, this->h, srcFormat), this->getView(), median, ambiguity));
 	}
 
 	// overloads
@@ -227,6 +397,16 @@ namespace april
 		return this->getInterpolatedPixel(position.x, position.y);
 	}
 	
+	bool Image::getPixels(grect rect, Color* output)
+	{
+		return this->getPixels(HROUND_GRECT(rect), output);
+	}
+
+	bool Image::setPixels(grect rect, Color* colors)
+	{
+		return this->setPixels(HROUND_GRECT(rect), colors);
+	}
+
 	bool Image::copyPixelData(unsigned char** output)
 	{
 		return (this->data != NULL && Image::convertToFormat(this->w, this->h, this->data, this->format, output, this->format, false));
@@ -239,7 +419,7 @@ namespace april
 
 	bool Image::write(int sx, int sy, int sw, int sh, int dx, int dy, Image* other)
 	{
-		return this->write(sx, sy, sw, sh, dx, dy, other->data, other->w, other->h, other->format);
+		return (this->isValid() && Image::write(sx, sy, sw, sh, dx, dy, other->getView(), this->getView()));
 	}
 
 	bool Image::write(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
@@ -249,27 +429,27 @@ namespace april
 
 	bool Image::write(grect srcRect, gvec2 destPosition, Image* other)
 	{
-		return this->write(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), other->data, other->w, other->h, other->format);
+		return this->write(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), other);
 	}
 
-	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other)
+	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other, Filter filter)
 	{
-		return this->writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, other->data, other->w, other->h, other->format);
+		return (this->isValid() && Image::writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, other->getView(), this->getView(), filter));
 	}
 
-	bool Image::writeStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool Image::writeStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, Filter filter)
 	{
-		return this->writeStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), srcData, srcWidth, srcHeight, srcFormat);
+		return this->writeStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), srcData, srcWidth, srcHeight, srcFormat, filter);
 	}
 
-	bool Image::writeStretch(grect srcRect, grect destRect, Image* other)
+	bool Image::writeStretch(grect srcRect, grect destRect, Image* other, Filter filter)
 	{
-		return this->writeStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), other->data, other->w, other->h, other->format);
+		return this->writeStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), other, filter);
 	}
 
 	bool Image::blit(int sx, int sy, int sw, int sh, int dx, int dy, Image* other, unsigned char alpha)
 	{
-		return this->blit(sx, sy, sw, sh, dx, dy, other->data, other->w, other->h, other->format, alpha);
+		return (this->isValid() && Image::blit(sx, sy, sw, sh, dx, dy, other->getView(), this->getView(), alpha));
 	}
 
 	bool Image::blit(grect srcRect, gvec2 destPosition, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
@@ -279,22 +459,22 @@ namespace april
 
 	bool Image::blit(grect srcRect, gvec2 destPosition, Image* other, unsigned char alpha)
 	{
-		return this->blit(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), other->data, other->w, other->h, other->format, alpha);
+		return this->blit(HROUND_GRECT(srcRect), HROUND_GVEC2(destPosition), other, alpha);
 	}
 
-	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other, unsigned char alpha)
+	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, Image* other, unsigned char alpha, Filter filter)
 	{
-		return this->blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, other->data, other->w, other->h, other->format, alpha);
+		return (this->isValid() && Image::blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, other->getView(), this->getView(), alpha, filter));
 	}
 
-	bool Image::blitStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha)
+	bool Image::blitStretch(grect srcRect, grect destRect, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat, unsigned char alpha, Filter filter)
 	{
-		return this->blitStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), srcData, srcWidth, srcHeight, srcFormat);
+		return this->blitStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), srcData, srcWidth, srcHeight, srcFormat, alpha, filter);
 	}
 
-	bool Image::blitStretch(grect srcRect, grect destRect, Image* other, unsigned char alpha)
+	bool Image::blitStretch(grect srcRect, grect destRect, Image* other, unsigned char alpha, Filter filter)
 	{
-		return this->blitStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), other->data, other->w, other->h, other->format, alpha);
+		return this->blitStretch(HROUND_GRECT(srcRect), HROUND_GRECT(destRect), other, alpha, filter);
 	}
 
 	bool Image::rotateHue(grect rect, float degrees)
@@ -309,28 +489,57 @@ namespace april
 
 	bool Image::insertAlphaMap(Image* image, Image::Format srcFormat, unsigned char median, int ambiguity)
 	{
-		return this->insertAlphaMap(image->data, image->format, median, ambiguity);
+		return (this->isValid() && image->w == this->w && image->h == this->h && Image::insertAlphaMap(image->getView(), this->getView(), median, ambiguity));
 	}
 
 	// loading/creating functions
 
 	Image* Image::createFromResource(chstr filename)
 	{
+		return Image::createFromResource(filename, FORMAT_INVALID);
+	}
+
+	Image* Image::createFromResource(chstr filename, Image::Format format)
+	{
+		return Image::createFromResource(filename, format, 1);
+	}
+
+	Image* Image::createFromResource(chstr filename, Image::Format format, int downscale)
+	{
+		if (downscale != 1 && downscale != 2 && downscale != 4 && downscale != 8)
+		{
+			hlog::errorf(april::logTag, "Cannot downscale image by %d, only 1, 2, 4 and 8 are supported!", downscale);
+			return NULL;
+		}
+		if (Image::_isCacheable(filename))
+		{
+			return Image::_loadCached(filename, true, format, downscale);
+		}
 		Image* image = NULL;
 		if (filename.lower().ends_with(".png"))
 		{
 			hresource f(filename);
-			image = Image::_loadPng(f);
+			image = Image::_loadPng(f, format, downscale);
 		}
 		else if (filename.lower().ends_with(".jpg") || filename.lower().ends_with(".jpeg"))
 		{
 			hresource f(filename);
-			image = Image::_loadJpg(f);
+			image = Image::_loadJpg(f, format, downscale);
 		}
 		else if (filename.lower().ends_with(".jpt"))
 		{
 			hresource f(filename);
-			image = Image::_loadJpt(f);
+			image = Image::_loadJpt(f, format, downscale);
+		}
+		else if (filename.lower().ends_with(".ktx"))
+		{
+			hresource f(filename);
+			image = Image::_loadKtx(f);
+		}
+		else if (filename.lower().ends_with(".dds"))
+		{
+			hresource f(filename);
+			image = Image::_loadDds(f);
 		}
 #if TARGET_OS_IPHONE
 		else if (filename.lower().ends_with(".pvr"))
@@ -339,42 +548,85 @@ namespace april
 			image = _tryLoadingPVR(filename);
 		}
 #endif
-		return image;
+		return Image::_finishLoading(image, format);
 	}
 
-	Image* Image::createFromResource(chstr filename, Image::Format format)
+	Image* Image::createFromFile(chstr filename)
 	{
-		Image* image = Image::createFromResource(filename);
-		if (image != NULL && Image::needsConversion(image->format, format))
-		{
-			unsigned char* data = NULL;
-			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, format))
-			{
-				delete [] image->data;
-				image->format = format;
-				image->data = data;
-			}
-		}
-		return image;
+		return Image::createFromFile(filename, FORMAT_INVALID);
 	}
 
-	Image* Image::createFromFile(chstr filename)
+	Image* Image::createFromFile(chstr filename, Image::Format format)
+	{
+		return Image::createFromFile(filename, format, 1);
+	}
+
+	Image* Image::createFromFile(chstr filename, Image::Format format, int downscale)
 	{
+		if (downscale != 1 && downscale != 2 && downscale != 4 && downscale != 8)
+		{
+			hlog::errorf(april::logTag, "Cannot downscale image by %d, only 1, 2, 4 and 8 are supported!", downscale);
+			return NULL;
+		}
+		if (Image::_isCacheable(filename))
+		{
+			return Image::_loadCached(filename, false, format, downscale);
+		}
 		Image* image = NULL;
 		if (filename.lower().ends_with(".png"))
 		{
-			hfile f(filename);
-			image = Image::_loadPng(f);
+#ifdef _IMAGE_FILE_MAPPING
+			FileMapping mapping(filename);
+			if (mapping.data != NULL)
+			{
+				image = Image::_loadPng(mapping.data, mapping.size, format, downscale);
+			}
+			else
+#endif
+			{
+				hfile f(filename);
+				image = Image::_loadPng(f, format, downscale);
+			}
 		}
 		else if (filename.lower().ends_with(".jpg") || filename.lower().ends_with(".jpeg"))
 		{
-			hfile f(filename);
-			image = Image::_loadJpg(f);
+#ifdef _IMAGE_FILE_MAPPING
+			FileMapping mapping(filename);
+			if (mapping.data != NULL)
+			{
+				image = Image::_loadJpg(mapping.data, mapping.size, format, downscale);
+			}
+			else
+#endif
+			{
+				hfile f(filename);
+				image = Image::_loadJpg(f, format, downscale);
+			}
 		}
 		else if (filename.lower().ends_with(".jpt"))
 		{
+#ifdef _IMAGE_FILE_MAPPING
+			FileMapping mapping(filename);
+			if (mapping.data != NULL)
+			{
+				image = Image::_loadJpt(mapping.data, mapping.size, format, downscale);
+			}
+			else
+#endif
+			{
+				hfile f(filename);
+				image = Image::_loadJpt(f, format, downscale);
+			}
+		}
+		else if (filename.lower().ends_with(".ktx"))
+		{
+			hfile f(filename);
+			image = Image::_loadKtx(f);
+		}
+		else if (filename.lower().ends_with(".dds"))
+		{
 			hfile f(filename);
-			image = Image::_loadJpt(f);
+			image = Image::_loadDds(f);
 		}
 #if TARGET_OS_IPHONE
 		else if (filename.lower().ends_with(".pvr"))
@@ -383,13 +635,30 @@ namespace april
 			image = _tryLoadingPVR(filename);
 		}
 #endif
-		return image;
+		return Image::_finishLoading(image, format);
 	}
 
-	Image* Image::createFromFile(chstr filename, Image::Format format)
+	Image* Image::_finishLoading(Image* image, Image::Format format)
 	{
-		Image* image = Image::createFromFile(filename);
-		if (image != NULL && Image::needsConversion(image->format, format))
+		if (image != NULL && image->format == FORMAT_COMPRESSED && format != FORMAT_INVALID && format != FORMAT_COMPRESSED && format != FORMAT_PALETTE &&
+			Image::isDecompressionSupported(image->internalFormat))
+		{
+			// compressed data is only kept as it is if no specific format was requested
+			unsigned char* data = NULL;
+			if (!Image::decompress(image->w, image->h, image->data, image->internalFormat, &data, format))
+			{
+				delete image;
+				return NULL;
+			}
+			delete [] image->data;
+			image->data = data;
+			image->format = format;
+			image->internalFormat = 0;
+			image->compressedSize = 0;
+			image->mipmapLevels = 1;
+		}
+		// paletted data is only kept if the file has a palette, other files stay in their own format
+		if (image != NULL && format != FORMAT_INVALID && format != FORMAT_PALETTE && Image::needsConversion(image->format, format))
 		{
 			unsigned char* data = NULL;
 			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, format))
@@ -402,6 +671,148 @@ namespace april
 		return image;
 	}
 
+	bool Image::probeResource(chstr filename, Image::Info& info)
+	{
+		bool result = false;
+		if (filename.lower().ends_with(".png"))
+		{
+			hresource f(filename);
+			result = Image::_probePng(f, info);
+		}
+		else if (filename.lower().ends_with(".jpg") || filename.lower().ends_with(".jpeg"))
+		{
+			hresource f(filename);
+			result = Image::_probeJpg(f, info);
+		}
+		else if (filename.lower().ends_with(".jpt"))
+		{
+			hresource f(filename);
+			result = Image::_probeJpt(f, info);
+		}
+		else if (filename.lower().ends_with(".ktx"))
+		{
+			hresource f(filename);
+			result = Image::_probeKtx(f, info);
+		}
+		else if (filename.lower().ends_with(".dds"))
+		{
+			hresource f(filename);
+			result = Image::_probeDds(f, info);
+		}
+		return result;
+	}
+
+	bool Image::probeFile(chstr filename, Image::Info& info)
+	{
+		bool result = false;
+		if (filename.lower().ends_with(".png"))
+		{
+			hfile f(filename);
+			result = Image::_probePng(f, info);
+		}
+		else if (filename.lower().ends_with(".jpg") || filename.lower().ends_with(".jpeg"))
+		{
+			hfile f(filename);
+			result = Image::_probeJpg(f, info);
+		}
+		else if (filename.lower().ends_with(".jpt"))
+		{
+			hfile f(filename);
+			result = Image::_probeJpt(f, info);
+		}
+		else if (filename.lower().ends_with(".ktx"))
+		{
+			hfile f(filename);
+			result = Image::_probeKtx(f, info);
+		}
+		else if (filename.lower().ends_with(".dds"))
+		{
+			hfile f(filename);
+			result = Image::_probeDds(f, info);
+		}
+		return result;
+	}
+
+	bool Image::readBandsFromResource(chstr filename, Image::Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args)
+	{
+		if (bandHeight <= 0)
+		{
+			hlog::errorf(april::logTag, "Cannot read image in bands of %d rows!", bandHeight);
+			return false;
+		}
+		if (filename.lower().ends_with(".png"))
+		{
+			hresource f(filename);
+			return Image::_readPngBands(f, format, bandHeight, callback, args);
+		}
+		if (filename.lower().ends_with(".jpg") || filename.lower().ends_with(".jpeg"))
+		{
+			hresource f(filename);
+			return Image::_readJpgBands(f, format, bandHeight, callback, args);
+		}
+		return Image::_readBands(Image::createFromResource(filename, format), bandHeight, callback, args);
+	}
+
+	bool Image::readBandsFromFile(chstr filename, Image::Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args)
+	{
+		if (bandHeight <= 0)
+		{
+			hlog::errorf(april::logTag, "Cannot read image in bands of %d rows!", bandHeight);
+			return false;
+		}
+		if (filename.lower().ends_with(".png"))
+		{
+			hfile f(filename);
+			return Image::_readPngBands(f, format, bandHeight, callback, args);
+		}
+		if (filename.lower().ends_with(".jpg") || filename.lower().ends_with(".jpeg"))
+		{
+			hfile f(filename);
+			return Image::_readJpgBands(f, format, bandHeight, callback, args);
+		}
+		return Image::_readBands(Image::createFromFile(filename, format), bandHeight, callback, args);
+	}
+
+	bool Image::_readBands(Image* image, int bandHeight, bool (*callback)(const View&, int, void*), void* args)
+	{
+		if (image == NULL)
+		{
+			return false;
+		}
+		if (image->format == FORMAT_PALETTE || image->format == FORMAT_COMPRESSED)
+		{
+			hlog::error(april::logTag, "Cannot read this image data in bands!");
+			delete image;
+			return false;
+		}
+		View view = image->getView();
+		bool result = true;
+		for (int y = 0; y < image->h && result; y += bandHeight)
+		{
+			result = (*callback)(view.getSubView(0, y, image->w, hmin(bandHeight, image->h - y)), y, args);
+		}
+		delete image;
+		return result;
+	}
+
+	bool Image::_passBand(const View& band, int y, Image::Format format, unsigned char** convertedData, bool (*callback)(const View&, int, void*), void* args)
+	{
+		if (format == FORMAT_INVALID || format == band.format)
+		{
+			return (*callback)(band, y, args);
+		}
+		if (*convertedData == NULL)
+		{
+			*convertedData = new unsigned char[band.w * band.h * Image::getFormatBpp(format)];
+		}
+		View converted(*convertedData, band.w, band.h, format);
+		if (!Image::convertToFormat(band, converted))
+		{
+			return false;
+		}
+		return (*callback)(converted, y, args);
+	}
+
 	Image* Image::create(int w, int h, unsigned char* data, Image::Format format)
 	{
 		Image* image = new Image();
@@ -438,7 +849,14 @@ namespace april
 		image->w = other->w;
 		image->h = other->h;
 		image->format = other->format;
+		if (other->palette != NULL)
+		{
+			image->palette = new unsigned char[APRIL_PALETTE_SIZE * 4];
+			memcpy(image->palette, other->palette, APRIL_PALETTE_SIZE * 4);
+		}
+		image->internalFormat = other->internalFormat;
 		image->compressedSize = other->compressedSize;
+		image->mipmapLevels = other->mipmapLevels;
 		int size = image->getByteSize();
 		image->data = NULL;
 		if (other->data != NULL)
@@ -472,39 +890,348 @@ namespace april
 		case FORMAT_BGR:		return 3;
 		case FORMAT_ALPHA:		return 1;
 		case FORMAT_GRAYSCALE:	return 1;
+		case FORMAT_PALETTE:	return 1;
+		case FORMAT_RGB565:		return 2;
+		case FORMAT_RGBA4444:	return 2;
+		case FORMAT_RGBA5551:	return 2;
+		case FORMAT_RGBA_PREMULTIPLIED:	return 4;
+		case FORMAT_BGRA_PREMULTIPLIED:	return 4;
 		}
 		return 0;
 	}
 
+	bool Image::isPremultipliedFormat(Image::Format format)
+	{
+		return CHECK_PREMULTIPLIED_FORMAT(format);
+	}
+
 	// image data manipulation functions
 
-	Color Image::getPixel(int x, int y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
+	// rounded division by 255 without a divide, exact for all values up to 255 * 255
+	static inline unsigned char _div255(unsigned int value)
+	{
+		return (unsigned char)(((value + 128) * 257) >> 16);
+	}
+
+	// rounded inverse of premultiplying, fully transparent pixels become black
+	static inline unsigned char _unpremultiply(unsigned char value, unsigned char alpha)
+	{
+		return (alpha == 0 ? 0 : (unsigned char)hmin((value * 255 + alpha / 2) / alpha, 255));
+	}
+
+	// source-over with a premultiplied source, the source only needs a multiply if there is a global alpha
+	static inline unsigned char _blendPremultiplied(unsigned char src, unsigned char dest, unsigned char alpha, unsigned char a1)
+	{
+		return (unsigned char)hmin((alpha == 255 ? src : _div255(src * alpha)) + _div255(dest * a1), 255);
+	}
+
+	// the HSL trapezoid from hslToRgb() in 16.16 fixed point, hue is scaled by delta so "unit" is one sextant
+	static inline unsigned char _hueToChannel(int hue, int unit, int period, int min)
 	{
-		Color color = Color::Clear;
-		unsigned char* rgba = NULL;
-		if (Image::checkRect(x, y, srcWidth, srcHeight) && Image::convertToFormat(1, 1, &srcData[(x + y * srcWidth) * Image::getFormatBpp(srcFormat)], srcFormat, &rgba, Image::FORMAT_RGBA, false))
+		if (hue < 0)
+		{
+			hue += period;
+		}
+		else if (hue >= period)
+		{
+			hue -= period;
+		}
+		int value = 0;
+		if (hue < unit)
+		{
+			value = hue;
+		}
+		else if (hue < unit * 3)
 		{
-			color.r = rgba[0];
-			color.g = rgba[1];
-			color.b = rgba[2];
-			color.a = rgba[3];
-			delete [] rgba;
+			value = unit;
 		}
-		return color;
+		else if (hue < unit * 4)
+		{
+			value = unit * 4 - hue;
+		}
+		return (unsigned char)(min + ((value + 0x8000) >> 16));
+	}
+
+	static inline Image::Format _getStraightFormat(Image::Format format)
+	{
+		switch (format)
+		{
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
+			return Image::FORMAT_RGBA;
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
+			return Image::FORMAT_BGRA;
+		default:
+			break;
+		}
+		return format;
+	}
+
+	// the same data interpreted with straight alpha, lets premultiplied data go through code that only knows straight alpha
+	static inline Image::View _getStraightView(const Image::View& view)
+	{
+		return Image::View(view.data, view.w, view.h, view.pitch, _getStraightFormat(view.format));
+	}
+
+	// format-specialized single pixel access that never allocates, follows the same channel rules as convertToFormat()
+	static inline Color _readPixel(unsigned char* src, Image::Format format, unsigned char* palette)
+	{
+		switch (format)
+		{
+		case Image::FORMAT_PALETTE:
+			if (palette == NULL)
+			{
+				break;
+			}
+			src = &palette[src[0] * 4];
+			return Color(src[0], src[1], src[2], src[3]);
+		case Image::FORMAT_RGBA:
+			return Color(src[0], src[1], src[2], src[3]);
+		case Image::FORMAT_ARGB:
+			return Color(src[1], src[2], src[3], src[0]);
+		case Image::FORMAT_BGRA:
+			return Color(src[2], src[1], src[0], src[3]);
+		case Image::FORMAT_ABGR:
+			return Color(src[3], src[2], src[1], src[0]);
+		case Image::FORMAT_RGBX:
+		case Image::FORMAT_RGB:
+			return Color(src[0], src[1], src[2], (unsigned char)255);
+		case Image::FORMAT_XRGB:
+			return Color(src[1], src[2], src[3], (unsigned char)255);
+		case Image::FORMAT_BGRX:
+		case Image::FORMAT_BGR:
+			return Color(src[2], src[1], src[0], (unsigned char)255);
+		case Image::FORMAT_XBGR:
+			return Color(src[3], src[2], src[1], (unsigned char)255);
+		case Image::FORMAT_ALPHA:
+		case Image::FORMAT_GRAYSCALE:
+			return Color(src[0], src[0], src[0], (unsigned char)255);
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
+			return Color(_unpremultiply(src[0], src[3]), _unpremultiply(src[1], src[3]), _unpremultiply(src[2], src[3]), src[3]);
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
+			return Color(_unpremultiply(src[2], src[3]), _unpremultiply(src[1], src[3]), _unpremultiply(src[0], src[3]), src[3]);
+		case Image::FORMAT_RGB565:
+		case Image::FORMAT_RGBA4444:
+		case Image::FORMAT_RGBA5551:
+			return _readPackedPixel(src, format);
+		default:
+			break;
+		}
+		return Color::Clear;
+	}
+
+	static inline bool _writePixel(unsigned char* dest, Image::Format format, const Color& color)
+	{
+		switch (format)
+		{
+		case Image::FORMAT_RGBA:
+		case Image::FORMAT_RGBX:
+			dest[0] = color.r;
+			dest[1] = color.g;
+			dest[2] = color.b;
+			dest[3] = (format == Image::FORMAT_RGBA ? color.a : 255);
+			return true;
+		case Image::FORMAT_ARGB:
+		case Image::FORMAT_XRGB:
+			dest[0] = (format == Image::FORMAT_ARGB ? color.a : 255);
+			dest[1] = color.r;
+			dest[2] = color.g;
+			dest[3] = color.b;
+			return true;
+		case Image::FORMAT_BGRA:
+		case Image::FORMAT_BGRX:
+			dest[0] = color.b;
+			dest[1] = color.g;
+			dest[2] = color.r;
+			dest[3] = (format == Image::FORMAT_BGRA ? color.a : 255);
+			return true;
+		case Image::FORMAT_ABGR:
+		case Image::FORMAT_XBGR:
+			dest[0] = (format == Image::FORMAT_ABGR ? color.a : 255);
+			dest[1] = color.b;
+			dest[2] = color.g;
+			dest[3] = color.r;
+			return true;
+		case Image::FORMAT_RGB:
+			dest[0] = color.r;
+			dest[1] = color.g;
+			dest[2] = color.b;
+			return true;
+		case Image::FORMAT_BGR:
+			dest[0] = color.b;
+			dest[1] = color.g;
+			dest[2] = color.r;
+			return true;
+		case Image::FORMAT_ALPHA:
+		case Image::FORMAT_GRAYSCALE:
+			// red is used as main component
+			dest[0] = color.r;
+			return true;
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
+			dest[0] = _div255(color.r * color.a);
+			dest[1] = _div255(color.g * color.a);
+			dest[2] = _div255(color.b * color.a);
+			dest[3] = color.a;
+			return true;
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
+			dest[0] = _div255(color.b * color.a);
+			dest[1] = _div255(color.g * color.a);
+			dest[2] = _div255(color.r * color.a);
+			dest[3] = color.a;
+			return true;
+		case Image::FORMAT_RGB565:
+		case Image::FORMAT_RGBA4444:
+		case Image::FORMAT_RGBA5551:
+			_writePackedPixel(dest, format, color);
+			return true;
+		default:
+			break;
+		}
+		return false;
+	}
+
+	// copies pixel rows between two views of the same format and size, in one go if both are tightly packed
+	static inline void _copyRows(const Image::View& src, const Image::View& dest)
+	{
+		int rowSize = src.w * src.getBpp();
+		if (src.isContiguous() && dest.isContiguous())
+		{
+			memcpy(dest.data, src.data, rowSize * src.h);
+			return;
+		}
+		for_iter (j, 0, src.h)
+		{
+			memcpy(&dest.data[j * dest.pitch], &src.data[j * src.pitch], rowSize);
+		}
+	}
+
+	// palette indices can't be blended or color-manipulated, only copied
+	static inline bool _isPaletteView(const Image::View& view)
+	{
+		if (view.format == Image::FORMAT_PALETTE)
+		{
+			hlog::error(april::logTag, "This operation is not supported for paletted image data!");
+			return true;
+		}
+		return false;
+	}
+
+	// the colors of a paletted or 16 bit region in a temporary RGBA buffer, for code that needs whole channels
+	static Image::View _expandToRgba(int sx, int sy, int sw, int sh, const Image::View& src)
+	{
+		Image::View expanded(new unsigned char[sw * sh * 4], sw, sh, Image::FORMAT_RGBA);
+		if (!Image::convertToFormat(src.getSubView(sx, sy, sw, sh), expanded))
+		{
+			delete [] expanded.data;
+			return Image::View();
+		}
+		return expanded;
+	}
+
+	Color Image::getPixel(int x, int y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
+	{
+		return Image::getPixel(x, y, View(srcData, srcWidth, srcHeight, srcFormat));
 	}
 	
 	bool Image::setPixel(int x, int y, Color color, unsigned char* destData, int destWidth, int destHeight, Format destFormat)
 	{
-		if (!Image::checkRect(x, y, destWidth, destHeight))
+		return Image::setPixel(x, y, color, View(destData, destWidth, destHeight, destFormat));
+	}
+
+	Color Image::getInterpolatedPixel(float x, float y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
+	{
+		return Image::getInterpolatedPixel(x, y, View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Image::getPixels(int x, int y, int w, int h, Color* output, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
+	{
+		return Image::getPixels(x, y, w, h, output, View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Image::setPixels(int x, int y, int w, int h, Color* colors, unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	{
+		return Image::setPixels(x, y, w, h, colors, View(destData, destWidth, destHeight, destFormat));
+	}
+
+	bool Image::getPixels(gvec2* positions, int count, Color* output, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
+	{
+		return Image::getPixels(positions, count, output, View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Image::setPixels(gvec2* positions, int count, Color* colors, unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	{
+		return Image::setPixels(positions, count, colors, View(destData, destWidth, destHeight, destFormat));
+	}
+
+	bool Image::fillRect(int x, int y, int w, int h, Color color, unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	{
+		return Image::fillRect(x, y, w, h, color, View(destData, destWidth, destHeight, destFormat));
+	}
+
+	bool Image::write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
+		unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	{
+		return Image::write(sx, sy, sw, sh, dx, dy, View(srcData, srcWidth, srcHeight, srcFormat), View(destData, destWidth, destHeight, destFormat));
+	}
+
+	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
+		unsigned char* destData, int destWidth, int destHeight, Format destFormat, Filter filter)
+	{
+		return Image::writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, View(srcData, srcWidth, srcHeight, srcFormat), View(destData, destWidth, destHeight, destFormat), filter);
+	}
+
+	bool Image::blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
+		unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
+	{
+		return Image::blit(sx, sy, sw, sh, dx, dy, View(srcData, srcWidth, srcHeight, srcFormat), View(destData, destWidth, destHeight, destFormat), alpha);
+	}
+
+	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
+		unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha, Filter filter)
+	{
+		return Image::blitStretch(sx, sy, sw, sh, dx, dy, dw, dh, View(srcData, srcWidth, srcHeight, srcFormat), View(destData, destWidth, destHeight, destFormat), alpha, filter);
+	}
+
+	bool Image::rotateHue(int x, int y, int w, int h, float degrees, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	{
+		return Image::rotateHue(x, y, w, h, degrees, View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Image::saturate(int x, int y, int w, int h, float factor, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	{
+		return Image::saturate(x, y, w, h, factor, View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Image::invert(int x, int y, int w, int h, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	{
+		return Image::invert(x, y, w, h, View(srcData, srcWidth, srcHeight, srcFormat));
+	}
+
+	bool Image::insertAlphaMap(int w, int h, unsigned char* srcData, Image::Format srcFormat, unsigned char* destData, Image::Format destFormat, unsigned char median, int ambiguity)
+	{
+		return Image::insertAlphaMap(View(srcData, w, h, srcFormat), View(destData, w, h, destFormat), median, ambiguity);
+	}
+
+	// view based implementations, these don't assume tightly packed rows
+
+	Color Image::getPixel(int x, int y, const View& src)
+	{
+		if (!Image::checkRect(x, y, src.w, src.h))
+		{
+			return Color::Clear;
+		}
+		return _readPixel(src.getPixelData(x, y), src.format, src.palette);
+	}
+	
+	bool Image::setPixel(int x, int y, Color color, const View& dest)
+	{
+		if (!Image::checkRect(x, y, dest.w, dest.h))
 		{
 			return false;
 		}
-		unsigned char rgba[4] = {color.r, color.g, color.b, color.a};
-		unsigned char* p = &destData[(x + y * destWidth) * Image::getFormatBpp(destFormat)];
-		return Image::convertToFormat(1, 1, rgba, Image::FORMAT_RGBA, &p, destFormat, false);
+		return _writePixel(dest.getPixelData(x, y), dest.format, color);
 	}
 
-	Color Image::getInterpolatedPixel(float x, float y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
+	Color Image::getInterpolatedPixel(float x, float y, const View& src)
 	{
 		Color result;
 		int x0 = (int)x;
@@ -517,126 +1244,211 @@ namespace april
 		float ry1 = 1.0f - ry0;
 		if (rx0 != 0.0f && ry0 != 0.0f)
 		{
-			Color tl = Image::getPixel(x0, y0, srcData, srcWidth, srcHeight, srcFormat);
-			Color tr = Image::getPixel(x1, y0, srcData, srcWidth, srcHeight, srcFormat);
-			Color bl = Image::getPixel(x0, y1, srcData, srcWidth, srcHeight, srcFormat);
-			Color br = Image::getPixel(x1, y1, srcData, srcWidth, srcHeight, srcFormat);
+			Color tl = Image::getPixel(x0, y0, src);
+			Color tr = Image::getPixel(x1, y0, src);
+			Color bl = Image::getPixel(x0, y1, src);
+			Color br = Image::getPixel(x1, y1, src);
 			result = (tl * ry1 + bl * ry0) * rx1 + (tr * ry1 + br * ry0) * rx0;
 		}
 		else if (rx0 != 0.0f)
 		{
-			Color tl = Image::getPixel(x0, y0, srcData, srcWidth, srcHeight, srcFormat);
-			Color tr = Image::getPixel(x1, y0, srcData, srcWidth, srcHeight, srcFormat);
+			Color tl = Image::getPixel(x0, y0, src);
+			Color tr = Image::getPixel(x1, y0, src);
 			result = tl * rx1 + tr * rx0;
 		}
 		else if (ry0 != 0.0f)
 		{
-			Color tl = Image::getPixel(x0, y0, srcData, srcWidth, srcHeight, srcFormat);
-			Color bl = Image::getPixel(x0, y1, srcData, srcWidth, srcHeight, srcFormat);
+			Color tl = Image::getPixel(x0, y0, src);
+			Color bl = Image::getPixel(x0, y1, src);
 			result = tl * ry1 + bl * ry0;
 		}
 		else
 		{
-			result = Image::getPixel(x0, y0, srcData, srcWidth, srcHeight, srcFormat);
+			result = Image::getPixel(x0, y0, src);
 		}
 		return result;
 	}
 
-	bool Image::fillRect(int x, int y, int w, int h, Color color, unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	bool Image::getPixels(int x, int y, int w, int h, Color* output, const View& src)
 	{
-		if (!Image::correctRect(x, y, w, h, destWidth, destHeight))
+		if (!Image::checkRect(x, y, w, h, src.w, src.h))
 		{
 			return false;
 		}
-		int destBpp = Image::getFormatBpp(destFormat);
-		int i = (x + y * destWidth) * destBpp;
-		int copyWidth = w * destBpp;
-		int size = copyWidth * destHeight;
-		if (destBpp == 1 || (destBpp == 3 && color.r == color.g && color.r == color.b) || (destBpp == 4 && color.r == color.g && color.r == color.b && color.r == color.a))
+		int srcBpp = src.getBpp();
+		unsigned char* row = NULL;
+		for_iter (j, 0, h)
 		{
-			if (x == 0 && w == destWidth)
+			row = src.getPixelData(x, y + j);
+			for_iter (i, 0, w)
 			{
-				memset(&destData[i], color.r, copyWidth * h);
+				output[i + j * w] = _readPixel(&row[i * srcBpp], src.format, src.palette);
 			}
-			else
+		}
+		return true;
+	}
+
+	bool Image::setPixels(int x, int y, int w, int h, Color* colors, const View& dest)
+	{
+		if (!Image::checkRect(x, y, w, h, dest.w, dest.h))
+		{
+			return false;
+		}
+		int destBpp = dest.getBpp();
+		unsigned char* row = NULL;
+		for_iter (j, 0, h)
+		{
+			row = dest.getPixelData(x, y + j);
+			for_iter (i, 0, w)
 			{
-				for_iter (j, 0, h)
+				if (!_writePixel(&row[i * destBpp], dest.format, colors[i + j * w]))
 				{
-					memset(&destData[(x + (y + j) * destWidth) * destBpp], color.r, copyWidth);
+					return false;
 				}
 			}
-			return true;
 		}
-		unsigned char colorData[4] = {color.r, color.g, color.b, color.a};
-		// convert to right format first
-		Format srcFormat = (destBpp == 4 ? FORMAT_RGBA : (destBpp == 3 ? FORMAT_RGB : FORMAT_GRAYSCALE));
-		if (srcFormat != destFormat && destBpp > 1)
+		return true;
+	}
+
+	bool Image::getPixels(gvec2* positions, int count, Color* output, const View& src)
+	{
+		bool result = true;
+		int x = 0;
+		int y = 0;
+		for_iter (i, 0, count)
 		{
-			unsigned char* rgba = NULL;
-			if (!Image::convertToFormat(1, 1, colorData, srcFormat, &rgba, destFormat))
+			x = hround(positions[i].x);
+			y = hround(positions[i].y);
+			if (Image::checkRect(x, y, src.w, src.h))
 			{
-				return false;
+				output[i] = _readPixel(src.getPixelData(x, y), src.format, src.palette);
+			}
+			else
+			{
+				output[i] = Color::Clear;
+				result = false;
 			}
-			memcpy(&destData[i], rgba, destBpp);
-			delete [] rgba;
-		}
-		else
-		{
-			memcpy(&destData[i], colorData, destBpp);
 		}
-		int currentSize = destBpp;
-		int copySize = 0;
-		if (x == 0 && w == destWidth)
+		return result;
+	}
+
+	bool Image::setPixels(gvec2* positions, int count, Color* colors, const View& dest)
+	{
+		bool result = true;
+		int x = 0;
+		int y = 0;
+		for_iter (i, 0, count)
 		{
-			while (currentSize < size)
+			x = hround(positions[i].x);
+			y = hround(positions[i].y);
+			if (!Image::checkRect(x, y, dest.w, dest.h) || !_writePixel(dest.getPixelData(x, y), dest.format, colors[i]))
 			{
-				copySize = hmin(size - currentSize, currentSize);
-				memcpy(&destData[i + currentSize], &destData[i], copySize);
-				currentSize += copySize;
+				result = false;
 			}
 		}
-		else
+		return result;
+	}
+
+	bool Image::fillRect(int x, int y, int w, int h, Color color, const View& dest)
+	{
+		if (!Image::correctRect(x, y, w, h, dest.w, dest.h) || _isPaletteView(dest))
 		{
-			// copy on first line
-			while (currentSize < copyWidth)
+			return false;
+		}
+		return Image::_runParallel(&Image::_fillRectBand, View(), dest.getSubView(x, y, w, h), &color);
+	}
+
+	bool Image::_fillRectBand(const View& src, const View& dest, void* args)
+	{
+		Color color = *(Color*)args;
+		int w = dest.w;
+		int h = dest.h;
+		int destBpp = dest.getBpp();
+		unsigned char* first = dest.data;
+		int copyWidth = w * destBpp;
+		// a contiguous rectangle can be filled in one go
+		bool contiguous = dest.isContiguous();
+		if (destBpp == 1 || (destBpp == 3 && color.r == color.g && color.r == color.b) ||
+			(destBpp == 4 && color.r == color.g && color.r == color.b && color.r == color.a && !CHECK_PREMULTIPLIED_FORMAT(dest.format)))
+		{
+			if (contiguous)
 			{
-				copySize = hmin(copyWidth - currentSize, currentSize);
-				memcpy(&destData[i + currentSize], &destData[i], copySize);
-				currentSize += copySize;
+				memset(first, color.r, copyWidth * h);
 			}
-			// copy to all lines
+			else
+			{
+				for_iter (j, 0, h)
+				{
+					memset(&first[j * dest.pitch], color.r, copyWidth);
+				}
+			}
+			return true;
+		}
+		if (!_writePixel(first, dest.format, color))
+		{
+			return false;
+		}
+		int size = (contiguous ? copyWidth * h : copyWidth);
+		int currentSize = destBpp;
+		int copySize = 0;
+		while (currentSize < size)
+		{
+			copySize = hmin(size - currentSize, currentSize);
+			memcpy(&first[currentSize], first, copySize);
+			currentSize += copySize;
+		}
+		if (!contiguous)
+		{
+			// copy first line to all lines
 			for_iter (j, 1, h)
 			{
-				memcpy(&destData[(x + (y + j) * destWidth) * destBpp], &destData[i], currentSize);
+				memcpy(&first[j * dest.pitch], first, copyWidth);
 			}
 		}
 		return true;
 	}
 	
-	bool Image::write(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
-		unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	bool Image::write(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest)
 	{
-		if (!Image::correctRect(sx, sy, sw, sh, srcWidth, srcHeight, dx, dy, destWidth, destHeight))
+		if (!Image::correctRect(sx, sy, sw, sh, src.w, src.h, dx, dy, dest.w, dest.h))
 		{
 			return false;
 		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		int destBpp = Image::getFormatBpp(destFormat);
-		if (srcFormat == FORMAT_ALPHA && destFormat != FORMAT_ALPHA)
+		if (src.format == FORMAT_ALPHA && CHECK_PREMULTIPLIED_FORMAT(dest.format))
+		{
+			// a new alpha value has to rescale the colors as well
+			View area = _getStraightView(dest.getSubView(dx, dy, sw, sh));
+			Image::_unpremultiplyAlpha(area);
+			bool result = Image::write(sx, sy, sw, sh, 0, 0, src, area);
+			Image::_premultiplyAlpha(area);
+			return result;
+		}
+		if (src.format == FORMAT_ALPHA && CHECK_PACKED_FORMAT(dest.format))
+		{
+			View area = _expandToRgba(dx, dy, sw, sh, dest);
+			bool result = (area.data != NULL && Image::write(sx, sy, sw, sh, 0, 0, src, area) && Image::convertToFormat(area, dest.getSubView(dx, dy, sw, sh)));
+			delete [] area.data;
+			return result;
+		}
+		if (src.format == FORMAT_ALPHA && dest.format != FORMAT_ALPHA)
 		{
-			if (destBpp == 4)
+			if (dest.getBpp() == 4)
 			{
-				if (CHECK_ALPHA_FORMAT(destFormat))
+				if (CHECK_ALPHA_FORMAT(dest.format))
 				{
 					int x = 0;
 					int y = 0;
 					int da = -1;
-					Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &da);
+					Image::_getFormatIndices(dest.format, NULL, NULL, NULL, &da);
+					unsigned char* srcRow = NULL;
+					unsigned char* destRow = NULL;
 					for_iterx (y, 0, sh)
 					{
+						srcRow = src.getPixelData(sx, sy + y);
+						destRow = dest.getPixelData(dx, dy + y);
 						for_iterx (x, 0, sw)
 						{
-							destData[((dx + x) + (dy + y) * destWidth) * destBpp + da] = srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
+							destRow[x * 4 + da] = srcRow[x];
 						}
 					}
 				}
@@ -644,325 +1456,131 @@ namespace april
 			}
 			return false;
 		}
-		unsigned char* p = &destData[(dx + dy * destWidth) * destBpp];
-		if (sx == 0 && dx == 0 && srcWidth == destWidth && sw == destWidth)
-		{
-			Image::convertToFormat(sw, sh, &srcData[(sx + sy * srcWidth) * srcBpp], srcFormat, &p, destFormat, false);
-		}
-		else
-		{
-			for_iter (j, 0, sh)
-			{
-				Image::convertToFormat(sw, 1, &srcData[(sx + (sy + j) * srcWidth) * srcBpp], srcFormat, &p, destFormat, false);
-				p += destWidth * destBpp;
-			}
-		}
-		return true;
+		return Image::convertToFormat(src.getSubView(sx, sy, sw, sh), dest.getSubView(dx, dy, sw, sh));
 	}
 
-	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
-		unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, Filter filter)
 	{
-		if (!Image::correctRect(sx, sy, sw, sh, srcWidth, srcHeight, dx, dy, dw, dh, destWidth, destHeight))
+		if (!Image::correctRect(sx, sy, sw, sh, src.w, src.h, dx, dy, dw, dh, dest.w, dest.h))
 		{
 			return false;
 		}
 		if (sw == dw && sh == dh)
 		{
-			return Image::write(sx, sy, sw, sh, dx, dh, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat);
+			return Image::write(sx, sy, sw, sh, dx, dy, src, dest);
 		}
-		int bpp = Image::getFormatBpp(destFormat);
-		float fw = (float)sw / dw;
-		float fh = (float)sh / dh;
-		unsigned char* dest = NULL;
-		unsigned char* ctl;
-		unsigned char* ctr;
-		unsigned char* cbl;
-		unsigned char* cbr;
-		float srcX;
-		float srcY;
-		int x0;
-		int y0;
-		int x1;
-		int y1;
-		float rx0;
-		float ry0;
-		float rx1;
-		float ry1;
-		int x = 0;
-		int y = 0;
-		if (srcFormat == FORMAT_ALPHA && destFormat != FORMAT_ALPHA)
+		// interpolated indices would point to unrelated colors
+		if (_isPaletteView(dest))
 		{
-			if (bpp == 4)
-			{
-				if (CHECK_ALPHA_FORMAT(destFormat))
-				{
-					int da = -1;
-					Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &da);
-					for_iterx (y, 0, dh)
-					{
-						srcY = sy + y * fh;
-						y0 = (int)srcY;
-						ry0 = srcY - y0;
-						y1 = hmin(y0 + 1, srcHeight - 1);
-						ry1 = 1.0f - ry0;
-						for_iterx (x, 0, dw)
-						{
-							dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-							srcX = sx + x * fw;
-							x0 = (int)srcX;
-							rx0 = srcX - x0;
-							// linear interpolation
-							ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-							if (rx0 != 0.0f && ry0 != 0.0f)
-							{
-								x1 = hmin(x0 + 1, srcWidth - 1);
-								rx1 = 1.0f - rx0;
-								ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-								cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-								cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-								dest[da] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-							}
-							else if (rx0 != 0.0f)
-							{
-								x1 = hmin(x0 + 1, srcWidth - 1);
-								rx1 = 1.0f - rx0;
-								ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-								dest[da] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-							}
-							else if (ry0 != 0.0f)
-							{
-								cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-								dest[da] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-							}
-							else
-							{
-								dest[da] = ctl[0];
-							}
-						}
-					}
-				}
-				return true;
-			}
 			return false;
 		}
-		bool createNew = Image::needsConversion(srcFormat, destFormat);
-		if (createNew)
+		if (CHECK_PACKED_FORMAT(dest.format))
 		{
-			unsigned char* data = srcData;
-			srcData = new unsigned char[sw * sh * bpp];
-			if (!Image::write(sx, sy, sw, sh, 0, 0, data, srcWidth, srcHeight, srcFormat, srcData, sw, sh, destFormat))
-			{
-				delete [] srcData;
-				return false;
-			}
-			// changed size of data, needs to readjust
-			sx = 0;
-			sy = 0;
-			srcWidth = sw;
-			srcHeight = sh;
+			// resampling works on whole channels, the result is packed again afterwards
+			View area = _expandToRgba(dx, dy, dw, dh, dest);
+			bool result = (area.data != NULL && Image::writeStretch(sx, sy, sw, sh, 0, 0, dw, dh, src, area, filter) &&
+				Image::convertToFormat(area, dest.getSubView(dx, dy, dw, dh)));
+			delete [] area.data;
+			return result;
 		}
-		bool result = false;
-		if (bpp == 1)
+		if (src.format == FORMAT_ALPHA && dest.format != FORMAT_ALPHA)
 		{
-			for_iterx (y, 0, dh)
+			if (dest.getBpp() != 4)
 			{
-				srcY = sy + y * fh;
-				y0 = (int)srcY;
-				ry0 = srcY - y0;
-				y1 = hmin(y0 + 1, srcHeight - 1);
-				ry1 = 1.0f - ry0;
-				for_iterx (x, 0, dw)
-				{
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-					srcX = sx + x * fw;
-					x0 = (int)srcX;
-					rx0 = srcX - x0;
-					// linear interpolation
-					ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-					if (rx0 != 0.0f && ry0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-					}
-					else if (rx0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-					}
-					else if (ry0 != 0.0f)
-					{
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-					}
-					else
-					{
-						dest[0] = ctl[0];
-					}
-				}
+				return false;
 			}
-			result = true;
-		}
-		else if (bpp == 3)
-		{
-			for_iterx (y, 0, dh)
+			if (!CHECK_ALPHA_FORMAT(dest.format))
 			{
-				srcY = sy + y * fh;
-				y0 = (int)srcY;
-				ry0 = srcY - y0;
-				y1 = hmin(y0 + 1, srcHeight - 1);
-				ry1 = 1.0f - ry0;
-				for_iterx (x, 0, dw)
-				{
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-					srcX = sx + x * fw;
-					x0 = (int)srcX;
-					rx0 = srcX - x0;
-					// linear interpolation
-					ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-					if (rx0 != 0.0f && ry0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-						dest[1] = (unsigned char)(((ctl[1] * ry1 + cbl[1] * ry0) * rx1 + (ctr[1] * ry1 + cbr[1] * ry0) * rx0));
-						dest[2] = (unsigned char)(((ctl[2] * ry1 + cbl[2] * ry0) * rx1 + (ctr[2] * ry1 + cbr[2] * ry0) * rx0));
-					}
-					else if (rx0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-						dest[1] = (unsigned char)((ctl[1] * rx1 + ctr[1] * rx0));
-						dest[2] = (unsigned char)((ctl[2] * rx1 + ctr[2] * rx0));
-					}
-					else if (ry0 != 0.0f)
-					{
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-						dest[1] = (unsigned char)((ctl[1] * ry1 + cbl[1] * ry0));
-						dest[2] = (unsigned char)((ctl[2] * ry1 + cbl[2] * ry0));
-					}
-					else
-					{
-						dest[0] = ctl[0];
-						dest[1] = ctl[1];
-						dest[2] = ctl[2];
-					}
-				}
+				return true;
 			}
-			result = true;
+			// only the alpha channel is changed so the stretched values go through a temporary alpha map
+			unsigned char* alphaData = new unsigned char[dw * dh];
+			View alpha(alphaData, dw, dh, FORMAT_ALPHA);
+			bool result = (Image::_resample(sx, sy, sw, sh, 0, 0, dw, dh, src, alpha, filter) && Image::write(0, 0, dw, dh, dx, dy, alpha, dest));
+			delete [] alphaData;
+			return result;
 		}
-		else if (bpp == 4)
+		View source = src;
+		// needsConversion() is not used here since it doesn't consider swapping RGB and BGR
+		bool createNew = (src.format != dest.format);
+		if (createNew)
 		{
-			for_iterx (y, 0, dh)
+			source = View(new unsigned char[sw * sh * dest.getBpp()], sw, sh, dest.format);
+			if (!Image::write(sx, sy, sw, sh, 0, 0, src, source))
 			{
-				srcY = sy + y * fh;
-				y0 = (int)srcY;
-				ry0 = srcY - y0;
-				y1 = hmin(y0 + 1, srcHeight - 1);
-				ry1 = 1.0f - ry0;
-				for_iterx (x, 0, dw)
-				{
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-					srcX = sx + x * fw;
-					x0 = (int)srcX;
-					rx0 = srcX - x0;
-					// linear interpolation
-					ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-					if (rx0 != 0.0f && ry0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-						dest[1] = (unsigned char)(((ctl[1] * ry1 + cbl[1] * ry0) * rx1 + (ctr[1] * ry1 + cbr[1] * ry0) * rx0));
-						dest[2] = (unsigned char)(((ctl[2] * ry1 + cbl[2] * ry0) * rx1 + (ctr[2] * ry1 + cbr[2] * ry0) * rx0));
-						dest[3] = (unsigned char)(((ctl[3] * ry1 + cbl[3] * ry0) * rx1 + (ctr[3] * ry1 + cbr[3] * ry0) * rx0));
-					}
-					else if (rx0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-						dest[1] = (unsigned char)((ctl[1] * rx1 + ctr[1] * rx0));
-						dest[2] = (unsigned char)((ctl[2] * rx1 + ctr[2] * rx0));
-						dest[3] = (unsigned char)((ctl[3] * rx1 + ctr[3] * rx0));
-					}
-					else if (ry0 != 0.0f)
-					{
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-						dest[1] = (unsigned char)((ctl[1] * ry1 + cbl[1] * ry0));
-						dest[2] = (unsigned char)((ctl[2] * ry1 + cbl[2] * ry0));
-						dest[3] = (unsigned char)((ctl[3] * ry1 + cbl[3] * ry0));
-					}
-					else
-					{
-						dest[0] = ctl[0];
-						dest[1] = ctl[1];
-						dest[2] = ctl[2];
-						dest[3] = ctl[3];
-					}
-				}
+				delete [] source.data;
+				return false;
 			}
-			result = true;
+			// changed size of data, needs to readjust
+			sx = 0;
+			sy = 0;
 		}
+		bool result = Image::_resample(sx, sy, sw, sh, dx, dy, dw, dh, source, dest, filter);
 		if (createNew)
 		{
-			delete [] srcData;
+			delete [] source.data;
 		}
 		return result;
 	}
 
-	bool Image::blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
-		unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
+	bool Image::blit(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha)
 	{
-		if (!Image::correctRect(sx, sy, sw, sh, srcWidth, srcHeight, dx, dy, destWidth, destHeight))
+		if (!Image::correctRect(sx, sy, sw, sh, src.w, src.h, dx, dy, dest.w, dest.h) || _isPaletteView(dest))
 		{
 			return false;
 		}
+		if (CHECK_PACKED_FORMAT(dest.format))
+		{
+			// blending works on whole channels, the result is packed again afterwards
+			View area = _expandToRgba(dx, dy, sw, sh, dest);
+			bool result = (area.data != NULL && Image::blit(sx, sy, sw, sh, 0, 0, src, area, alpha) && Image::convertToFormat(area, dest.getSubView(dx, dy, sw, sh)));
+			delete [] area.data;
+			return result;
+		}
+		if (src.format == FORMAT_PALETTE || CHECK_PACKED_FORMAT(src.format))
+		{
+			// the palette can contain alpha so the colors are blended like any other RGBA data
+			View expanded = _expandToRgba(sx, sy, sw, sh, src);
+			bool result = (expanded.data != NULL && Image::blit(0, 0, sw, sh, dx, dy, expanded, dest, alpha));
+			delete [] expanded.data;
+			return result;
+		}
 		// source format doesn't have alpha and no alpha multiplier is used, so using write() is enough
-		if (!CHECK_ALPHA_FORMAT(srcFormat) && alpha == 255)
+		if (!CHECK_ALPHA_FORMAT(src.format) && alpha == 255)
 		{
-			return Image::write(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat);
+			return Image::write(sx, sy, sw, sh, dx, dy, src, dest);
 		}
 		// it's invisible anyway, so let's say it's successful
 		if (alpha == 0)
 		{
 			return true;
 		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
+		if (src.format == FORMAT_ALPHA && CHECK_PREMULTIPLIED_FORMAT(dest.format))
+		{
+			View area = _getStraightView(dest.getSubView(dx, dy, sw, sh));
+			Image::_unpremultiplyAlpha(area);
+			bool result = Image::_blitFrom1Bpp(sx, sy, sw, sh, 0, 0, src, area, alpha);
+			Image::_premultiplyAlpha(area);
+			return result;
+		}
+		int srcBpp = src.getBpp();
 		if (srcBpp == 1)
 		{
-			if (Image::_blitFrom1Bpp(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, alpha))
+			if (Image::_blitFrom1Bpp(sx, sy, sw, sh, dx, dy, src, dest, alpha))
 			{
 				return true;
 			}
 		}
 		else if (srcBpp == 3)
 		{
-			if (Image::_blitFrom3Bpp(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, alpha))
+			if (Image::_blitFrom3Bpp(sx, sy, sw, sh, dx, dy, src, dest, alpha))
 			{
 				return true;
 			}
 		}
 		else if (srcBpp == 4)
 		{
-			if (Image::_blitFrom4Bpp(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, alpha))
+			if (Image::_blitFrom4Bpp(sx, sy, sw, sh, dx, dy, src, dest, alpha))
 			{
 				return true;
 			}
@@ -970,16 +1588,22 @@ namespace april
 		return false;
 	}
 
-	bool Image::_blitFrom1Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
+	bool Image::_blitFrom1Bpp(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha)
 	{
 		static int srcBpp = 1;
+		unsigned char* srcData = src.data;
+		int srcPitch = src.pitch;
+		Format srcFormat = src.format;
+		unsigned char* destData = dest.data;
+		int destPitch = dest.pitch;
+		Format destFormat = dest.format;
 		int destBpp = Image::getFormatBpp(destFormat);
 		if (srcFormat == FORMAT_ALPHA && destFormat != FORMAT_ALPHA && destBpp != 4)
 		{
 			return false;
 		}
-		unsigned char* src = NULL;
-		unsigned char* dest = NULL;
+		unsigned char* srcPixel = NULL;
+		unsigned char* destPixel = NULL;
 		unsigned char a1;
 		unsigned int c;
 		int x = 0;
@@ -991,9 +1615,9 @@ namespace april
 			{
 				for_iterx (x, 0, sw)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[0] = (src[0] * alpha + dest[0] * a1) / 255;
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					destPixel[0] = _div255(srcPixel[0] * alpha + destPixel[0] * a1);
 				}
 			}
 			return true;
@@ -1010,12 +1634,12 @@ namespace april
 				{
 					for_iterx (x, 0, sw)
 					{
-						src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-						c = src[0] * alpha;
-						dest[dr] = (c + dest[dr] * a1) / 255;
-						dest[dg] = (c + dest[dg] * a1) / 255;
-						dest[db] = (c + dest[db] * a1) / 255;
+						srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+						destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+						c = srcPixel[0] * alpha;
+						destPixel[dr] = _div255(c + destPixel[dr] * a1);
+						destPixel[dg] = _div255(c + destPixel[dg] * a1);
+						destPixel[db] = _div255(c + destPixel[db] * a1);
 					}
 				}
 			}
@@ -1031,13 +1655,13 @@ namespace april
 				{
 					for_iterx (x, 0, sw)
 					{
-						src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-						c = src[0] * alpha;
-						dest[dr] = (c + dest[dr] * a1) / 255;
-						dest[dg] = (c + dest[dg] * a1) / 255;
-						dest[db] = (c + dest[db] * a1) / 255;
-						dest[da] = alpha + dest[da] * a1 / 255;
+						srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+						destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+						c = srcPixel[0] * alpha;
+						destPixel[dr] = _div255(c + destPixel[dr] * a1);
+						destPixel[dg] = _div255(c + destPixel[dg] * a1);
+						destPixel[db] = _div255(c + destPixel[db] * a1);
+						destPixel[da] = alpha + _div255(destPixel[da] * a1);
 					}
 				}
 			}
@@ -1047,9 +1671,9 @@ namespace april
 				{
 					for_iterx (x, 0, sw)
 					{
-						src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-						dest[da] = (src[0] * alpha + dest[da] * a1) / 255;
+						srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+						destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+						destPixel[da] = _div255(srcPixel[0] * alpha + destPixel[da] * a1);
 					}
 				}
 			}
@@ -1058,12 +1682,18 @@ namespace april
 		return false;
 	}
 
-	bool Image::_blitFrom3Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
+	bool Image::_blitFrom3Bpp(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha)
 	{
 		static int srcBpp = 3;
+		unsigned char* srcData = src.data;
+		int srcPitch = src.pitch;
+		Format srcFormat = src.format;
+		unsigned char* destData = dest.data;
+		int destPitch = dest.pitch;
+		Format destFormat = dest.format;
 		int destBpp = Image::getFormatBpp(destFormat);
-		unsigned char* src = NULL;
-		unsigned char* dest = NULL;
+		unsigned char* srcPixel = NULL;
+		unsigned char* destPixel = NULL;
 		unsigned char a1;
 		int x = 0;
 		int y = 0;
@@ -1076,9 +1706,9 @@ namespace april
 			{
 				for_iterx (x, 0, sw)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[0] = (src[sr] * alpha + dest[0] * a1) / 255;
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					destPixel[0] = _div255(srcPixel[sr] * alpha + destPixel[0] * a1);
 				}
 			}
 			return true;
@@ -1096,11 +1726,11 @@ namespace april
 			{
 				for_iterx (x, 0, sw)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[dr] = (src[sr] * alpha + dest[dr] * a1) / 255;
-					dest[dg] = (src[sg] * alpha + dest[dg] * a1) / 255;
-					dest[db] = (src[sb] * alpha + dest[db] * a1) / 255;
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					destPixel[dr] = _div255(srcPixel[sr] * alpha + destPixel[dr] * a1);
+					destPixel[dg] = _div255(srcPixel[sg] * alpha + destPixel[dg] * a1);
+					destPixel[db] = _div255(srcPixel[sb] * alpha + destPixel[db] * a1);
 				}
 			}
 			return true;
@@ -1113,467 +1743,920 @@ namespace april
 			{
 				for_iterx (x, 0, sw)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[dr] = (src[sr] * alpha + dest[dr] * a1) / 255;
-					dest[dg] = (src[sg] * alpha + dest[dg] * a1) / 255;
-					dest[db] = (src[sb] * alpha + dest[db] * a1) / 255;
-					dest[da] = alpha + dest[da] * a1 / 255;
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					destPixel[dr] = _div255(srcPixel[sr] * alpha + destPixel[dr] * a1);
+					destPixel[dg] = _div255(srcPixel[sg] * alpha + destPixel[dg] * a1);
+					destPixel[db] = _div255(srcPixel[sb] * alpha + destPixel[db] * a1);
+					destPixel[da] = alpha + _div255(destPixel[da] * a1);
 				}
 			}
 			return true;
 		}
-		return false;
+		return false;
+	}
+
+	bool Image::_blitFrom4Bpp(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha)
+	{
+		static int srcBpp = 4;
+		unsigned char* srcData = src.data;
+		int srcPitch = src.pitch;
+		Format srcFormat = src.format;
+		unsigned char* destData = dest.data;
+		int destPitch = dest.pitch;
+		Format destFormat = dest.format;
+		int destBpp = Image::getFormatBpp(destFormat);
+		if (destBpp == 4)
+		{
+			// the vectorized kernel leaves only a few columns at the right edge
+			int done = Image::_blitSimd(sx, sy, sw, sh, dx, dy, src, dest, alpha);
+			sx += done;
+			dx += done;
+			sw -= done;
+		}
+		if (CHECK_PREMULTIPLIED_FORMAT(srcFormat))
+		{
+			return Image::_blitFromPremultiplied(sx, sy, sw, sh, dx, dy, src, dest, alpha);
+		}
+		unsigned char* srcPixel = NULL;
+		unsigned char* destPixel = NULL;
+		unsigned char a0;
+		unsigned char a1;
+		int x = 0;
+		int y = 0;
+		int sr = -1;
+		int sa = -1;
+		if (destBpp == 1)
+		{
+			Image::_getFormatIndices(srcFormat, &sr, NULL, NULL, &sa);
+			for_iterx (y, 0, sh)
+			{
+				for_iterx (x, 0, sw)
+				{
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					a0 = _div255(srcPixel[sa] * alpha);
+					if (a0 > 0)
+					{
+						destPixel[0] = _div255(srcPixel[sr] * a0 + destPixel[0] * (255 - a0));
+					}
+				}
+			}
+			return true;
+		}
+		int sg = -1;
+		int sb = -1;
+		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, &sa);
+		int dr = -1;
+		int dg = -1;
+		int db = -1;
+		if (destBpp == 3 || !CHECK_ALPHA_FORMAT(destFormat)) // 3 BPP and 4 BPP without alpha
+		{
+			Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
+			for_iterx (y, 0, sh)
+			{
+				for_iterx (x, 0, sw)
+				{
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					a0 = _div255(srcPixel[sa] * alpha);
+					if (a0 > 0)
+					{
+						a1 = 255 - a0;
+						destPixel[dr] = _div255(srcPixel[sr] * a0 + destPixel[dr] * a1);
+						destPixel[dg] = _div255(srcPixel[sg] * a0 + destPixel[dg] * a1);
+						destPixel[db] = _div255(srcPixel[sb] * a0 + destPixel[db] * a1);
+					}
+				}
+			}
+			return true;
+		}
+		int da = -1;
+		if (destBpp == 4) // 4 BPP with alpha
+		{
+			Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
+			for_iterx (y, 0, sh)
+			{
+				for_iterx (x, 0, sw)
+				{
+					srcPixel = &srcData[(sx + x) * srcBpp + (sy + y) * srcPitch];
+					destPixel = &destData[(dx + x) * destBpp + (dy + y) * destPitch];
+					a0 = _div255(srcPixel[sa] * alpha);
+					if (a0 > 0)
+					{
+						a1 = (255 - a0);
+						destPixel[dr] = _div255(srcPixel[sr] * a0 + destPixel[dr] * a1);
+						destPixel[dg] = _div255(srcPixel[sg] * a0 + destPixel[dg] * a1);
+						destPixel[db] = _div255(srcPixel[sb] * a0 + destPixel[db] * a1);
+						destPixel[da] = a0 + _div255(destPixel[da] * a1);
+					}
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	bool Image::_blitFromPremultiplied(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha)
+	{
+		int destBpp = dest.getBpp();
+		int sr = 0;
+		int sg = 0;
+		int sb = 0;
+		int sa = 0;
+		Image::_getFormatIndices(src.format, &sr, &sg, &sb, &sa);
+		int dr = 0;
+		int dg = 0;
+		int db = 0;
+		int da = -1;
+		Image::_getFormatIndices(dest.format, &dr, &dg, &db, NULL);
+		if (destBpp == 4 && CHECK_ALPHA_FORMAT(dest.format))
+		{
+			Image::_getFormatIndices(dest.format, NULL, NULL, NULL, &da);
+		}
+		// destination colors are treated the same way as when blending straight alpha, the formula just doesn't need the source multiply
+		unsigned char* srcPixel = NULL;
+		unsigned char* destPixel = NULL;
+		unsigned char a1 = 0;
+		for_iter (j, 0, sh)
+		{
+			srcPixel = src.getPixelData(sx, sy + j);
+			destPixel = dest.getPixelData(dx, dy + j);
+			for_iter (i, 0, sw)
+			{
+				a1 = 255 - _div255(srcPixel[sa] * alpha);
+				destPixel[dr] = _blendPremultiplied(srcPixel[sr], destPixel[dr], alpha, a1);
+				if (destBpp > 1)
+				{
+					destPixel[dg] = _blendPremultiplied(srcPixel[sg], destPixel[dg], alpha, a1);
+					destPixel[db] = _blendPremultiplied(srcPixel[sb], destPixel[db], alpha, a1);
+					if (da >= 0)
+					{
+						destPixel[da] = _blendPremultiplied(srcPixel[sa], destPixel[da], alpha, a1);
+					}
+				}
+				srcPixel += 4;
+				destPixel += destBpp;
+			}
+		}
+		return true;
+	}
+
+	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, unsigned char alpha, Filter filter)
+	{
+		if (!Image::correctRect(sx, sy, sw, sh, src.w, src.h, dx, dy, dw, dh, dest.w, dest.h))
+		{
+			return false;
+		}
+		if (sw == dw && sh == dh)
+		{
+			return Image::blit(sx, sy, sw, sh, dx, dy, src, dest, alpha);
+		}
+		if (_isPaletteView(dest))
+		{
+			return false;
+		}
+		if (CHECK_PACKED_FORMAT(dest.format))
+		{
+			View area = _expandToRgba(dx, dy, dw, dh, dest);
+			bool result = (area.data != NULL && Image::blitStretch(sx, sy, sw, sh, 0, 0, dw, dh, src, area, alpha, filter) &&
+				Image::convertToFormat(area, dest.getSubView(dx, dy, dw, dh)));
+			delete [] area.data;
+			return result;
+		}
+		if (src.format == FORMAT_PALETTE || CHECK_PACKED_FORMAT(src.format))
+		{
+			View expanded = _expandToRgba(sx, sy, sw, sh, src);
+			bool result = (expanded.data != NULL && Image::blitStretch(0, 0, sw, sh, dx, dy, dw, dh, expanded, dest, alpha, filter));
+			delete [] expanded.data;
+			return result;
+		}
+		// source format doesn't have alpha and no alpha multiplier is used, so using writeStretch() is enough
+		if (!CHECK_ALPHA_FORMAT(src.format) && alpha == 255)
+		{
+			return Image::writeStretch(sx, sy, sw, sh, dx, dy, dw, dh, src, dest, filter);
+		}
+		// it's invisible anyway, so let's say it's successful
+		if (alpha == 0)
+		{
+			return true;
+		}
+		return Image::_resampleBlit(sx, sy, sw, sh, dx, dy, dw, dh, src, dest, filter, alpha);
+	}
+
+	bool Image::rotateHue(int x, int y, int w, int h, float degrees, const View& dest)
+	{
+		if (!Image::correctRect(x, y, w, h, dest.w, dest.h) || _isPaletteView(dest))
+		{
+			return false;
+		}
+		if (CHECK_PREMULTIPLIED_FORMAT(dest.format))
+		{
+			// color manipulation works on straight colors
+			View area = _getStraightView(dest.getSubView(x, y, w, h));
+			Image::_unpremultiplyAlpha(area);
+			bool result = Image::rotateHue(0, 0, w, h, degrees, area);
+			Image::_premultiplyAlpha(area);
+			return result;
+		}
+		if (CHECK_PACKED_FORMAT(dest.format))
+		{
+			// color manipulation works on whole channels
+			View area = _expandToRgba(x, y, w, h, dest);
+			bool result = (area.data != NULL && Image::rotateHue(0, 0, w, h, degrees, area) && Image::convertToFormat(area, dest.getSubView(x, y, w, h)));
+			delete [] area.data;
+			return result;
+		}
+		if (dest.getBpp() == 1)
+		{
+			return true;
+		}
+		float range = hmodf(degrees / 360.0f, 1.0f);
+		if (range < 0.0f)
+		{
+			range += 1.0f;
+		}
+		// hue offset in sextants as 16.16 fixed point
+		int offset = (int)(range * 6 * 0x10000 + 0.5f) % (6 * 0x10000);
+		if (offset == 0)
+		{
+			return true;
+		}
+		return Image::_runParallel(&Image::_rotateHueBand, View(), dest.getSubView(x, y, w, h), &offset);
+	}
+
+	bool Image::_rotateHueBand(const View& src, const View& dest, void* args)
+	{
+		int offset = *(int*)args;
+		int destBpp = dest.getBpp();
+		int dr = -1;
+		int dg = -1;
+		int db = -1;
+		Image::_getFormatIndices(dest.format, &dr, &dg, &db, NULL);
+		unsigned char* row = NULL;
+		unsigned char* p = NULL;
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		int min = 0;
+		int max = 0;
+		int delta = 0;
+		int hue = 0;
+		int unit = 0;
+		int period = 0;
+		// lightness and saturation stay the same so min and max of the channels stay the same, only the hue moves
+		for_iter (j, 0, dest.h)
+		{
+			row = dest.getPixelData(0, j);
+			for_iter (i, 0, dest.w)
+			{
+				p = &row[i * destBpp];
+				r = p[dr];
+				g = p[dg];
+				b = p[db];
+				min = hmin(hmin(r, g), b);
+				max = hmax(hmax(r, g), b);
+				delta = max - min;
+				if (delta == 0) // gray has no hue
+				{
+					continue;
+				}
+				// same sextants as rgbToHsl(), scaled by delta
+				if (max == r)
+				{
+					hue = g - b;
+					if (hue < 0)
+					{
+						hue += delta * 6;
+					}
+				}
+				else if (max == g)
+				{
+					hue = b - r + delta * 2;
+				}
+				else
+				{
+					hue = r - g + delta * 4;
+				}
+				unit = delta << 16;
+				period = unit * 6;
+				hue = (hue << 16) + offset * delta;
+				if (hue >= period)
+				{
+					hue -= period;
+				}
+				p[dr] = _hueToChannel(hue + unit * 2, unit, period, min);
+				p[dg] = _hueToChannel(hue, unit, period, min);
+				p[db] = _hueToChannel(hue - unit * 2, unit, period, min);
+			}
+		}
+		return true;
+	}
+
+	bool Image::saturate(int x, int y, int w, int h, float factor, const View& dest)
+	{
+		if (!Image::correctRect(x, y, w, h, dest.w, dest.h) || _isPaletteView(dest))
+		{
+			return false;
+		}
+		if (CHECK_PREMULTIPLIED_FORMAT(dest.format))
+		{
+			View area = _getStraightView(dest.getSubView(x, y, w, h));
+			Image::_unpremultiplyAlpha(area);
+			bool result = Image::saturate(0, 0, w, h, factor, area);
+			Image::_premultiplyAlpha(area);
+			return result;
+		}
+		if (CHECK_PACKED_FORMAT(dest.format))
+		{
+			View area = _expandToRgba(x, y, w, h, dest);
+			bool result = (area.data != NULL && Image::saturate(0, 0, w, h, factor, area) && Image::convertToFormat(area, dest.getSubView(x, y, w, h)));
+			delete [] area.data;
+			return result;
+		}
+		if (dest.getBpp() == 1)
+		{
+			return true;
+		}
+		// 20.12 fixed point, saturation can never be scaled by more than 255 before it's clamped anyway
+		int scale = (int)(hclamp(factor, 0.0f, 255.0f) * 0x1000 + 0.5f);
+		if (scale == 0x1000)
+		{
+			return true;
+		}
+		return Image::_runParallel(&Image::_saturateBand, View(), dest.getSubView(x, y, w, h), &scale);
+	}
+
+	bool Image::_saturateBand(const View& src, const View& dest, void* args)
+	{
+		int scale = *(int*)args;
+		int destBpp = dest.getBpp();
+		int dr = -1;
+		int dg = -1;
+		int db = -1;
+		Image::_getFormatIndices(dest.format, &dr, &dg, &db, NULL);
+		unsigned char* row = NULL;
+		unsigned char* p = NULL;
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		int min = 0;
+		int max = 0;
+		int delta = 0;
+		int sum = 0;
+		int limit = 0;
+		// in HSL scaling the saturation scales every channel's distance from the lightness (max + min) / 2, as long as
+		// the saturation doesn't exceed 1 which is reached when the new delta equals "limit"
+		for_iter (j, 0, dest.h)
+		{
+			row = dest.getPixelData(0, j);
+			for_iter (i, 0, dest.w)
+			{
+				p = &row[i * destBpp];
+				r = p[dr];
+				g = p[dg];
+				b = p[db];
+				min = hmin(hmin(r, g), b);
+				max = hmax(hmax(r, g), b);
+				delta = max - min;
+				if (delta == 0) // gray has no saturation
+				{
+					continue;
+				}
+				sum = max + min;
+				limit = (sum < 255 ? sum : 510 - sum);
+				if (delta * scale <= limit << 12)
+				{
+					p[dr] = (unsigned char)(((sum << 12) + scale * (r * 2 - sum) + 0x1000) >> 13);
+					p[dg] = (unsigned char)(((sum << 12) + scale * (g * 2 - sum) + 0x1000) >> 13);
+					p[db] = (unsigned char)(((sum << 12) + scale * (b * 2 - sum) + 0x1000) >> 13);
+				}
+				else
+				{
+					p[dr] = (unsigned char)((sum * delta + limit * (r * 2 - sum) + delta) / (delta * 2));
+					p[dg] = (unsigned char)((sum * delta + limit * (g * 2 - sum) + delta) / (delta * 2));
+					p[db] = (unsigned char)((sum * delta + limit * (b * 2 - sum) + delta) / (delta * 2));
+				}
+			}
+		}
+		return true;
+	}
+
+	bool Image::invert(int x, int y, int w, int h, const View& dest)
+	{
+		if (!Image::correctRect(x, y, w, h, dest.w, dest.h) || _isPaletteView(dest))
+		{
+			return false;
+		}
+		if (CHECK_PREMULTIPLIED_FORMAT(dest.format))
+		{
+			View area = _getStraightView(dest.getSubView(x, y, w, h));
+			Image::_unpremultiplyAlpha(area);
+			bool result = Image::invert(0, 0, w, h, area);
+			Image::_premultiplyAlpha(area);
+			return result;
+		}
+		if (CHECK_PACKED_FORMAT(dest.format))
+		{
+			View area = _expandToRgba(x, y, w, h, dest);
+			bool result = (area.data != NULL && Image::invert(0, 0, w, h, area) && Image::convertToFormat(area, dest.getSubView(x, y, w, h)));
+			delete [] area.data;
+			return result;
+		}
+		return Image::_runParallel(&Image::_invertBand, View(), dest.getSubView(x, y, w, h), NULL);
 	}
-	
-	bool Image::_blitFrom4Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
+
+	bool Image::_invertBand(const View& src, const View& dest, void* args)
 	{
-		static int srcBpp = 4;
-		int destBpp = Image::getFormatBpp(destFormat);
-		unsigned char* src = NULL;
-		unsigned char* dest = NULL;
-		unsigned char a0;
-		unsigned char a1;
-		int x = 0;
-		int y = 0;
-		int sr = -1;
-		int sa = -1;
+		unsigned char* row = NULL;
+		int destBpp = dest.getBpp();
 		if (destBpp == 1)
 		{
-			Image::_getFormatIndices(srcFormat, &sr, NULL, NULL, &sa);
-			for_iterx (y, 0, sh)
+			for_iter (j, 0, dest.h)
 			{
-				for_iterx (x, 0, sw)
+				row = dest.getPixelData(0, j);
+				for_iter (i, 0, dest.w)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					a0 = src[sa] * alpha / 255;
-					if (a0 > 0)
-					{
-						dest[0] = (src[sr] * a0 + dest[0] * (255 - a0)) / 255;
-					}
+					row[i] = 255 - row[i];
 				}
 			}
 			return true;
 		}
-		int sg = -1;
-		int sb = -1;
-		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, &sa);
 		int dr = -1;
 		int dg = -1;
 		int db = -1;
-		if (destBpp == 3 || !CHECK_ALPHA_FORMAT(destFormat)) // 3 BPP and 4 BPP without alpha
+		Image::_getFormatIndices(dest.format, &dr, &dg, &db, NULL);
+		unsigned char* p = NULL;
+		for_iter (j, 0, dest.h)
 		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
-			for_iterx (y, 0, sh)
+			row = dest.getPixelData(0, j);
+			for_iter (i, 0, dest.w)
 			{
-				for_iterx (x, 0, sw)
+				p = &row[i * destBpp];
+				p[dr] = 255 - p[dr];
+				p[dg] = 255 - p[dg];
+				p[db] = 255 - p[db];
+			}
+		}
+		return true;
+	}
+
+	bool Image::insertAlphaMap(const View& src, const View& dest, unsigned char median, int ambiguity)
+	{
+		if (!CHECK_ALPHA_FORMAT(dest.format)) // not a format that supports an alpha channel
+		{
+			return false;
+		}
+		if (CHECK_PREMULTIPLIED_FORMAT(dest.format))
+		{
+			View straight = _getStraightView(dest);
+			Image::_unpremultiplyAlpha(straight);
+			bool result = Image::insertAlphaMap(src, straight, median, ambiguity);
+			Image::_premultiplyAlpha(straight);
+			return result;
+		}
+		if (src.w < dest.w || src.h < dest.h || _isPaletteView(src))
+		{
+			return false;
+		}
+		int srcBpp = src.getBpp();
+		if (srcBpp != 1 && srcBpp != 3 && srcBpp != 4)
+		{
+			return false;
+		}
+		int values[2] = {median, ambiguity};
+		return Image::_runParallel(&Image::_insertAlphaMapBand, src, dest, values);
+	}
+
+	bool Image::_insertAlphaMapBand(const View& src, const View& dest, void* args)
+	{
+		unsigned char median = (unsigned char)((int*)args)[0];
+		int ambiguity = ((int*)args)[1];
+		int srcBpp = src.getBpp();
+		int destBpp = dest.getBpp();
+		int sr = -1;
+		Image::_getFormatIndices(src.format, &sr, NULL, NULL, NULL);
+		int da = -1;
+		Image::_getFormatIndices(dest.format, NULL, NULL, NULL, &da);
+		unsigned char* srcRow = NULL;
+		unsigned char* destRow = NULL;
+		unsigned char* srcPixel = NULL;
+		unsigned char* destPixel = NULL;
+		int x = 0;
+		int y = 0;
+		if (ambiguity == 0)
+		{
+			for_iterx (y, 0, dest.h)
+			{
+				srcRow = &src.data[y * src.pitch];
+				destRow = &dest.data[y * dest.pitch];
+				for_iterx (x, 0, dest.w)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					a0 = src[sa] * alpha / 255;
-					if (a0 > 0)
-					{
-						a1 = 255 - a0;
-						dest[dr] = (src[sr] * a0 + dest[dr] * a1) / 255;
-						dest[dg] = (src[sg] * a0 + dest[dg] * a1) / 255;
-						dest[db] = (src[sb] * a0 + dest[db] * a1) / 255;
-					}
+					// takes the red second color channel for alpha value
+					destRow[x * destBpp + da] = srcRow[x * srcBpp + sr];
 				}
 			}
-			return true;
 		}
-		int da = -1;
-		if (destBpp == 4) // 4 BPP with alpha
+		else
 		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
-			for_iterx (y, 0, sh)
+			int min = (int)median - ambiguity / 2;
+			int max = (int)median + ambiguity / 2;
+			for_iterx (y, 0, dest.h)
 			{
-				for_iterx (x, 0, sw)
+				srcRow = &src.data[y * src.pitch];
+				destRow = &dest.data[y * dest.pitch];
+				for_iterx (x, 0, dest.w)
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					a0 = src[sa] * alpha / 255;
-					if (a0 > 0)
+					srcPixel = &srcRow[x * srcBpp];
+					destPixel = &destRow[x * destBpp];
+					// takes the red second color channel for alpha value
+					if (srcPixel[sr] < min)
 					{
-						a1 = (255 - a0);
-						dest[dr] = (src[sr] * a0 + dest[dr] * a1) / 255;
-						dest[dg] = (src[sg] * a0 + dest[dg] * a1) / 255;
-						dest[db] = (src[sb] * a0 + dest[db] * a1) / 255;
-						dest[da] = a0 + dest[da] * a1 / 255;
+						destPixel[da] = 255;
+					}
+					else if (srcPixel[sr] >= max)
+					{
+						destPixel[da] = 0;
+					}
+					else
+					{
+						destPixel[da] = (max - srcPixel[sr]) * 255 / ambiguity;
 					}
 				}
 			}
-			return true;
 		}
-		return false;
+		return true;
 	}
 
-	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
-		unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
+	bool Image::convertToFormat(int w, int h, unsigned char* srcData, Image::Format srcFormat, unsigned char** destData, Image::Format destFormat, bool preventCopy)
+	{
+		return Image::convertToFormat(View(srcData, w, h, srcFormat), destData, destFormat, preventCopy);
+	}
+
+	bool Image::convertToFormat(const View& src, unsigned char** destData, Image::Format destFormat, bool preventCopy)
 	{
-		if (!Image::correctRect(sx, sy, sw, sh, srcWidth, srcHeight, dx, dy, dw, dh, destWidth, destHeight))
+		if (preventCopy && src.format == destFormat)
 		{
+			hlog::warn(april::logTag, "The source's and destination's formats are the same!");
 			return false;
 		}
-		if (sw == dw && sh == dh)
+		bool createData = (*destData == NULL);
+		if (createData)
 		{
-			return Image::blit(sx, sy, sw, sh, dx, dh, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, alpha);
+			*destData = new unsigned char[src.w * src.h * Image::getFormatBpp(destFormat)];
 		}
-		unsigned char* stretched = new unsigned char[dw * dh * Image::getFormatBpp(srcFormat)];
-		bool result = Image::writeStretch(sx, sy, sw, sh, 0, 0, dw, dh, srcData, srcWidth, srcHeight, srcFormat, stretched, dw, dh, srcFormat);
-		if (result)
+		if (Image::convertToFormat(src, View(*destData, src.w, src.h, destFormat)))
 		{
-			result = Image::blit(0, 0, dw, dh, dx, dy, stretched, dw, dh, srcFormat, destData, destWidth, destHeight, destFormat, alpha);
+			return true;
 		}
-		delete [] stretched;
-		return result;
+		if (createData)
+		{
+			delete [] *destData;
+			*destData = NULL;
+		}
+		return false;
 	}
 
-	bool Image::rotateHue(int x, int y, int w, int h, float degrees, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool Image::convertToFormat(const View& src, const View& dest)
 	{
-		if (!Image::correctRect(x, y, w, h, srcWidth, srcHeight))
+		if (src.w != dest.w || src.h != dest.h)
 		{
+			hlog::errorf(april::logTag, "Cannot convert %d x %d pixels to %d x %d pixels!", src.w, src.h, dest.w, dest.h);
 			return false;
 		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		if (srcBpp == 1)
+		if (CHECK_PACKED_FORMAT(src.format) || CHECK_PACKED_FORMAT(dest.format))
 		{
-			return true;
+			return Image::_convertPacked(src, dest);
 		}
-		float range = hmodf(degrees / 360.0f, 1.0f);
-		if (range == 0.0f)
+		if (src.format == FORMAT_PALETTE || dest.format == FORMAT_PALETTE)
 		{
-			return true;
+			return Image::_convertPalette(src, dest);
 		}
-		int sr = -1;
-		int sg = -1;
-		int sb = -1;
-		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, NULL);
-		float _h;
-		float _s;
-		float _l;
-		int i;
-		for_iter (dy, 0, h)
+		if (CHECK_PREMULTIPLIED_FORMAT(src.format) || CHECK_PREMULTIPLIED_FORMAT(dest.format))
 		{
-			for_iter (dx, 0, w)
-			{
-				i = ((x + dx) + (y + dy) * srcWidth) * srcBpp;
-				april::rgbToHsl(srcData[i + sr], srcData[i + sg], srcData[i + sb], &_h, &_s, &_l);
-				april::hslToRgb(hmodf(_h + range, 1.0f), _s, _l, &srcData[i + sr], &srcData[i + sg], &srcData[i + sb]);
-			}
+			return Image::_convertPremultiplied(src, dest);
 		}
-		return true;
+		if (Image::_runParallel(&Image::_convertBand, src, dest, NULL))
+		{
+			return true;
+		}
+		hlog::errorf(april::logTag, "Conversion from %d BPP to %d BPP is not supported!", src.getBpp(), dest.getBpp());
+		return false;
 	}
 
-	bool Image::saturate(int x, int y, int w, int h, float factor, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool Image::_convertBand(const View& src, const View& dest, void* args)
 	{
-		if (!Image::correctRect(x, y, w, h, srcWidth, srcHeight))
+		int srcBpp = src.getBpp();
+		if (srcBpp == 1)
 		{
-			return false;
+			return Image::_convertFrom1Bpp(src, dest);
 		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		if (srcBpp == 1)
+		if (srcBpp == 3)
 		{
-			return true;
+			return Image::_convertFrom3Bpp(src, dest);
 		}
-		int sr = -1;
-		int sg = -1;
-		int sb = -1;
-		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, NULL);
-		float _h;
-		float _s;
-		float _l;
-		int i;
-		for_iter (dy, 0, h)
+		if (srcBpp == 4)
 		{
-			for_iter (dx, 0, w)
-			{
-				i = ((x + dx) + (y + dy) * srcWidth) * srcBpp;
-				april::rgbToHsl(srcData[i + sr], srcData[i + sg], srcData[i + sb], &_h, &_s, &_l);
-				april::hslToRgb(_h, hclamp(_s * factor, 0.0f, 1.0f), _l, &srcData[i + sr], &srcData[i + sg], &srcData[i + sb]);
-			}
+			return Image::_convertFrom4Bpp(src, dest);
 		}
-		return true;
+		return false;
 	}
 
-	bool Image::invert(int x, int y, int w, int h, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+	bool Image::_convertPalette(const View& src, const View& dest)
 	{
-		if (!Image::correctRect(x, y, w, h, srcWidth, srcHeight))
+		if (src.format == FORMAT_PALETTE && dest.format == FORMAT_PALETTE)
+		{
+			// the indices are copied as they are, the palette is not part of the pixel data
+			_copyRows(src, dest);
+			return true;
+		}
+		if (src.format != FORMAT_PALETTE)
 		{
+			hlog::error(april::logTag, "Conversion to a palette is not supported!");
 			return false;
 		}
-		int i;
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		if (srcBpp == 1)
+		if (src.palette == NULL)
 		{
-			for_iter (dy, 0, h)
-			{
-				for_iter (dx, 0, w)
-				{
-					i = ((x + dx) + (y + dy) * srcWidth);
-					srcData[i] = 255 - srcData[i];
-				}
-			}
-			return true;
+			hlog::error(april::logTag, "Paletted image data has no palette!");
+			return false;
 		}
-		int sr = -1;
-		int sg = -1;
-		int sb = -1;
-		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, NULL);
-		for_iter (dy, 0, h)
+		// the palette itself is converted once so every pixel is only a copy of its entry
+		int destBpp = dest.getBpp();
+		unsigned char colors[APRIL_PALETTE_SIZE * 4];
+		if (destBpp == 0 || !Image::convertToFormat(View(src.palette, APRIL_PALETTE_SIZE, 1, FORMAT_RGBA), View(colors, APRIL_PALETTE_SIZE, 1, dest.format)))
 		{
-			for_iter (dx, 0, w)
+			return false;
+		}
+		unsigned char* srcRow = NULL;
+		unsigned char* destRow = NULL;
+		for_iter (j, 0, src.h)
+		{
+			srcRow = src.getPixelData(0, j);
+			destRow = dest.getPixelData(0, j);
+			for_iter (i, 0, src.w)
 			{
-				i = ((x + dx) + (y + dy) * srcWidth) * srcBpp;
-				srcData[i + sr] = 255 - srcData[i + sr];
-				srcData[i + sg] = 255 - srcData[i + sg];
-				srcData[i + sb] = 255 - srcData[i + sb];
+				memcpy(&destRow[i * destBpp], &colors[srcRow[i] * destBpp], destBpp);
 			}
 		}
 		return true;
 	}
 
-	bool Image::insertAlphaMap(int w, int h, unsigned char* srcData, Image::Format srcFormat, unsigned char* destData, Image::Format destFormat, unsigned char median, int ambiguity)
+	bool Image::_convertPremultiplied(const View& src, const View& dest)
 	{
-		if (!CHECK_ALPHA_FORMAT(destFormat)) // not a format that supports an alpha channel
+		View straightSrc = _getStraightView(src);
+		View straightDest = _getStraightView(dest);
+		bool srcPremultiplied = CHECK_PREMULTIPLIED_FORMAT(src.format);
+		bool destPremultiplied = CHECK_PREMULTIPLIED_FORMAT(dest.format);
+		// only the channel order changes
+		if (srcPremultiplied == destPremultiplied)
 		{
-			return false;
+			return Image::convertToFormat(straightSrc, straightDest);
 		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		if (srcBpp == 1 || srcBpp == 3 || srcBpp == 4)
+		if (destPremultiplied)
 		{
-			int destBpp = Image::getFormatBpp(destFormat);
-			int sr = -1;
-			Image::_getFormatIndices(srcFormat, &sr, NULL, NULL, NULL);
-			int da = -1;
-			Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &da);
-			unsigned char* src = NULL;
-			unsigned char* dest = NULL;
-			int i = 0;
-			int x = 0;
-			int y = 0;
-			if (ambiguity == 0)
+			if (!Image::convertToFormat(straightSrc, straightDest))
 			{
-				for_iterx (y, 0, h)
-				{
-					for_iterx (x, 0, w)
-					{
-						i = (x + y * w);
-						// takes the red second color channel for alpha value
-						destData[i * destBpp + da] = srcData[i * srcBpp + sr];
-					}
-				}
+				return false;
 			}
-			else
+			// without alpha in the source everything is opaque and premultiplying wouldn't change anything
+			if (CHECK_ALPHA_FORMAT(src.format))
 			{
-				int min = (int)median - ambiguity / 2;
-				int max = (int)median + ambiguity / 2;
-				for_iterx (y, 0, h)
-				{
-					for_iterx (x, 0, w)
-					{
-						i = (x + y * w);
-						src = &srcData[i * srcBpp];
-						dest = &destData[i * destBpp];
-						// takes the red second color channel for alpha value
-						if (src[sr] < min)
-						{
-							dest[da] = 255;
-						}
-						else if (src[sr] >= max)
-						{
-							dest[da] = 0;
-						}
-						else
-						{
-							dest[da] = (max - src[sr]) * 255 / ambiguity;
-						}
-					}
-				}
+				Image::_premultiplyAlpha(straightDest);
 			}
 			return true;
 		}
-		return false;
-	}
-
-	bool Image::convertToFormat(int w, int h, unsigned char* srcData, Image::Format srcFormat, unsigned char** destData, Image::Format destFormat, bool preventCopy)
-	{
-		if (preventCopy && srcFormat == destFormat)
-		{
-			hlog::warn(april::logTag, "The source's and destination's formats are the same!");
-			return false;
-		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		if (srcFormat == FORMAT_PALETTE && destFormat == FORMAT_PALETTE)
+		if (CHECK_ALPHA_FORMAT(dest.format))
 		{
+			if (!Image::convertToFormat(straightSrc, straightDest))
+			{
+				return false;
+			}
+			Image::_unpremultiplyAlpha(straightDest);
 			return true;
 		}
-		if (srcBpp == 1)
+		// the alpha channel is dropped so the colors have to be restored before the conversion, one row at a time
+		int rowSize = src.w * 4;
+		unsigned char* rowData = new unsigned char[rowSize];
+		View row(rowData, src.w, 1, straightSrc.format);
+		bool result = true;
+		for_iter (j, 0, src.h)
 		{
-			if (Image::_convertFrom1Bpp(w, h, srcData, srcFormat, destData, destFormat))
+			memcpy(rowData, &src.data[j * src.pitch], rowSize);
+			Image::_unpremultiplyAlpha(row);
+			if (!Image::convertToFormat(row, dest.getSubView(0, j, dest.w, 1)))
 			{
-				return true;
+				result = false;
+				break;
 			}
 		}
-		else if (srcBpp == 3)
+		delete [] rowData;
+		return result;
+	}
+
+	void Image::_premultiplyAlpha(const View& view)
+	{
+		int done = Image::_premultiplySimd(view);
+		if (done >= view.w)
+		{
+			return;
+		}
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		int a = 0;
+		Image::_getFormatIndices(view.format, &r, &g, &b, &a);
+		unsigned char* p = NULL;
+		for_iter (j, 0, view.h)
 		{
-			if (Image::_convertFrom3Bpp(w, h, srcData, srcFormat, destData, destFormat))
+			p = view.getPixelData(done, j);
+			for_iter (i, done, view.w)
 			{
-				return true;
+				p[r] = _div255(p[r] * p[a]);
+				p[g] = _div255(p[g] * p[a]);
+				p[b] = _div255(p[b] * p[a]);
+				p += 4;
 			}
 		}
-		else if (srcBpp == 4)
+	}
+
+	void Image::_unpremultiplyAlpha(const View& view)
+	{
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		int a = 0;
+		Image::_getFormatIndices(view.format, &r, &g, &b, &a);
+		unsigned char* p = NULL;
+		for_iter (j, 0, view.h)
 		{
-			if (Image::_convertFrom4Bpp(w, h, srcData, srcFormat, destData, destFormat))
+			p = view.getPixelData(0, j);
+			for_iter (i, 0, view.w)
 			{
-				return true;
+				if (p[a] < 255)
+				{
+					p[r] = _unpremultiply(p[r], p[a]);
+					p[g] = _unpremultiply(p[g], p[a]);
+					p[b] = _unpremultiply(p[b], p[a]);
+				}
+				p += 4;
 			}
 		}
-		hlog::errorf(april::logTag, "Conversion from %d BPP to %d BPP is not supported!", srcBpp, Image::getFormatBpp(destFormat));
-		return false;
 	}
 
-	bool Image::_convertFrom1Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat)
+	bool Image::_convertFrom1Bpp(const View& src, const View& dest)
 	{
-		int destBpp = Image::getFormatBpp(destFormat);
-		bool createData = (*destData == NULL);
-		if (createData)
+		int destBpp = dest.getBpp();
+		if (destBpp == 1)
 		{
-			*destData = new unsigned char[w * h * destBpp];
+			_copyRows(src, dest);
+			return true;
 		}
-		if (destBpp == 1)
+		if (Image::_convertSimd(src, dest))
 		{
-			memcpy(*destData, srcData, w * h * destBpp);
 			return true;
 		}
+		int w = src.w;
+		int h = src.h;
 		int x = 0;
 		int y = 0;
 		if (destBpp == 3 || destBpp == 4)
 		{
+			unsigned char* srcRow = NULL;
+			unsigned char* destRow = NULL;
 			int i = 0;
-			if (destBpp > 3)
-			{
-				memset(*destData, 255, w * h * destBpp);
-				if (!CHECK_LEFT_RGB(destFormat))
-				{
-					for_iterx (y, 0, h)
-					{
-						for_iterx (x, 0, w)
-						{
-							i = (x + y * w) * destBpp;
-							(*destData)[i + 1] = (*destData)[i + 2] = (*destData)[i + 3] = srcData[x + y * w];
-						}
-					}
-					return true;
-				}
-			}
+			// color channels start at the second byte in XRGB-like formats
+			int offset = (destBpp > 3 && !CHECK_LEFT_RGB(dest.format) ? 1 : 0);
+			int alphaIndex = (offset == 0 ? 3 : 0);
 			for_iterx (y, 0, h)
 			{
+				srcRow = &src.data[y * src.pitch];
+				destRow = &dest.data[y * dest.pitch];
 				for_iterx (x, 0, w)
 				{
-					i = (x + y * w) * destBpp;
-					(*destData)[i] = (*destData)[i + 1] = (*destData)[i + 2] = srcData[x + y * w];
+					i = x * destBpp;
+					destRow[i + offset] = destRow[i + offset + 1] = destRow[i + offset + 2] = srcRow[x];
+					if (destBpp > 3)
+					{
+						destRow[i + alphaIndex] = 255;
+					}
 				}
 			}
 			return true;
 		}
-		if (createData)
-		{
-			delete [] *destData;
-			*destData = NULL;
-		}
 		return false;
 	}
 
-	bool Image::_convertFrom3Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat)
+	bool Image::_convertFrom3Bpp(const View& src, const View& dest)
 	{
 		static int srcBpp = 3;
-		int destBpp = Image::getFormatBpp(destFormat);
-		bool createData = (*destData == NULL);
-		if (createData)
+		int destBpp = dest.getBpp();
+		if (destBpp == 3 && src.format == dest.format)
 		{
-			*destData = new unsigned char[w * h * destBpp];
+			_copyRows(src, dest);
+			return true;
+		}
+		if (Image::_convertSimd(src, dest))
+		{
+			return true;
 		}
+		unsigned char* srcData = src.data;
+		unsigned char* destData = dest.data;
+		int srcPitch = src.pitch;
+		int destPitch = dest.pitch;
+		int w = src.w;
+		int h = src.h;
 		int x = 0;
 		int y = 0;
 		if (destBpp == 1)
 		{
-			int redIndex = (srcFormat == FORMAT_RGB ? 0 : 2);
+			unsigned char* srcRow = NULL;
+			unsigned char* destRow = NULL;
+			int redIndex = (src.format == FORMAT_RGB ? 0 : 2);
 			for_iterx (y, 0, h)
 			{
+				srcRow = &srcData[y * srcPitch];
+				destRow = &destData[y * destPitch];
 				for_iterx (x, 0, w)
 				{
 					// red is used as main component
-					(*destData)[x + y * w] = srcData[(x + y * w) * srcBpp + redIndex];
+					destRow[x] = srcRow[x * srcBpp + redIndex];
 				}
 			}
 			return true;
 		}
 		if (destBpp == 3)
 		{
-			memcpy(*destData, srcData, w * h * destBpp);
 			// FORMAT_RGB to FORMAT_BGR and vice versa, thus switching 2 bytes around is enough
-			if (srcFormat != destFormat)
+			unsigned char* srcRow = NULL;
+			unsigned char* destRow = NULL;
+			int i = 0;
+			for_iterx (y, 0, h)
 			{
-				int i = 0;
-				for_iterx (y, 0, h)
+				srcRow = &srcData[y * srcPitch];
+				destRow = &destData[y * destPitch];
+				for_iterx (x, 0, w)
 				{
-					for_iterx (x, 0, w)
-					{
-						i = (x + y * w) * destBpp;
-						(*destData)[i] = srcData[i + 2];
-						(*destData)[i + 2] = srcData[i];
-					}
+					i = x * destBpp;
+					destRow[i] = srcRow[i + 2];
+					destRow[i + 1] = srcRow[i + 1];
+					destRow[i + 2] = srcRow[i];
 				}
 			}
 			return true;
 		}
 		if (destBpp == 4)
 		{
-			unsigned int* dest = (unsigned int*)*destData;
-			Format extended = (srcFormat == FORMAT_RGB ? FORMAT_RGBX : FORMAT_BGRX);
-			bool rightShift = CHECK_SHIFT_FORMATS(extended, destFormat);
-			bool invertOrder = (CHECK_INVERT_ORDER_FORMATS(extended, destFormat) || CHECK_INVERT_ORDER_FORMATS(destFormat, extended));
+			unsigned char* srcRow = NULL;
+			unsigned int* destRow = NULL;
+			Format extended = (src.format == FORMAT_RGB ? FORMAT_RGBX : FORMAT_BGRX);
+			bool rightShift = CHECK_SHIFT_FORMATS(extended, dest.format);
+			bool invertOrder = (CHECK_INVERT_ORDER_FORMATS(extended, dest.format) || CHECK_INVERT_ORDER_FORMATS(dest.format, extended));
 			int i = 0;
 			if (rightShift)
 			{
 				if (invertOrder)
 				{
-					FOR_EACH_3BPP_TO_4BPP_PIXEL((((unsigned int)srcData[i]) << 24) | (((unsigned int)srcData[i + 1]) << 16) | (((unsigned int)srcData[i + 2]) << 8) | _R_ALPHA);
+					FOR_EACH_3BPP_TO_4BPP_PIXEL((((unsigned int)srcRow[i]) << 24) | (((unsigned int)srcRow[i + 1]) << 16) | (((unsigned int)srcRow[i + 2]) << 8) | _R_ALPHA);
 				}
 				else
 				{
-					FOR_EACH_3BPP_TO_4BPP_PIXEL((((unsigned int)srcData[i]) << 8) | (((unsigned int)srcData[i + 1]) << 16) | (((unsigned int)srcData[i + 2]) << 24) | _R_ALPHA);
+					FOR_EACH_3BPP_TO_4BPP_PIXEL((((unsigned int)srcRow[i]) << 8) | (((unsigned int)srcRow[i + 1]) << 16) | (((unsigned int)srcRow[i + 2]) << 24) | _R_ALPHA);
 				}
 			}
 			else if (invertOrder)
 			{
-				FOR_EACH_3BPP_TO_4BPP_PIXEL((((unsigned int)srcData[i]) << 16) | (((unsigned int)srcData[i + 1]) << 8) | srcData[i + 2] | _L_ALPHA);
+				FOR_EACH_3BPP_TO_4BPP_PIXEL((((unsigned int)srcRow[i]) << 16) | (((unsigned int)srcRow[i + 1]) << 8) | srcRow[i + 2] | _L_ALPHA);
 			}
 			else
 			{
-				FOR_EACH_3BPP_TO_4BPP_PIXEL(srcData[i] | (((unsigned int)srcData[i + 1]) << 8) | (((unsigned int)srcData[i + 2]) << 16) | _L_ALPHA);
+				FOR_EACH_3BPP_TO_4BPP_PIXEL(srcRow[i] | (((unsigned int)srcRow[i + 1]) << 8) | (((unsigned int)srcRow[i + 2]) << 16) | _L_ALPHA);
 			}
 			return true;
 		}
-		if (createData)
-		{
-			delete [] *destData;
-			*destData = NULL;
-		}
 		return false;
 	}
 
-	bool Image::_convertFrom4Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat)
+	bool Image::_convertFrom4Bpp(const View& src, const View& dest)
 	{
 		static int srcBpp = 4;
-		int destBpp = Image::getFormatBpp(destFormat);
-		bool createData = (*destData == NULL);
-		if (createData)
+		int destBpp = dest.getBpp();
+		if (destBpp == 4 && src.format == dest.format)
+		{
+			_copyRows(src, dest);
+			return true;
+		}
+		if (Image::_convertSimd(src, dest))
 		{
-			*destData = new unsigned char[w * h * destBpp];
+			return true;
 		}
+		unsigned char* srcData = src.data;
+		unsigned char* destData = dest.data;
+		int srcPitch = src.pitch;
+		int destPitch = dest.pitch;
+		Format srcFormat = src.format;
+		Format destFormat = dest.format;
+		int w = src.w;
+		int h = src.h;
 		int x = 0;
 		int y = 0;
 		if (destBpp == 1)
@@ -1591,51 +2674,54 @@ namespace april
 			{
 				redIndex = 3;
 			}
+			unsigned char* srcRow = NULL;
+			unsigned char* destRow = NULL;
 			for_iterx (y, 0, h)
 			{
+				srcRow = &srcData[y * srcPitch];
+				destRow = &destData[y * destPitch];
 				for_iterx (x, 0, w)
 				{
 					// red is used as main component
-					(*destData)[x + y * w] = srcData[(x + y * w) * srcBpp + redIndex];
+					destRow[x] = srcRow[x * srcBpp + redIndex];
 				}
 			}
 			return true;
 		}
 		if (destBpp == 3)
 		{
-			unsigned int* src = (unsigned int*)srcData;
-			unsigned char* dest = *destData;
+			unsigned int* srcRow = NULL;
+			unsigned char* destRow = NULL;
 			Format extended = (destFormat == FORMAT_RGB ? FORMAT_RGBX : FORMAT_BGRX);
 			bool leftShift = CHECK_SHIFT_FORMATS(extended, srcFormat);
 			bool invertOrder = (CHECK_INVERT_ORDER_FORMATS(srcFormat, extended) || CHECK_INVERT_ORDER_FORMATS(extended, srcFormat));
-			int i = 0;
 			int j = 0;
 			if (leftShift)
 			{
 				if (invertOrder)
 				{
-					FOR_EACH_4BPP_TO_3BPP_PIXEL(src[i] >> 24, src[i] >> 16, src[i] >> 8);
+					FOR_EACH_4BPP_TO_3BPP_PIXEL(srcRow[x] >> 24, srcRow[x] >> 16, srcRow[x] >> 8);
 				}
 				else
 				{
-					FOR_EACH_4BPP_TO_3BPP_PIXEL(src[i] >> 8, src[i] >> 16, src[i] >> 24);
+					FOR_EACH_4BPP_TO_3BPP_PIXEL(srcRow[x] >> 8, srcRow[x] >> 16, srcRow[x] >> 24);
 				}
 			}
 			else if (invertOrder)
 			{
-				FOR_EACH_4BPP_TO_3BPP_PIXEL(src[i] >> 16, src[i] >> 8, src[i]);
+				FOR_EACH_4BPP_TO_3BPP_PIXEL(srcRow[x] >> 16, srcRow[x] >> 8, srcRow[x]);
 			}
 			else
 			{
-				FOR_EACH_4BPP_TO_3BPP_PIXEL(src[i], src[i] >> 8, src[i] >> 16);
+				FOR_EACH_4BPP_TO_3BPP_PIXEL(srcRow[x], srcRow[x] >> 8, srcRow[x] >> 16);
 			}
 			return true;
 		}
 		if (destBpp == 4)
 		{
 			// shifting unsigned int's around is faster than pure assigning (like at 3 BPP)
-			unsigned int* src = (unsigned int*)srcData;
-			unsigned int* dest = (unsigned int*)*destData;
+			unsigned int* srcRow = NULL;
+			unsigned int* destRow = NULL;
 			bool rightShift = CHECK_SHIFT_FORMATS(srcFormat, destFormat);
 			bool leftShift = CHECK_SHIFT_FORMATS(destFormat, srcFormat);
 			bool invertOrder = (CHECK_INVERT_ORDER_FORMATS(srcFormat, destFormat) || CHECK_INVERT_ORDER_FORMATS(destFormat, srcFormat));
@@ -1645,7 +2731,6 @@ namespace april
 			bool srcAlpha = CHECK_ALPHA_FORMAT(srcFormat);
 			bool destAlpha = CHECK_ALPHA_FORMAT(destFormat);
 			bool copyAlpha = (srcAlpha && destAlpha);
-			int i = 0;
 			if (rightShift)
 			{
 				if (invertOrder)
@@ -1725,15 +2810,10 @@ namespace april
 			}
 			else
 			{
-				memcpy(*destData, srcData, w * h * destBpp);
+				_copyRows(src, dest);
 			}
 			return true;
 		}
-		if (createData)
-		{
-			delete [] *destData;
-			*destData = NULL;
-		}
 		return false;
 	}
 
@@ -1743,6 +2823,20 @@ namespace april
 		{
 			return false;
 		}
+		if ((srcFormat == FORMAT_PALETTE) != (destFormat == FORMAT_PALETTE))
+		{
+			return true;
+		}
+		if (CHECK_PACKED_FORMAT(srcFormat) || CHECK_PACKED_FORMAT(destFormat))
+		{
+			return (srcFormat != destFormat);
+		}
+		if (CHECK_PREMULTIPLIED_FORMAT(srcFormat) != CHECK_PREMULTIPLIED_FORMAT(destFormat))
+		{
+			return true;
+		}
+		srcFormat = _getStraightFormat(srcFormat);
+		destFormat = _getStraightFormat(destFormat);
 		int srcBpp = Image::getFormatBpp(srcFormat);
 		int destBpp = Image::getFormatBpp(destFormat);
 		if (srcBpp != destBpp)
@@ -1913,6 +3007,7 @@ namespace april
 		{
 		case FORMAT_RGBA:
 		case FORMAT_RGBX:
+		case FORMAT_RGBA_PREMULTIPLIED:
 			if (alpha != NULL)
 			{
 				*alpha = 3;
@@ -1934,6 +3029,7 @@ namespace april
 			break;
 		case FORMAT_BGRA:
 		case FORMAT_BGRX:
+		case FORMAT_BGRA_PREMULTIPLIED:
 			if (alpha != NULL)
 			{
 				*alpha = 3;
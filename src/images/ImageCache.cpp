@@ -0,0 +1,257 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/exception.h>
+#include <hltypes/hdir.h>
+#include <hltypes/hfile.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hresource.h>
+#include <hltypes/hstring.h>
+
+#include "april.h"
+#include "Image.h"
+#include "Platform.h"
+
+#define CACHE_MAGIC 0x43495041 // "APIC"
+#define CACHE_VERSION 1
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+namespace april
+{
+	static bool cacheEnabled = false;
+	static hstr cachePath = "";
+	// images can be loaded on several threads at once, e.g. with asynchronous texture loading
+	static hmutex cacheMutex;
+	static int tempFileIndex = 0;
+
+	/// @brief Identifies the source file and how it was decoded, the cached pixels are only used if all of it matches.
+	struct CacheHeader
+	{
+		unsigned int magic;
+		unsigned int version;
+		unsigned int sourceSize;
+		unsigned int sourceHashLow;
+		unsigned int sourceHashHigh;
+		unsigned int requestedFormat;
+		unsigned int downscale;
+		unsigned int w;
+		unsigned int h;
+		unsigned int format;
+	};
+
+	static unsigned long long _hash(const unsigned char* data, int size)
+	{
+		unsigned long long hash = FNV_OFFSET;
+		for_iter (i, 0, size)
+		{
+			hash = (hash ^ data[i]) * FNV_PRIME;
+		}
+		return hash;
+	}
+
+	static unsigned char* _readSource(hsbase& stream, int& size)
+	{
+		size = (int)stream.size();
+		if (size <= 0)
+		{
+			return NULL;
+		}
+		unsigned char* data = new unsigned char[size];
+		if (stream.read_raw(data, size) != size)
+		{
+			delete [] data;
+			return NULL;
+		}
+		return data;
+	}
+
+	static Image* _readCache(chstr filename, const CacheHeader& expected)
+	{
+		if (!hfile::exists(filename))
+		{
+			return NULL;
+		}
+		hfile f(filename);
+		CacheHeader header;
+		if (f.read_raw(&header, sizeof(header)) != sizeof(header) || header.magic != expected.magic || header.version != expected.version ||
+			header.sourceSize != expected.sourceSize || header.sourceHashLow != expected.sourceHashLow || header.sourceHashHigh != expected.sourceHashHigh ||
+			header.requestedFormat != expected.requestedFormat || header.downscale != expected.downscale)
+		{
+			return NULL;
+		}
+		Image* image = Image::create(header.w, header.h, NULL, (Image::Format)header.format);
+		int size = image->getByteSize();
+		if (size <= 0 || f.size() != (long)sizeof(header) + size)
+		{
+			delete image;
+			return NULL;
+		}
+		// the pixels are read straight into the final buffer, already in the requested format
+		image->data = new unsigned char[size];
+		if (f.read_raw(image->data, size) != size)
+		{
+			delete image;
+			return NULL;
+		}
+		return image;
+	}
+
+	static void _writeCache(chstr filename, CacheHeader header, Image* image)
+	{
+		int size = image->getByteSize();
+		if (image->data == NULL || size <= 0 || image->format == Image::FORMAT_PALETTE || image->format == Image::FORMAT_COMPRESSED)
+		{
+			return;
+		}
+		header.w = image->w;
+		header.h = image->h;
+		header.format = image->format;
+		// written under a different name first so a partially written file is never read, each writer gets its own in case the same image is loaded twice at once
+		cacheMutex.lock();
+		hstr tempFilename = hsprintf("%s.%d.tmp", filename.c_str(), tempFileIndex);
+		++tempFileIndex;
+		cacheMutex.unlock();
+		// the image was already decoded so failing to cache it doesn't fail the loading
+		try
+		{
+			hstr path = Image::getCachePath();
+			if (!hdir::exists(path) && !hdir::create(path))
+			{
+				hlog::warn(april::logTag, "Could not create image cache directory: " + path);
+				return;
+			}
+			{
+				hfile f(tempFilename, hfile::WRITE);
+				f.write_raw(&header, sizeof(header));
+				f.write_raw(image->data, size);
+			}
+			if (hfile::exists(filename))
+			{
+				hfile::remove(filename);
+			}
+			if (!hfile::rename(tempFilename, filename))
+			{
+				hfile::remove(tempFilename);
+			}
+		}
+		catch (hl_exception&)
+		{
+			hlog::warn(april::logTag, "Could not write image cache file: " + filename);
+			if (hfile::exists(tempFilename))
+			{
+				hfile::remove(tempFilename);
+			}
+		}
+	}
+
+	void Image::setCacheEnabled(bool value)
+	{
+		cacheEnabled = value;
+	}
+
+	bool Image::isCacheEnabled()
+	{
+		return cacheEnabled;
+	}
+
+	void Image::setCachePath(chstr value)
+	{
+		cacheMutex.lock();
+		cachePath = value;
+		cacheMutex.unlock();
+	}
+
+	hstr Image::getCachePath()
+	{
+		cacheMutex.lock();
+		if (cachePath == "")
+		{
+			cachePath = april::getUserDataPath() + "/image_cache";
+		}
+		hstr result = cachePath;
+		cacheMutex.unlock();
+		return result;
+	}
+
+	bool Image::_isCacheable(chstr filename)
+	{
+		if (!cacheEnabled)
+		{
+			return false;
+		}
+		// KTX and DDS data is uploaded as it is anyway
+		hstr name = filename.lower();
+		return (name.ends_with(".png") || name.ends_with(".jpg") || name.ends_with(".jpeg") || name.ends_with(".jpt"));
+	}
+
+	Image* Image::_loadCached(chstr filename, bool fromResource, Image::Format format, int downscale)
+	{
+		// the whole source is needed to detect changes and the same data is decoded if the cache can't be used
+		int sourceSize = 0;
+		unsigned char* sourceData = NULL;
+		if (fromResource)
+		{
+			hresource f(filename);
+			sourceData = _readSource(f, sourceSize);
+		}
+		else
+		{
+			hfile f(filename);
+			sourceData = _readSource(f, sourceSize);
+		}
+		if (sourceData == NULL)
+		{
+			return NULL;
+		}
+		unsigned long long sourceHash = _hash(sourceData, sourceSize);
+		CacheHeader header;
+		header.magic = CACHE_MAGIC;
+		header.version = CACHE_VERSION;
+		header.sourceSize = sourceSize;
+		header.sourceHashLow = (unsigned int)sourceHash;
+		header.sourceHashHigh = (unsigned int)(sourceHash >> 32);
+		header.requestedFormat = format;
+		header.downscale = downscale;
+		header.w = header.h = header.format = 0;
+		// dithering changes the result of converting to the 16 bit formats
+		hstr key = hsprintf("%s:%s:%d:%d:%d", (fromResource ? "resource" : "file"), filename.c_str(), format, downscale, Image::getDither());
+		unsigned long long keyHash = _hash((const unsigned char*)key.c_str(), key.size());
+		hstr cacheFilename = hsprintf("%s/%08x%08x.bin", Image::getCachePath().c_str(), (unsigned int)(keyHash >> 32), (unsigned int)keyHash);
+		Image* image = _readCache(cacheFilename, header);
+		if (image != NULL)
+		{
+			delete [] sourceData;
+			return image;
+		}
+		hstr name = filename.lower();
+		if (name.ends_with(".png"))
+		{
+			image = Image::_loadPng(sourceData, sourceSize, format, downscale);
+		}
+		else if (name.ends_with(".jpt"))
+		{
+			image = Image::_loadJpt(sourceData, sourceSize, format, downscale);
+		}
+		else
+		{
+			image = Image::_loadJpg(sourceData, sourceSize, format, downscale);
+		}
+		delete [] sourceData;
+		image = Image::_finishLoading(image, format);
+		if (image != NULL)
+		{
+			_writeCache(cacheFilename, header, image);
+		}
+		return image;
+	}
+
+}
@@ -0,0 +1,473 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <string.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+
+#include "april.h"
+#include "Image.h"
+
+namespace april
+{
+	static int etcModifiers[8][2] =
+	{
+		{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+	};
+
+	static int etcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+	static int eacModifiers[16][8] =
+	{
+		{-3, -6, -9, -15, 2, 5, 8, 14},
+		{-3, -7, -10, -13, 2, 6, 9, 12},
+		{-2, -5, -8, -13, 1, 4, 7, 12},
+		{-2, -4, -6, -13, 1, 3, 5, 12},
+		{-3, -6, -8, -12, 2, 5, 7, 11},
+		{-3, -7, -9, -11, 2, 6, 8, 10},
+		{-4, -7, -8, -11, 3, 6, 7, 10},
+		{-3, -5, -8, -11, 2, 4, 7, 10},
+		{-2, -6, -8, -10, 1, 5, 7, 9},
+		{-2, -5, -8, -10, 1, 4, 7, 9},
+		{-2, -4, -8, -10, 1, 3, 7, 9},
+		{-2, -5, -7, -10, 1, 4, 6, 9},
+		{-3, -4, -7, -10, 2, 3, 6, 9},
+		{-1, -2, -3, -10, 0, 1, 2, 9},
+		{-4, -6, -8, -9, 3, 5, 7, 8},
+		{-3, -5, -7, -9, 2, 4, 6, 8}
+	};
+
+	static inline unsigned char _clamp255(int value)
+	{
+		return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	static inline void _setRgb(unsigned char* color, int r, int g, int b)
+	{
+		color[0] = _clamp255(r);
+		color[1] = _clamp255(g);
+		color[2] = _clamp255(b);
+	}
+
+	// all decoders write a 4x4 block of RGBA pixels, destPitch is the distance between rows in bytes
+	static void _decodeBc1Block(unsigned char* block, unsigned char* dest, int destPitch, bool fourColors, bool transparent)
+	{
+		unsigned char colors[4][4];
+		int c0 = block[0] | (block[1] << 8);
+		int c1 = block[2] | (block[3] << 8);
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		for_iter (i, 0, 2)
+		{
+			int c = (i == 0 ? c0 : c1);
+			r = (c >> 11) & 0x1F;
+			g = (c >> 5) & 0x3F;
+			b = c & 0x1F;
+			colors[i][0] = (unsigned char)((r << 3) | (r >> 2));
+			colors[i][1] = (unsigned char)((g << 2) | (g >> 4));
+			colors[i][2] = (unsigned char)((b << 3) | (b >> 2));
+			colors[i][3] = 255;
+		}
+		if (fourColors || c0 > c1)
+		{
+			for_iter (j, 0, 3)
+			{
+				colors[2][j] = (unsigned char)((2 * colors[0][j] + colors[1][j]) / 3);
+				colors[3][j] = (unsigned char)((colors[0][j] + 2 * colors[1][j]) / 3);
+			}
+			colors[2][3] = colors[3][3] = 255;
+		}
+		else
+		{
+			for_iter (j, 0, 3)
+			{
+				colors[2][j] = (unsigned char)((colors[0][j] + colors[1][j]) / 2);
+				colors[3][j] = 0;
+			}
+			colors[2][3] = 255;
+			colors[3][3] = (transparent ? 0 : 255);
+		}
+		unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+		for_iter (y, 0, 4)
+		{
+			for_iter (x, 0, 4)
+			{
+				memcpy(&dest[y * destPitch + x * 4], colors[(indices >> ((y * 4 + x) * 2)) & 0x3], 4);
+			}
+		}
+	}
+
+	static void _decodeBc2Alpha(unsigned char* block, unsigned char* dest, int destPitch)
+	{
+		int value = 0;
+		for_iter (y, 0, 4)
+		{
+			for_iter (x, 0, 4)
+			{
+				value = (block[y * 2 + x / 2] >> ((x & 0x1) * 4)) & 0xF;
+				dest[y * destPitch + x * 4 + 3] = (unsigned char)(value * 17);
+			}
+		}
+	}
+
+	static void _decodeBc3Alpha(unsigned char* block, unsigned char* dest, int destPitch)
+	{
+		int alphas[8];
+		alphas[0] = block[0];
+		alphas[1] = block[1];
+		if (alphas[0] > alphas[1])
+		{
+			for_iter (i, 1, 7)
+			{
+				alphas[i + 1] = ((7 - i) * alphas[0] + i * alphas[1]) / 7;
+			}
+		}
+		else
+		{
+			for_iter (i, 1, 5)
+			{
+				alphas[i + 1] = ((5 - i) * alphas[0] + i * alphas[1]) / 5;
+			}
+			alphas[6] = 0;
+			alphas[7] = 255;
+		}
+		// 16 indices with 3 bits each
+		unsigned long long indices = 0;
+		for_iter (i, 0, 6)
+		{
+			indices |= (unsigned long long)block[2 + i] << (i * 8);
+		}
+		for_iter (y, 0, 4)
+		{
+			for_iter (x, 0, 4)
+			{
+				dest[y * destPitch + x * 4 + 3] = (unsigned char)alphas[(indices >> ((y * 4 + x) * 3)) & 0x7];
+			}
+		}
+	}
+
+	static void _decodeEtcBlock(unsigned char* block, unsigned char* dest, int destPitch, bool etc2, bool punchthrough)
+	{
+		unsigned int high = (block[0] << 24) | (block[1] << 16) | (block[2] << 8) | block[3];
+		unsigned int low = (block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+		// with punchthrough alpha the differential bit says whether the block is opaque
+		bool differential = (punchthrough || (high & 0x2) != 0);
+		bool opaque = (!punchthrough || (high & 0x2) != 0);
+		int base[2][3];
+		int paint[4][3];
+		bool usePaint = false;
+		if (!differential)
+		{
+			for_iter (j, 0, 3)
+			{
+				base[0][j] = ((high >> (28 - j * 8)) & 0xF) * 17;
+				base[1][j] = ((high >> (24 - j * 8)) & 0xF) * 17;
+			}
+		}
+		else
+		{
+			int color[3];
+			int delta[3];
+			for_iter (j, 0, 3)
+			{
+				color[j] = (high >> (27 - j * 8)) & 0x1F;
+				delta[j] = (high >> (24 - j * 8)) & 0x7;
+				if (delta[j] >= 4)
+				{
+					delta[j] -= 8;
+				}
+			}
+			int r = 0;
+			int g = 0;
+			int b = 0;
+			if (etc2 && (color[0] + delta[0] < 0 || color[0] + delta[0] > 31))
+			{
+				// T mode
+				int distance = etcDistances[((high >> 1) & 0x6) | (high & 0x1)];
+				r = (((high >> 27) & 0x3) << 2) | ((high >> 24) & 0x3);
+				g = (high >> 20) & 0xF;
+				b = (high >> 16) & 0xF;
+				paint[0][0] = r * 17;
+				paint[0][1] = g * 17;
+				paint[0][2] = b * 17;
+				r = ((high >> 12) & 0xF) * 17;
+				g = ((high >> 8) & 0xF) * 17;
+				b = ((high >> 4) & 0xF) * 17;
+				for_iter (j, 0, 3)
+				{
+					paint[2][j] = (j == 0 ? r : (j == 1 ? g : b));
+					paint[1][j] = paint[2][j] + distance;
+					paint[3][j] = paint[2][j] - distance;
+				}
+				usePaint = true;
+			}
+			else if (etc2 && (color[1] + delta[1] < 0 || color[1] + delta[1] > 31))
+			{
+				// H mode
+				int r1 = (high >> 27) & 0xF;
+				int g1 = (((high >> 24) & 0x7) << 1) | ((high >> 20) & 0x1);
+				int b1 = (((high >> 19) & 0x1) << 3) | ((high >> 15) & 0x7);
+				int r2 = (high >> 11) & 0xF;
+				int g2 = (high >> 7) & 0xF;
+				int b2 = (high >> 3) & 0xF;
+				int index = (((high >> 2) & 0x1) << 2) | ((high & 0x1) << 1);
+				if (((r1 << 8) | (g1 << 4) | b1) >= ((r2 << 8) | (g2 << 4) | b2))
+				{
+					index |= 1;
+				}
+				int distance = etcDistances[index];
+				int first[3] = {r1 * 17, g1 * 17, b1 * 17};
+				int second[3] = {r2 * 17, g2 * 17, b2 * 17};
+				for_iter (j, 0, 3)
+				{
+					paint[0][j] = first[j] + distance;
+					paint[1][j] = first[j] - distance;
+					paint[2][j] = second[j] + distance;
+					paint[3][j] = second[j] - distance;
+				}
+				usePaint = true;
+			}
+			else if (etc2 && (color[2] + delta[2] < 0 || color[2] + delta[2] > 31))
+			{
+				// planar mode, the colors are interpolated across the block and the block is always opaque
+				int origin[3];
+				int horizontal[3];
+				int vertical[3];
+				origin[0] = (high >> 25) & 0x3F;
+				origin[1] = (((high >> 24) & 0x1) << 6) | ((high >> 17) & 0x3F);
+				origin[2] = (((high >> 16) & 0x1) << 5) | (((high >> 11) & 0x3) << 3) | ((high >> 7) & 0x7);
+				horizontal[0] = (((high >> 2) & 0x1F) << 1) | (high & 0x1);
+				horizontal[1] = (low >> 25) & 0x7F;
+				horizontal[2] = (low >> 19) & 0x3F;
+				vertical[0] = (low >> 13) & 0x3F;
+				vertical[1] = (low >> 6) & 0x7F;
+				vertical[2] = low & 0x3F;
+				for_iter (j, 0, 3)
+				{
+					if (j == 1)
+					{
+						origin[j] = (origin[j] << 1) | (origin[j] >> 6);
+						horizontal[j] = (horizontal[j] << 1) | (horizontal[j] >> 6);
+						vertical[j] = (vertical[j] << 1) | (vertical[j] >> 6);
+					}
+					else
+					{
+						origin[j] = (origin[j] << 2) | (origin[j] >> 4);
+						horizontal[j] = (horizontal[j] << 2) | (horizontal[j] >> 4);
+						vertical[j] = (vertical[j] << 2) | (vertical[j] >> 4);
+					}
+				}
+				unsigned char* pixel = NULL;
+				for_iter (y, 0, 4)
+				{
+					for_iter (x, 0, 4)
+					{
+						pixel = &dest[y * destPitch + x * 4];
+						for_iter (j, 0, 3)
+						{
+							pixel[j] = _clamp255((x * (horizontal[j] - origin[j]) + y * (vertical[j] - origin[j]) + 4 * origin[j] + 2) >> 2);
+						}
+						pixel[3] = 255;
+					}
+				}
+				return;
+			}
+			int sum = 0;
+			for_iter (j, 0, 3)
+			{
+				sum = (color[j] + delta[j]) & 0x1F; // only ETC1 data can overflow here and it's not valid anyway
+				base[0][j] = (color[j] << 3) | (color[j] >> 2);
+				base[1][j] = (sum << 3) | (sum >> 2);
+			}
+		}
+		// the indices are stored column by column, the most significant bits first
+		int index = 0;
+		int subBlock = 0;
+		int modifier = 0;
+		bool flip = ((high & 0x1) != 0);
+		unsigned char* pixel = NULL;
+		for_iter (y, 0, 4)
+		{
+			for_iter (x, 0, 4)
+			{
+				pixel = &dest[y * destPitch + x * 4];
+				index = (((low >> (x * 4 + y + 16)) & 0x1) << 1) | ((low >> (x * 4 + y)) & 0x1);
+				if (!opaque && index == 2)
+				{
+					pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+					continue;
+				}
+				if (usePaint)
+				{
+					_setRgb(pixel, paint[index][0], paint[index][1], paint[index][2]);
+				}
+				else
+				{
+					subBlock = (flip ? y / 2 : x / 2);
+					modifier = etcModifiers[(high >> (subBlock == 0 ? 5 : 2)) & 0x7][index & 0x1];
+					if (!opaque && index == 0) // the smaller modifier isn't available in non-opaque blocks
+					{
+						modifier = 0;
+					}
+					if (index >= 2)
+					{
+						modifier = -modifier;
+					}
+					_setRgb(pixel, base[subBlock][0] + modifier, base[subBlock][1] + modifier, base[subBlock][2] + modifier);
+				}
+				pixel[3] = 255;
+			}
+		}
+	}
+
+	static void _decodeEacAlpha(unsigned char* block, unsigned char* dest, int destPitch)
+	{
+		int base = block[0];
+		int multiplier = block[1] >> 4;
+		int* modifiers = eacModifiers[block[1] & 0xF];
+		unsigned long long indices = 0;
+		for_iter (i, 0, 6)
+		{
+			indices = (indices << 8) | block[2 + i];
+		}
+		// the indices are stored column by column, the first pixel in the most significant bits
+		for_iter (x, 0, 4)
+		{
+			for_iter (y, 0, 4)
+			{
+				dest[y * destPitch + x * 4 + 3] = _clamp255(base + modifiers[(indices >> (45 - (x * 4 + y) * 3)) & 0x7] * multiplier);
+			}
+		}
+	}
+
+	int Image::getCompressedSize(int w, int h, int compression)
+	{
+		int blocks = ((w + 3) / 4) * ((h + 3) / 4);
+		switch (compression)
+		{
+		case COMPRESSION_BC1_RGB:
+		case COMPRESSION_BC1_RGBA:
+		case COMPRESSION_ETC1:
+		case COMPRESSION_ETC2_RGB:
+		case COMPRESSION_ETC2_RGB_A1:
+			return (blocks * 8);
+		case COMPRESSION_BC2:
+		case COMPRESSION_BC3:
+		case COMPRESSION_ETC2_RGBA:
+			return (blocks * 16);
+		// PVRTC blocks have 8 bytes and every level has at least 2x2 blocks
+		case COMPRESSION_PVRTC_RGB_4BPP:
+		case COMPRESSION_PVRTC_RGBA_4BPP:
+			return (hmax((w + 3) / 4, 2) * hmax((h + 3) / 4, 2) * 8);
+		case COMPRESSION_PVRTC_RGB_2BPP:
+		case COMPRESSION_PVRTC_RGBA_2BPP:
+			return (hmax((w + 7) / 8, 2) * hmax((h + 3) / 4, 2) * 8);
+		default:
+			break;
+		}
+		return 0;
+	}
+
+	int Image::getCompressedSize(int w, int h, int compression, int mipmapLevels)
+	{
+		int size = 0;
+		for_iter (i, 0, mipmapLevels)
+		{
+			size += Image::getCompressedSize(hmax(w >> i, 1), hmax(h >> i, 1), compression);
+		}
+		return size;
+	}
+
+	bool Image::isDecompressionSupported(int compression)
+	{
+		switch (compression)
+		{
+		case COMPRESSION_PVRTC_RGB_4BPP:
+		case COMPRESSION_PVRTC_RGB_2BPP:
+		case COMPRESSION_PVRTC_RGBA_4BPP:
+		case COMPRESSION_PVRTC_RGBA_2BPP:
+			return false;
+		default:
+			break;
+		}
+		return (Image::getCompressedSize(4, 4, compression) > 0);
+	}
+
+	bool Image::decompress(int w, int h, unsigned char* srcData, int compression, unsigned char** destData, Image::Format destFormat)
+	{
+		if (!Image::isDecompressionSupported(compression))
+		{
+			hlog::errorf(april::logTag, "Cannot decompress data with compression 0x%X!", compression);
+			return false;
+		}
+		int blockSize = Image::getCompressedSize(4, 4, compression);
+		int blocksWidth = (w + 3) / 4;
+		int blocksHeight = (h + 3) / 4;
+		// blocks are always decoded completely so edge blocks get a separate buffer
+		int pitch = blocksWidth * 16;
+		unsigned char* rgbaData = new unsigned char[pitch * blocksHeight * 4];
+		unsigned char* block = srcData;
+		unsigned char* dest = NULL;
+		for_iter (j, 0, blocksHeight)
+		{
+			for_iter (i, 0, blocksWidth)
+			{
+				dest = &rgbaData[j * 4 * pitch + i * 16];
+				switch (compression)
+				{
+				case COMPRESSION_BC1_RGB:
+					_decodeBc1Block(block, dest, pitch, false, false);
+					break;
+				case COMPRESSION_BC1_RGBA:
+					_decodeBc1Block(block, dest, pitch, false, true);
+					break;
+				case COMPRESSION_BC2:
+					_decodeBc1Block(&block[8], dest, pitch, true, false);
+					_decodeBc2Alpha(block, dest, pitch);
+					break;
+				case COMPRESSION_BC3:
+					_decodeBc1Block(&block[8], dest, pitch, true, false);
+					_decodeBc3Alpha(block, dest, pitch);
+					break;
+				case COMPRESSION_ETC1:
+					_decodeEtcBlock(block, dest, pitch, false, false);
+					break;
+				case COMPRESSION_ETC2_RGB:
+					_decodeEtcBlock(block, dest, pitch, true, false);
+					break;
+				case COMPRESSION_ETC2_RGB_A1:
+					_decodeEtcBlock(block, dest, pitch, true, true);
+					break;
+				case COMPRESSION_ETC2_RGBA:
+					_decodeEtcBlock(&block[8], dest, pitch, true, false);
+					_decodeEacAlpha(block, dest, pitch);
+					break;
+				}
+				block += blockSize;
+			}
+		}
+		View src(rgbaData, w, h, pitch, FORMAT_RGBA);
+		bool createData = (*destData == NULL);
+		if (createData)
+		{
+			*destData = new unsigned char[w * h * Image::getFormatBpp(destFormat)];
+		}
+		bool result = Image::convertToFormat(src, View(*destData, w, h, destFormat));
+		if (!result && createData)
+		{
+			delete [] *destData;
+			*destData = NULL;
+		}
+		delete [] rgbaData;
+		return result;
+	}
+
+}
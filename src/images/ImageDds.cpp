@@ -0,0 +1,159 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
+
+#include "april.h"
+#include "Image.h"
+
+#define DDS_FOURCC(a, b, c, d) ((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+#define DDS_HEADER_SIZE 124
+#define DDS_DX10_HEADER_SIZE 20
+// bigger sizes are treated as damaged files, no GPU supports them anyway
+#define DDS_MAX_SIZE 16384
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDPF_ALPHAPIXELS 0x1
+#define DDPF_FOURCC 0x4
+
+// DXGI_FORMAT values of the supported compressions
+#define DXGI_FORMAT_BC1_UNORM 71
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72
+#define DXGI_FORMAT_BC2_UNORM 74
+#define DXGI_FORMAT_BC2_UNORM_SRGB 75
+#define DXGI_FORMAT_BC3_UNORM 77
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78
+
+namespace april
+{
+	static inline unsigned int _getDdsValue(unsigned char* bytes)
+	{
+		return (bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24));
+	}
+
+	// reads all headers and returns the compression, 0 if the file can't be used
+	static int _readDdsHeader(hsbase& stream, int& w, int& h, int& mipmapLevels)
+	{
+		unsigned char header[4 + DDS_HEADER_SIZE] = {0};
+		if (stream.read_raw(header, sizeof(header)) != sizeof(header) || _getDdsValue(header) != DDS_FOURCC('D', 'D', 'S', ' ') ||
+			_getDdsValue(&header[4]) != DDS_HEADER_SIZE)
+		{
+			hlog::error(april::logTag, "Not a DDS file!");
+			return 0;
+		}
+		h = (int)_getDdsValue(&header[12]);
+		w = (int)_getDdsValue(&header[16]);
+		mipmapLevels = ((_getDdsValue(&header[8]) & DDSD_MIPMAPCOUNT) != 0 ? (int)_getDdsValue(&header[28]) : 1);
+		// the pixel format is at offset 72 of the header
+		unsigned int flags = _getDdsValue(&header[4 + 76]);
+		unsigned int fourCC = _getDdsValue(&header[4 + 80]);
+		int compression = 0;
+		if ((flags & DDPF_FOURCC) != 0)
+		{
+			if (fourCC == DDS_FOURCC('D', 'X', 'T', '1'))
+			{
+				compression = ((flags & DDPF_ALPHAPIXELS) != 0 ? Image::COMPRESSION_BC1_RGBA : Image::COMPRESSION_BC1_RGB);
+			}
+			else if (fourCC == DDS_FOURCC('D', 'X', 'T', '3'))
+			{
+				compression = Image::COMPRESSION_BC2;
+			}
+			else if (fourCC == DDS_FOURCC('D', 'X', 'T', '5'))
+			{
+				compression = Image::COMPRESSION_BC3;
+			}
+			else if (fourCC == DDS_FOURCC('D', 'X', '1', '0'))
+			{
+				unsigned char dx10Header[DDS_DX10_HEADER_SIZE] = {0};
+				if (stream.read_raw(dx10Header, DDS_DX10_HEADER_SIZE) != DDS_DX10_HEADER_SIZE)
+				{
+					hlog::error(april::logTag, "DDS DX10 header is incomplete!");
+					return 0;
+				}
+				switch (_getDdsValue(dx10Header))
+				{
+				case DXGI_FORMAT_BC1_UNORM:
+				case DXGI_FORMAT_BC1_UNORM_SRGB:
+					compression = Image::COMPRESSION_BC1_RGBA;
+					break;
+				case DXGI_FORMAT_BC2_UNORM:
+				case DXGI_FORMAT_BC2_UNORM_SRGB:
+					compression = Image::COMPRESSION_BC2;
+					break;
+				case DXGI_FORMAT_BC3_UNORM:
+				case DXGI_FORMAT_BC3_UNORM_SRGB:
+					compression = Image::COMPRESSION_BC3;
+					break;
+				}
+			}
+		}
+		if (compression == 0)
+		{
+			hlog::error(april::logTag, "Only DDS files with DXT1, DXT3 or DXT5 compression are supported!");
+			return 0;
+		}
+		if (w <= 0 || h <= 0 || w > DDS_MAX_SIZE || h > DDS_MAX_SIZE)
+		{
+			hlog::error(april::logTag, "DDS header is damaged!");
+			return 0;
+		}
+		mipmapLevels = hclamp(mipmapLevels, 1, Image::getMipmapCount(w, h));
+		return compression;
+	}
+
+	Image* Image::_loadDds(hsbase& stream)
+	{
+		int w = 0;
+		int h = 0;
+		int levels = 1;
+		int compression = _readDdsHeader(stream, w, h, levels);
+		if (compression == 0)
+		{
+			return NULL;
+		}
+		// all mipmap levels follow each other directly
+		int size = Image::getCompressedSize(w, h, compression, levels);
+		if (size > (long long)stream.size() - stream.position())
+		{
+			hlog::error(april::logTag, "DDS image data is incomplete!");
+			return NULL;
+		}
+		Image* image = new Image();
+		image->data = new unsigned char[size];
+		if (stream.read_raw(image->data, size) != size)
+		{
+			hlog::error(april::logTag, "DDS image data is incomplete!");
+			delete image;
+			return NULL;
+		}
+		image->w = w;
+		image->h = h;
+		image->format = FORMAT_COMPRESSED;
+		image->internalFormat = compression;
+		image->compressedSize = size;
+		image->mipmapLevels = levels;
+		return image;
+	}
+
+	bool Image::_probeDds(hsbase& stream, Image::Info& info)
+	{
+		int levels = 1;
+		int compression = _readDdsHeader(stream, info.w, info.h, levels);
+		if (compression == 0)
+		{
+			return false;
+		}
+		info.channels = (compression == COMPRESSION_BC1_RGB ? 3 : 4);
+		info.bitDepth = 8;
+		info.format = FORMAT_COMPRESSED;
+		return true;
+	}
+
+}
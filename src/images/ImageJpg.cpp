@@ -23,11 +23,49 @@ extern "C"
 
 namespace april
 {
-	Image* Image::_loadJpg(hsbase& stream, int size)
+#ifdef JCS_EXTENSIONS
+	// libjpeg-turbo can write 3 and 4 BPP layouts directly, the X byte is filled with 0xFF so it can be used as opaque alpha
+	static J_COLOR_SPACE _getJpgColorSpace(Image::Format format)
+	{
+		switch (format)
+		{
+		case Image::FORMAT_RGB:
+			return JCS_RGB;
+		case Image::FORMAT_BGR:
+			return JCS_EXT_BGR;
+		case Image::FORMAT_RGBA:
+		case Image::FORMAT_RGBX:
+		case Image::FORMAT_RGBA_PREMULTIPLIED:
+			return JCS_EXT_RGBX;
+		case Image::FORMAT_BGRA:
+		case Image::FORMAT_BGRX:
+		case Image::FORMAT_BGRA_PREMULTIPLIED:
+			return JCS_EXT_BGRX;
+		case Image::FORMAT_ARGB:
+		case Image::FORMAT_XRGB:
+			return JCS_EXT_XRGB;
+		case Image::FORMAT_ABGR:
+		case Image::FORMAT_XBGR:
+			return JCS_EXT_XBGR;
+		default:
+			break;
+		}
+		return JCS_UNKNOWN;
+	}
+#endif
+
+	Image* Image::_loadJpg(hsbase& stream, int size, Image::Format format, int downscale)
 	{
 		// first read the whole data from the resource file
 		unsigned char* compressedData = new unsigned char[size];
 		stream.read_raw(compressedData, size);
+		Image* image = Image::_loadJpg(compressedData, size, format, downscale);
+		delete [] compressedData;
+		return image;
+	}
+
+	Image* Image::_loadJpg(unsigned char* compressedData, int size, Image::Format format, int downscale)
+	{
 		// read JPEG image from file data
 		struct jpeg_decompress_struct cInfo;
 		struct jpeg_error_mgr jErr;
@@ -35,29 +73,178 @@ namespace april
 		jpeg_create_decompress(&cInfo);
 		jpeg_mem_src(&cInfo, compressedData, size);
 		jpeg_read_header(&cInfo, TRUE);
+		// scaling is done in the IDCT so the full size image is never decoded
+		cInfo.scale_num = 1;
+		cInfo.scale_denom = downscale;
+		Image::Format decodedFormat = Image::FORMAT_RGB; // JPEG is always RGB
+#ifdef JCS_EXTENSIONS
+		J_COLOR_SPACE colorSpace = _getJpgColorSpace(format);
+		if (colorSpace != JCS_UNKNOWN)
+		{
+			// JPEG data is always opaque so premultiplied alpha doesn't change anything
+			cInfo.out_color_space = colorSpace;
+			decodedFormat = format;
+		}
+#endif
 		jpeg_start_decompress(&cInfo);
-		unsigned char* imageData = new unsigned char[cInfo.output_width * cInfo.output_height * 3]; // JPEG is always RGB
-		unsigned char* ptr = NULL;
+		if (cInfo.output_components == 1) // grayscale JPEGs that weren't expanded
+		{
+			decodedFormat = Image::FORMAT_GRAYSCALE;
+		}
+		int rowSize = cInfo.output_width * cInfo.output_components;
+		unsigned char* imageData = new unsigned char[rowSize * cInfo.output_height];
+		unsigned char** rowPointers = new unsigned char*[cInfo.output_height];
 		for_itert (unsigned int, i, 0, cInfo.output_height)
 		{
-			ptr = imageData + i * cInfo.output_width * 3;
-			jpeg_read_scanlines(&cInfo, &ptr, 1);
+			rowPointers[i] = imageData + i * rowSize;
+		}
+		// the decoder returns as many scanlines per call as it can
+		while (cInfo.output_scanline < cInfo.output_height)
+		{
+			jpeg_read_scanlines(&cInfo, &rowPointers[cInfo.output_scanline], cInfo.output_height - cInfo.output_scanline);
 		}
 		jpeg_finish_decompress(&cInfo);
 		jpeg_destroy_decompress(&cInfo);
-		delete [] compressedData;
+		delete [] rowPointers;
 		// assign Image data
 		Image* image = new Image();
 		image->data = imageData;
 		image->w = cInfo.output_width;
 		image->h = cInfo.output_height;
-		image->format = Image::FORMAT_RGB; // JPEG is always RGB
+		image->format = decodedFormat;
 		return image;
 	}
 
-	Image* Image::_loadJpg(hsbase& stream)
+	Image* Image::_loadJpg(hsbase& stream, Image::Format format, int downscale)
+	{
+		return Image::_loadJpg(stream, stream.size(), format, downscale);
+	}
+
+	bool Image::_readJpgBands(hsbase& stream, Image::Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args)
+	{
+		// only the compressed data is kept in memory as a whole
+		int size = stream.size();
+		unsigned char* compressedData = new unsigned char[size];
+		stream.read_raw(compressedData, size);
+		struct jpeg_decompress_struct cInfo;
+		struct jpeg_error_mgr jErr;
+		cInfo.err = jpeg_std_error(&jErr);
+		jpeg_create_decompress(&cInfo);
+		jpeg_mem_src(&cInfo, compressedData, size);
+		jpeg_read_header(&cInfo, TRUE);
+		Image::Format decodedFormat = Image::FORMAT_RGB; // JPEG is always RGB
+#ifdef JCS_EXTENSIONS
+		J_COLOR_SPACE colorSpace = _getJpgColorSpace(format);
+		if (colorSpace != JCS_UNKNOWN)
+		{
+			cInfo.out_color_space = colorSpace;
+			decodedFormat = format;
+		}
+#endif
+		jpeg_start_decompress(&cInfo);
+		if (cInfo.output_components == 1) // grayscale JPEGs that weren't expanded
+		{
+			decodedFormat = Image::FORMAT_GRAYSCALE;
+		}
+		int width = cInfo.output_width;
+		int height = cInfo.output_height;
+		int rowSize = width * cInfo.output_components;
+		int rows = hmin(bandHeight, height);
+		unsigned char* bandData = new unsigned char[rowSize * rows];
+		unsigned char** rowPointers = new unsigned char*[rows];
+		for_iter (i, 0, rows)
+		{
+			rowPointers[i] = bandData + i * rowSize;
+		}
+		unsigned char* convertedData = NULL;
+		int y = 0;
+		bool result = true;
+		while (result && (int)cInfo.output_scanline < height)
+		{
+			y = cInfo.output_scanline;
+			rows = hmin(bandHeight, height - y);
+			while ((int)cInfo.output_scanline < y + rows)
+			{
+				jpeg_read_scanlines(&cInfo, &rowPointers[cInfo.output_scanline - y], y + rows - cInfo.output_scanline);
+			}
+			result = Image::_passBand(View(bandData, width, rows, decodedFormat), y, format, &convertedData, callback, args);
+		}
+		if (result)
+		{
+			jpeg_finish_decompress(&cInfo);
+		}
+		else
+		{
+			jpeg_abort_decompress(&cInfo);
+		}
+		jpeg_destroy_decompress(&cInfo);
+		delete [] rowPointers;
+		delete [] bandData;
+		if (convertedData != NULL)
+		{
+			delete [] convertedData;
+		}
+		delete [] compressedData;
+		return result;
+	}
+
+	bool Image::_probeJpg(hsbase& stream, Image::Info& info)
 	{
-		return Image::_loadJpg(stream, stream.size());
+		// libjpeg needs the whole file in memory so the markers up to the frame header are parsed manually
+		unsigned char bytes[6] = {0};
+		if (stream.read_raw(bytes, 2) != 2 || bytes[0] != 0xFF || bytes[1] != 0xD8) // SOI
+		{
+			return false;
+		}
+		unsigned char marker = 0;
+		int length = 0;
+		while (true)
+		{
+			if (stream.read_raw(&marker, 1) != 1 || marker != 0xFF)
+			{
+				return false;
+			}
+			// markers can be padded with any number of 0xFF bytes
+			while (marker == 0xFF)
+			{
+				if (stream.read_raw(&marker, 1) != 1)
+				{
+					return false;
+				}
+			}
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) // markers without a segment
+			{
+				continue;
+			}
+			if (marker == 0xD9 || marker == 0xDA) // EOI or SOS before any frame header
+			{
+				return false;
+			}
+			if (stream.read_raw(bytes, 2) != 2)
+			{
+				return false;
+			}
+			length = (bytes[0] << 8) + bytes[1];
+			if (length < 2)
+			{
+				return false;
+			}
+			// SOF0 to SOF15, except DHT, JPG and DAC which share the range
+			if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+				if (length < 8 || stream.read_raw(bytes, 6) != 6)
+				{
+					return false;
+				}
+				info.bitDepth = bytes[0];
+				info.h = (bytes[1] << 8) + bytes[2];
+				info.w = (bytes[3] << 8) + bytes[4];
+				info.channels = bytes[5];
+				info.format = (info.channels == 1 ? FORMAT_GRAYSCALE : FORMAT_RGB);
+				return (info.w > 0 && info.h > 0); // a height of 0 would be defined later in the file
+			}
+			stream.seek(length - 2);
+		}
 	}
 
 }
@@ -7,34 +7,193 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
 
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hsbase.h>
 #include <hltypes/hstream.h>
+#include <hltypes/hthread.h>
 
 #include "Image.h"
 
 namespace april
 {
-	Image* Image::_loadJpt(hsbase& stream)
+	/// @brief Decodes the JPEG part from memory while the PNG part is being read from the stream.
+	class JptColorThread : public hthread
 	{
-		Image* jpg = NULL;
-		Image* png = NULL;
+	public:
+		unsigned char* compressedData;
+		int size;
+		Image::Format format;
+		int downscale;
+		Image* image;
+
+		JptColorThread(void (*function)(hthread*), unsigned char* compressedData, int size, Image::Format format, int downscale) : hthread(function)
+		{
+			this->compressedData = compressedData;
+			this->size = size;
+			this->format = format;
+			this->downscale = downscale;
+			this->image = NULL;
+		}
+
+	};
+
+	void Image::_loadJptColor(hthread* thread)
+	{
+		JptColorThread* colorThread = (JptColorThread*)thread;
+		colorThread->image = Image::_loadJpg(colorThread->compressedData, colorThread->size, colorThread->format, colorThread->downscale);
+	}
+
+	static inline int _getJptSize(unsigned char* bytes)
+	{
+		return (bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
+	}
+
+	Image* Image::_loadJpt(hsbase& stream, Image::Format format, int downscale)
+	{
+		return Image::_loadJpt(&stream, NULL, stream.size(), format, downscale);
+	}
+
+	Image* Image::_loadJpt(unsigned char* data, int size, Image::Format format, int downscale)
+	{
+		return Image::_loadJpt(NULL, data, size, format, downscale);
+	}
+
+	Image* Image::_loadJpt(hsbase* stream, unsigned char* data, int size, Image::Format format, int downscale)
+	{
+		// the color channels are decoded directly into the final 4 BPP layout and only the alpha channel is written afterwards
+		Image::Format colorFormat = FORMAT_RGBA;
+		bool hasAlpha = true;
+		switch (format)
+		{
+		case FORMAT_RGBA:
+		case FORMAT_ARGB:
+		case FORMAT_BGRA:
+		case FORMAT_ABGR:
+			colorFormat = format;
+			break;
+		case FORMAT_BGRA_PREMULTIPLIED:
+			colorFormat = FORMAT_BGRA;
+			break;
+		case FORMAT_RGBX:
+		case FORMAT_XRGB:
+		case FORMAT_BGRX:
+		case FORMAT_XBGR:
+		case FORMAT_RGB:
+		case FORMAT_BGR:
+			// the alpha part would be discarded anyway
+			colorFormat = format;
+			hasAlpha = false;
+			break;
+		default:
+			break;
+		}
 		unsigned char bytes[4] = {0};
-		// file header ("JPT" + 1 byte for version code)
-		stream.read_raw(bytes, 4);
-		// read JPEG
-		stream.read_raw(bytes, 4);
-		jpg = Image::_loadJpg(stream, bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
-		// read PNG
-		stream.read_raw(bytes, 4);
-		png = Image::_loadPng(stream, bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
-		png->format = FORMAT_ALPHA;
-		// combine
-		Image* image = Image::create(jpg->w, jpg->h, Color::Clear, FORMAT_RGBA);
-		image->write(0, 0, jpg->w, jpg->h, 0, 0, jpg);
-		image->write(0, 0, png->w, png->h, 0, 0, png);
-		delete jpg;
-		delete png;
+		unsigned char* jpgData = NULL;
+		int jpgSize = 0;
+		unsigned char* pngData = NULL;
+		int pngSize = 0;
+		if (stream != NULL)
+		{
+			// file header ("JPT" + 1 byte for version code)
+			stream->read_raw(bytes, 4);
+			// read JPEG
+			stream->read_raw(bytes, 4);
+			jpgSize = _getJptSize(bytes);
+			jpgData = new unsigned char[jpgSize];
+			stream->read_raw(jpgData, jpgSize);
+			// the PNG is decoded directly from the stream
+			stream->read_raw(bytes, 4);
+			pngSize = _getJptSize(bytes);
+		}
+		else
+		{
+			// both parts are decoded directly from memory, the header is skipped
+			jpgSize = (size >= 8 ? _getJptSize(&data[4]) : -1);
+			if (jpgSize < 0 || jpgSize > size - 12)
+			{
+				return NULL;
+			}
+			jpgData = &data[8];
+			pngSize = hclamp(_getJptSize(&data[8 + jpgSize]), 0, size - 12 - jpgSize);
+			pngData = &data[12 + jpgSize];
+		}
+		Image* image = NULL;
+		Image* alpha = NULL;
+		if (!hasAlpha)
+		{
+			image = Image::_loadJpg(jpgData, jpgSize, colorFormat, downscale);
+		}
+		else if (Image::getThreadCount() > 1)
+		{
+			// both parts are independent so they can be decoded at the same time
+			JptColorThread colorThread(&Image::_loadJptColor, jpgData, jpgSize, colorFormat, downscale);
+			colorThread.start();
+			alpha = Image::_loadPng(stream, pngData, pngSize, FORMAT_INVALID, downscale);
+			colorThread.join();
+			image = colorThread.image;
+		}
+		else
+		{
+			image = Image::_loadJpg(jpgData, jpgSize, colorFormat, downscale);
+			alpha = Image::_loadPng(stream, pngData, pngSize, FORMAT_INVALID, downscale);
+		}
+		if (stream != NULL)
+		{
+			delete [] jpgData;
+		}
+		if (image != NULL && image->format != colorFormat)
+		{
+			// the JPEG decoder can't produce every layout directly
+			unsigned char* data = NULL;
+			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, colorFormat))
+			{
+				delete [] image->data;
+				image->data = data;
+				image->format = colorFormat;
+			}
+		}
+		if (alpha != NULL)
+		{
+			// combine
+			if (image != NULL)
+			{
+				alpha->format = FORMAT_ALPHA;
+				image->write(0, 0, alpha->w, alpha->h, 0, 0, alpha);
+			}
+			delete alpha;
+		}
+		if (image != NULL && Image::isPremultipliedFormat(format))
+		{
+			Image::_premultiplyAlpha(image->getView());
+			image->format = format;
+		}
 		return image;
 	}
 
+	bool Image::_probeJpt(hsbase& stream, Image::Info& info)
+	{
+		unsigned char bytes[4] = {0};
+		// file header ("JPT" + 1 byte for version code)
+		if (stream.read_raw(bytes, 4) != 4 || stream.read_raw(bytes, 4) != 4)
+		{
+			return false;
+		}
+		int jpgSize = _getJptSize(bytes);
+		int position = (int)stream.position();
+		if (!Image::_probeJpg(stream, info))
+		{
+			return false;
+		}
+		// the PNG header is checked as well, only the alpha channel is used from it
+		stream.seek(position + jpgSize, hsbase::START);
+		Image::Info alphaInfo;
+		if (stream.read_raw(bytes, 4) != 4 || !Image::_probePng(stream, alphaInfo))
+		{
+			return false;
+		}
+		info.channels = 4;
+		info.format = FORMAT_RGBA;
+		return true;
+	}
+
 }
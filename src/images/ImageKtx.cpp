@@ -0,0 +1,190 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <string.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
+
+#include "april.h"
+#include "Image.h"
+
+#define KTX_ENDIANNESS 0x04030201
+#define KTX_ENDIANNESS_SWAPPED 0x01020304
+// bigger sizes are treated as damaged files, no GPU supports them anyway
+#define KTX_MAX_SIZE 16384
+
+namespace april
+{
+	static unsigned char ktxIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+	/// @brief The fields of the KTX header after the identifier, in file order.
+	struct KtxHeader
+	{
+		unsigned int endianness;
+		unsigned int glType;
+		unsigned int glTypeSize;
+		unsigned int glFormat;
+		unsigned int glInternalFormat;
+		unsigned int glBaseInternalFormat;
+		unsigned int pixelWidth;
+		unsigned int pixelHeight;
+		unsigned int pixelDepth;
+		unsigned int numberOfArrayElements;
+		unsigned int numberOfFaces;
+		unsigned int numberOfMipmapLevels;
+		unsigned int bytesOfKeyValueData;
+	};
+
+	static inline unsigned int _swapKtxValue(unsigned int value)
+	{
+		return ((value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24));
+	}
+
+	static bool _readKtxHeader(hsbase& stream, KtxHeader& header)
+	{
+		unsigned char identifier[12] = {0};
+		if (stream.read_raw(identifier, 12) != 12 || memcmp(identifier, ktxIdentifier, 12) != 0)
+		{
+			hlog::error(april::logTag, "Not a KTX file!");
+			return false;
+		}
+		unsigned int values[13] = {0};
+		if (stream.read_raw(values, sizeof(values)) != sizeof(values))
+		{
+			hlog::error(april::logTag, "KTX header is incomplete!");
+			return false;
+		}
+		// the file can be written in either byte order
+		unsigned char* bytes = (unsigned char*)values;
+		for_iter (i, 0, 13)
+		{
+			values[i] = bytes[i * 4] | (bytes[i * 4 + 1] << 8) | (bytes[i * 4 + 2] << 16) | ((unsigned int)bytes[i * 4 + 3] << 24);
+		}
+		if (values[0] == KTX_ENDIANNESS_SWAPPED)
+		{
+			// the endianness is kept so the image size can be swapped as well
+			for_iter (i, 1, 13)
+			{
+				values[i] = _swapKtxValue(values[i]);
+			}
+		}
+		else if (values[0] != KTX_ENDIANNESS)
+		{
+			hlog::error(april::logTag, "KTX header is damaged!");
+			return false;
+		}
+		memcpy(&header, values, sizeof(header));
+		if (header.glType != 0 || Image::getCompressedSize(4, 4, header.glInternalFormat) == 0)
+		{
+			hlog::errorf(april::logTag, "KTX internal format 0x%X is not supported!", header.glInternalFormat);
+			return false;
+		}
+		if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.numberOfArrayElements > 0 || header.numberOfFaces != 1)
+		{
+			hlog::error(april::logTag, "Only KTX files with a single 2D texture are supported!");
+			return false;
+		}
+		if (header.pixelWidth > KTX_MAX_SIZE || header.pixelHeight > KTX_MAX_SIZE)
+		{
+			hlog::errorf(april::logTag, "KTX image size %ux%u is too big!", header.pixelWidth, header.pixelHeight);
+			return false;
+		}
+		return true;
+	}
+
+	Image* Image::_loadKtx(hsbase& stream)
+	{
+		KtxHeader header;
+		if (!_readKtxHeader(stream, header))
+		{
+			return NULL;
+		}
+		long long remaining = (long long)stream.size() - stream.position();
+		if ((long long)header.bytesOfKeyValueData > remaining)
+		{
+			hlog::error(april::logTag, "KTX key value data is incomplete!");
+			return NULL;
+		}
+		stream.seek(header.bytesOfKeyValueData);
+		remaining -= header.bytesOfKeyValueData;
+		int w = header.pixelWidth;
+		int h = header.pixelHeight;
+		// 0 levels means that the mipmaps are supposed to be generated, only the full size is stored then
+		int levels = hclamp((int)header.numberOfMipmapLevels, 1, Image::getMipmapCount(w, h));
+		// every level is preceded by its size
+		long long fileSize = 0;
+		for_iter (i, 0, levels)
+		{
+			fileSize += 4 + (long long)Image::getCompressedSize(hmax(w >> i, 1), hmax(h >> i, 1), header.glInternalFormat);
+		}
+		if (fileSize > remaining)
+		{
+			hlog::error(april::logTag, "KTX image data is incomplete!");
+			return NULL;
+		}
+		int totalSize = (int)(fileSize - levels * 4);
+		Image* image = new Image();
+		image->data = new unsigned char[totalSize];
+		unsigned char* data = image->data;
+		unsigned char bytes[4] = {0};
+		int size = 0;
+		int expectedSize = 0;
+		for_iter (i, 0, levels)
+		{
+			if (stream.read_raw(bytes, 4) != 4)
+			{
+				hlog::error(april::logTag, "KTX image data is incomplete!");
+				delete image;
+				return NULL;
+			}
+			size = (header.endianness == KTX_ENDIANNESS_SWAPPED ? (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3] :
+				bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24));
+			expectedSize = Image::getCompressedSize(hmax(w >> i, 1), hmax(h >> i, 1), header.glInternalFormat);
+			if (size != expectedSize)
+			{
+				hlog::errorf(april::logTag, "KTX image size %d of level %d doesn't match the expected size %d!", size, i, expectedSize);
+				delete image;
+				return NULL;
+			}
+			// block sizes are multiples of 4 so there is never any mip padding
+			if (stream.read_raw(data, size) != size)
+			{
+				hlog::error(april::logTag, "KTX image data is incomplete!");
+				delete image;
+				return NULL;
+			}
+			data += size;
+		}
+		image->w = w;
+		image->h = h;
+		image->format = FORMAT_COMPRESSED;
+		image->internalFormat = header.glInternalFormat;
+		image->compressedSize = totalSize;
+		image->mipmapLevels = levels;
+		return image;
+	}
+
+	bool Image::_probeKtx(hsbase& stream, Image::Info& info)
+	{
+		KtxHeader header;
+		if (!_readKtxHeader(stream, header))
+		{
+			return false;
+		}
+		info.w = header.pixelWidth;
+		info.h = header.pixelHeight;
+		info.channels = (header.glBaseInternalFormat == 0x1907 ? 3 : 4); // GL_RGB
+		info.bitDepth = 8;
+		info.format = FORMAT_COMPRESSED;
+		return true;
+	}
+
+}
@@ -0,0 +1,246 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <math.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+
+#include "april.h"
+#include "Image.h"
+#include "ImagePacked.h"
+#include "ImageSimd.h"
+
+namespace april
+{
+	// sRGB values mapped to 16 bit linear values and 12 bit linear values mapped back to sRGB
+	static unsigned short _srgbToLinear[256];
+	static unsigned char _linearToSrgb[4096];
+	static bool _gammaTablesReady = false;
+	// mipmaps can be created on several threads at once, e.g. with asynchronous texture loading
+	static hmutex gammaTablesMutex;
+
+	static void _initGammaTables()
+	{
+		gammaTablesMutex.lock();
+		if (_gammaTablesReady)
+		{
+			gammaTablesMutex.unlock();
+			return;
+		}
+		double value = 0.0;
+		for_iter (i, 0, 256)
+		{
+			value = i / 255.0;
+			value = (value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4));
+			_srgbToLinear[i] = (unsigned short)(value * 65535.0 + 0.5);
+		}
+		for_iter (i, 0, 4096)
+		{
+			value = (i + 0.5) / 4096.0;
+			value = (value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055);
+			_linearToSrgb[i] = (unsigned char)hclamp((int)(value * 255.0 + 0.5), 0, 255);
+		}
+		_gammaTablesReady = true;
+		gammaTablesMutex.unlock();
+	}
+
+	/// @param[in] gamma Which channels are averaged in linear space, NULL averages all of them as they are.
+	/// @param[in] alpha Index of the straight alpha channel that the colors are weighted with, -1 if they aren't weighted.
+	static void _mipmapRowScalar(unsigned char* row0, unsigned char* row1, unsigned char* dest, int srcWidth, int destWidth, int bpp, int start, bool* gamma, int alpha)
+	{
+		int i0 = 0;
+		int i1 = 0;
+		int a[4] = {0, 0, 0, 0};
+		int weight = 0;
+		int sum = 0;
+		for_iter (i, start, destWidth)
+		{
+			// with an odd width the last column is used twice
+			i0 = i * 2 * bpp;
+			i1 = hmin(i * 2 + 1, srcWidth - 1) * bpp;
+			weight = 0;
+			if (alpha >= 0)
+			{
+				a[0] = row0[i0 + alpha];
+				a[1] = row0[i1 + alpha];
+				a[2] = row1[i0 + alpha];
+				a[3] = row1[i1 + alpha];
+				weight = a[0] + a[1] + a[2] + a[3];
+			}
+			for_iter (c, 0, bpp)
+			{
+				// transparent pixels don't contribute their color, otherwise it would bleed into the edges of visible areas
+				if (weight > 0 && c != alpha)
+				{
+					if (gamma != NULL && gamma[c])
+					{
+						sum = _srgbToLinear[row0[i0 + c]] * a[0] + _srgbToLinear[row0[i1 + c]] * a[1] + _srgbToLinear[row1[i0 + c]] * a[2] + _srgbToLinear[row1[i1 + c]] * a[3];
+						dest[i * bpp + c] = _linearToSrgb[((sum + weight / 2) / weight) >> 4];
+					}
+					else
+					{
+						sum = row0[i0 + c] * a[0] + row0[i1 + c] * a[1] + row1[i0 + c] * a[2] + row1[i1 + c] * a[3];
+						dest[i * bpp + c] = (unsigned char)((sum + weight / 2) / weight);
+					}
+				}
+				else if (gamma != NULL && gamma[c])
+				{
+					dest[i * bpp + c] = _linearToSrgb[(_srgbToLinear[row0[i0 + c]] + _srgbToLinear[row0[i1 + c]] +
+						_srgbToLinear[row1[i0 + c]] + _srgbToLinear[row1[i1 + c]] + 2) >> 6];
+				}
+				else
+				{
+					dest[i * bpp + c] = (unsigned char)((row0[i0 + c] + row0[i1 + c] + row1[i0 + c] + row1[i1 + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+
+#ifdef _SIMD_SSE
+	// averages 2x2 blocks of 4 BPP pixels, 2 destination pixels per step
+	static int _mipmapRow4Sse2(unsigned char* row0, unsigned char* row1, unsigned char* dest, int destWidth)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i rounding = _mm_set1_epi16(2);
+		__m128i top;
+		__m128i bottom;
+		__m128i low;
+		__m128i high;
+		int i = 0;
+		for (; i <= destWidth - 2; i += 2)
+		{
+			top = _mm_loadu_si128((__m128i*)&row0[i * 8]);
+			bottom = _mm_loadu_si128((__m128i*)&row1[i * 8]);
+			low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+			high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+			// horizontal neighbors are in different halves after this
+			low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high)), rounding);
+			_mm_storel_epi64((__m128i*)&dest[i * 4], _mm_packus_epi16(_mm_srli_epi16(low, 2), zero));
+		}
+		return i;
+	}
+#endif
+
+#ifdef _SIMD_NEON
+	// averages 2x2 blocks of 4 BPP pixels, 8 destination pixels per step
+	static int _mipmapRow4Neon(unsigned char* row0, unsigned char* row1, unsigned char* dest, int destWidth)
+	{
+		uint8x16x4_t top;
+		uint8x16x4_t bottom;
+		uint8x8x4_t result;
+		int i = 0;
+		for (; i <= destWidth - 8; i += 8)
+		{
+			top = vld4q_u8(&row0[i * 8]);
+			bottom = vld4q_u8(&row1[i * 8]);
+			for_iter (c, 0, 4)
+			{
+				result.val[c] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(top.val[c]), vpaddlq_u8(bottom.val[c])), 2);
+			}
+			vst4_u8(&dest[i * 4], result);
+		}
+		return i;
+	}
+#endif
+
+	int Image::getMipmapCount(int w, int h)
+	{
+		int size = hmax(w, h);
+		int count = 0;
+		while (size > 0)
+		{
+			size >>= 1;
+			++count;
+		}
+		return count;
+	}
+
+	bool Image::createMipmap(const View& src, unsigned char** destData, bool gammaCorrect)
+	{
+		int bpp = src.getBpp();
+		if (src.data == NULL || src.w <= 0 || src.h <= 0 || src.format == FORMAT_PALETTE || src.format == FORMAT_COMPRESSED || bpp == 0)
+		{
+			hlog::error(april::logTag, "Cannot create mipmap from this image data!");
+			return false;
+		}
+		int destWidth = hmax(src.w / 2, 1);
+		int destHeight = hmax(src.h / 2, 1);
+		if (CHECK_PACKED_FORMAT(src.format))
+		{
+			// averaging is done on whole channels, only the result is packed again
+			unsigned char* rgbaData = NULL;
+			unsigned char* mipmapData = NULL;
+			bool result = (Image::convertToFormat(src, &rgbaData, FORMAT_RGBA) &&
+				Image::createMipmap(View(rgbaData, src.w, src.h, FORMAT_RGBA), &mipmapData, gammaCorrect) &&
+				Image::convertToFormat(View(mipmapData, destWidth, destHeight, FORMAT_RGBA), destData, src.format));
+			if (rgbaData != NULL)
+			{
+				delete [] rgbaData;
+			}
+			if (mipmapData != NULL)
+			{
+				delete [] mipmapData;
+			}
+			return result;
+		}
+		int alpha = -1;
+		Image::_getFormatIndices(src.format, NULL, NULL, NULL, &alpha);
+		bool gamma[4] = {false, false, false, false};
+		bool* gammaChannels = NULL;
+		if (gammaCorrect && src.format != FORMAT_ALPHA)
+		{
+			_initGammaTables();
+			// alpha is coverage, not a color, so it stays linear
+			for_iter (c, 0, bpp)
+			{
+				gamma[c] = (c != alpha);
+			}
+			gammaChannels = gamma;
+		}
+		// premultiplied colors are already weighted and X formats have no alpha
+		int weightAlpha = -1;
+		if (src.format == FORMAT_RGBA || src.format == FORMAT_BGRA || src.format == FORMAT_ARGB || src.format == FORMAT_ABGR)
+		{
+			weightAlpha = alpha;
+		}
+		int features = (gammaChannels == NULL && weightAlpha < 0 && bpp == 4 && src.w >= 2 ? _getSimdFeatures() : 0);
+		if (*destData == NULL)
+		{
+			*destData = new unsigned char[destWidth * destHeight * bpp];
+		}
+		unsigned char* row0 = NULL;
+		unsigned char* row1 = NULL;
+		unsigned char* dest = NULL;
+		int done = 0;
+		for_iter (j, 0, destHeight)
+		{
+			// with an odd height the last row is used twice
+			row0 = src.getPixelData(0, j * 2);
+			row1 = src.getPixelData(0, hmin(j * 2 + 1, src.h - 1));
+			dest = &(*destData)[j * destWidth * bpp];
+			done = 0;
+#ifdef _SIMD_SSE
+			if ((features & SIMD_SSE2) != 0)
+			{
+				done = _mipmapRow4Sse2(row0, row1, dest, destWidth);
+			}
+#elif defined(_SIMD_NEON)
+			if ((features & SIMD_NEON) != 0)
+			{
+				done = _mipmapRow4Neon(row0, row1, dest, destWidth);
+			}
+#endif
+			_mipmapRowScalar(row0, row1, dest, src.w, destWidth, bpp, done, gammaChannels, weightAlpha);
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,339 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <string.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+
+#include "april.h"
+#include "Image.h"
+#include "ImagePacked.h"
+#include "ImageSimd.h"
+
+#define CHECK_PREMULTIPLIED_FORMAT(format) \
+	((format) == FORMAT_RGBA_PREMULTIPLIED || (format) == FORMAT_BGRA_PREMULTIPLIED)
+#define CHECK_ALPHA_FORMAT(format) \
+	((format) == FORMAT_RGBA || (format) == FORMAT_ARGB || (format) == FORMAT_BGRA || (format) == FORMAT_ABGR || CHECK_PREMULTIPLIED_FORMAT(format))
+
+namespace april
+{
+	static Image::Dither dither = Image::DITHER_NONE;
+
+	static int _bayer[4][4] =
+	{
+		{0, 8, 2, 10},
+		{12, 4, 14, 6},
+		{3, 11, 1, 9},
+		{15, 7, 13, 5}
+	};
+
+	/// @brief Where the whole destination starts, bands use it to find their row in the dithering pattern.
+	struct PackedJob
+	{
+		unsigned char* origin;
+		int pitch;
+		Image::Dither dither;
+	};
+
+	// one row of the dithering pattern as division biases, repeated to 8 pixels for the vector kernels
+	static void _getBiases(int y, Image::Dither dither, short* biases)
+	{
+		for_iter (i, 0, 8)
+		{
+			biases[i] = (short)(dither == Image::DITHER_ORDERED ? (_bayer[y & 3][i & 3] * 2 + 1) * 255 / 32 : 127);
+		}
+	}
+
+	/// @param[in] channels Source channel index for red, green, blue and alpha, -1 means that the channel is 255.
+	static void _packRowScalar(unsigned char* src, int* channels, unsigned short* dest, int start, int count, const PackedLayout& layout, short* biases)
+	{
+		unsigned char rgba[4];
+		for_iter (i, start, count)
+		{
+			for_iter (c, 0, 4)
+			{
+				rgba[c] = (channels[c] >= 0 ? src[i * 4 + channels[c]] : 255);
+			}
+			dest[i] = _packPixel(rgba, layout, biases[i & 7]);
+		}
+	}
+
+	// errors are stored 16 times larger with one pixel of padding on each side so the edges don't need checks
+	static void _packRowDiffused(unsigned char* src, int* channels, unsigned short* dest, int count, const PackedLayout& layout, int* errors, int* nextErrors)
+	{
+		unsigned int result = 0;
+		int value = 0;
+		int max = 0;
+		int quantized = 0;
+		int error = 0;
+		for_iter (i, 0, count)
+		{
+			result = 0;
+			for_iter (c, 0, 4)
+			{
+				if (layout.bits[c] == 0)
+				{
+					continue;
+				}
+				max = (1 << layout.bits[c]) - 1;
+				value = (channels[c] >= 0 ? src[i * 4 + channels[c]] : 255);
+				value = hclamp(value + errors[(i + 1) * 4 + c] / 16, 0, 255);
+				quantized = (value * max + 127) / 255;
+				result |= quantized << layout.shifts[c];
+				error = value - (quantized * 255 + max / 2) / max;
+				errors[(i + 2) * 4 + c] += error * 7;
+				nextErrors[i * 4 + c] += error * 3;
+				nextErrors[(i + 1) * 4 + c] += error * 5;
+				nextErrors[(i + 2) * 4 + c] += error;
+			}
+			dest[i] = (unsigned short)result;
+		}
+	}
+
+	static void _unpackRow(unsigned short* src, unsigned char* dest, int count, const PackedLayout& layout)
+	{
+		for_iter (i, 0, count)
+		{
+			_unpackPixel(src[i], layout, &dest[i * 4]);
+		}
+	}
+
+#ifdef _SIMD_SSE
+	// 8 pixels per step, all channels are separated into 16 bit lanes first
+	static int _packRowSse2(unsigned char* src, int* channels, unsigned short* dest, int count, const PackedLayout& layout, short* biases)
+	{
+		__m128i byteMask = _mm_set1_epi32(0xFF);
+		__m128i one = _mm_set1_epi16(1);
+		__m128i bias = _mm_loadu_si128((__m128i*)biases);
+		__m128i maxes[4];
+		__m128i srcShifts[4];
+		__m128i destShifts[4];
+		for_iter (c, 0, 4)
+		{
+			maxes[c] = _mm_set1_epi16((short)((1 << layout.bits[c]) - 1));
+			srcShifts[c] = _mm_cvtsi32_si128(hmax(channels[c], 0) * 8);
+			destShifts[c] = _mm_cvtsi32_si128(layout.shifts[c]);
+		}
+		__m128i low;
+		__m128i high;
+		__m128i value;
+		__m128i result;
+		int i = 0;
+		for (; i <= count - 8; i += 8)
+		{
+			low = _mm_loadu_si128((__m128i*)&src[i * 4]);
+			high = _mm_loadu_si128((__m128i*)&src[i * 4 + 16]);
+			result = _mm_setzero_si128();
+			for_iter (c, 0, 4)
+			{
+				if (layout.bits[c] == 0)
+				{
+					continue;
+				}
+				if (channels[c] >= 0)
+				{
+					value = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(low, srcShifts[c]), byteMask), _mm_and_si128(_mm_srl_epi32(high, srcShifts[c]), byteMask));
+				}
+				else
+				{
+					value = _mm_set1_epi16(255);
+				}
+				// (value * max + bias) / 255 without a divide, exact for every value that can occur here
+				value = _mm_add_epi16(_mm_mullo_epi16(value, maxes[c]), bias);
+				value = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(value, one), _mm_srli_epi16(value, 8)), 8);
+				result = _mm_or_si128(result, _mm_sll_epi16(value, destShifts[c]));
+			}
+			_mm_storeu_si128((__m128i*)&dest[i], result);
+		}
+		return i;
+	}
+#endif
+
+#ifdef _SIMD_NEON
+	static inline uint16x8_t _packChannelNeon(uint8x8_t value, uint8x8_t max, uint16x8_t bias, int16x8_t shift)
+	{
+		uint16x8_t result = vaddq_u16(vmull_u8(value, max), bias);
+		result = vshrq_n_u16(vaddq_u16(vaddq_u16(result, vdupq_n_u16(1)), vshrq_n_u16(result, 8)), 8);
+		return vshlq_u16(result, shift);
+	}
+
+	// 16 pixels per step, the structured load separates the channels
+	static int _packRowNeon(unsigned char* src, int* channels, unsigned short* dest, int count, const PackedLayout& layout, short* biases)
+	{
+		uint16x8_t bias = vreinterpretq_u16_s16(vld1q_s16(biases));
+		uint8x16_t full = vdupq_n_u8(255);
+		uint8x16x4_t pixels;
+		uint8x16_t value;
+		uint16x8_t low;
+		uint16x8_t high;
+		int i = 0;
+		for (; i <= count - 16; i += 16)
+		{
+			pixels = vld4q_u8(&src[i * 4]);
+			low = vdupq_n_u16(0);
+			high = vdupq_n_u16(0);
+			for_iter (c, 0, 4)
+			{
+				if (layout.bits[c] == 0)
+				{
+					continue;
+				}
+				value = (channels[c] >= 0 ? pixels.val[channels[c]] : full);
+				uint8x8_t max = vdup_n_u8((unsigned char)((1 << layout.bits[c]) - 1));
+				int16x8_t shift = vdupq_n_s16((short)layout.shifts[c]);
+				low = vorrq_u16(low, _packChannelNeon(vget_low_u8(value), max, bias, shift));
+				high = vorrq_u16(high, _packChannelNeon(vget_high_u8(value), max, bias, shift));
+			}
+			vst1q_u16(&dest[i], low);
+			vst1q_u16(&dest[i + 8], high);
+		}
+		return i;
+	}
+#endif
+
+	static void _packRow(unsigned char* src, int* channels, unsigned short* dest, int count, const PackedLayout& layout, short* biases, int features)
+	{
+		int done = 0;
+#ifdef _SIMD_SSE
+		if ((features & SIMD_SSE2) != 0)
+		{
+			done = _packRowSse2(src, channels, dest, count, layout, biases);
+		}
+#elif defined(_SIMD_NEON)
+		if ((features & SIMD_NEON) != 0)
+		{
+			done = _packRowNeon(src, channels, dest, count, layout, biases);
+		}
+#endif
+		// the biases repeat every 4 pixels and the kernels always finish on a multiple of 8 so the pattern continues seamlessly
+		_packRowScalar(src, channels, dest, done, count, layout, biases);
+	}
+
+	void Image::setDither(Image::Dither value)
+	{
+		dither = value;
+	}
+
+	Image::Dither Image::getDither()
+	{
+		return dither;
+	}
+
+	bool Image::_convertPacked(const View& src, const View& dest)
+	{
+		if (src.format == dest.format)
+		{
+			int rowSize = src.w * src.getBpp();
+			for_iter (j, 0, src.h)
+			{
+				memcpy(dest.getPixelData(0, j), src.getPixelData(0, j), rowSize);
+			}
+			return true;
+		}
+		PackedJob job;
+		job.origin = dest.data;
+		job.pitch = dest.pitch;
+		job.dither = (CHECK_PACKED_FORMAT(dest.format) ? dither : DITHER_NONE);
+		// the error of every row is carried into the next one so it can't be split into bands
+		if (job.dither == DITHER_ERROR_DIFFUSION)
+		{
+			return Image::_convertPackedBand(src, dest, &job);
+		}
+		return Image::_runParallel(&Image::_convertPackedBand, src, dest, &job);
+	}
+
+	bool Image::_convertPackedBand(const View& src, const View& dest, void* args)
+	{
+		PackedJob* job = (PackedJob*)args;
+		int w = src.w;
+		bool srcPacked = CHECK_PACKED_FORMAT(src.format);
+		bool destPacked = CHECK_PACKED_FORMAT(dest.format);
+		// straight 4 BPP data is packed directly, everything else goes through an RGBA row first
+		bool direct = (destPacked && !srcPacked && src.getBpp() == 4 && !CHECK_PREMULTIPLIED_FORMAT(src.format));
+		int channels[4] = {0, 1, 2, 3};
+		if (direct)
+		{
+			Image::_getFormatIndices(src.format, &channels[0], &channels[1], &channels[2], &channels[3]);
+			if (!CHECK_ALPHA_FORMAT(src.format))
+			{
+				channels[3] = -1;
+			}
+		}
+		unsigned char* rgbaData = (direct || (!destPacked && dest.format == FORMAT_RGBA) ? NULL : new unsigned char[w * 4]);
+		View rgba(rgbaData, w, 1, FORMAT_RGBA);
+		int* errors = NULL;
+		int* nextErrors = NULL;
+		if (job->dither == DITHER_ERROR_DIFFUSION)
+		{
+			errors = new int[(w + 2) * 4];
+			nextErrors = new int[(w + 2) * 4];
+			memset(errors, 0, (w + 2) * 4 * sizeof(int));
+			memset(nextErrors, 0, (w + 2) * 4 * sizeof(int));
+		}
+		PackedLayout srcLayout = _getPackedLayout(src.format);
+		PackedLayout destLayout = _getPackedLayout(dest.format);
+		int y = (int)((dest.data - job->origin) / job->pitch);
+		int features = _getSimdFeatures();
+		short biases[8];
+		unsigned char* row = NULL;
+		int* swap = NULL;
+		bool result = true;
+		for_iter (j, 0, src.h)
+		{
+			row = (rgbaData != NULL ? rgbaData : dest.getPixelData(0, j));
+			if (srcPacked)
+			{
+				_unpackRow((unsigned short*)src.getPixelData(0, j), row, w, srcLayout);
+			}
+			else if (direct)
+			{
+				row = src.getPixelData(0, j);
+			}
+			else if (!Image::convertToFormat(src.getSubView(0, j, w, 1), rgba))
+			{
+				result = false;
+				break;
+			}
+			if (!destPacked)
+			{
+				if (rgbaData != NULL && !Image::convertToFormat(rgba, dest.getSubView(0, j, w, 1)))
+				{
+					result = false;
+					break;
+				}
+				continue;
+			}
+			if (job->dither == DITHER_ERROR_DIFFUSION)
+			{
+				_packRowDiffused(row, channels, (unsigned short*)dest.getPixelData(0, j), w, destLayout, errors, nextErrors);
+				swap = errors;
+				errors = nextErrors;
+				nextErrors = swap;
+				memset(nextErrors, 0, (w + 2) * 4 * sizeof(int));
+			}
+			else
+			{
+				_getBiases(y + j, job->dither, biases);
+				_packRow(row, channels, (unsigned short*)dest.getPixelData(0, j), w, destLayout, biases, features);
+			}
+		}
+		if (rgbaData != NULL)
+		{
+			delete [] rgbaData;
+		}
+		if (errors != NULL)
+		{
+			delete [] errors;
+			delete [] nextErrors;
+		}
+		return result;
+	}
+
+}
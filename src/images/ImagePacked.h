@@ -0,0 +1,97 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+///
+/// @section DESCRIPTION
+///
+/// Defines internal pixel access for the 16 bit formats.
+
+#ifndef APRIL_IMAGE_PACKED_H
+#define APRIL_IMAGE_PACKED_H
+
+#include <hltypes/hltypesUtil.h>
+
+#include "Color.h"
+#include "Image.h"
+
+#define CHECK_PACKED_FORMAT(format) \
+	((format) == Image::FORMAT_RGB565 || (format) == Image::FORMAT_RGBA4444 || (format) == Image::FORMAT_RGBA5551)
+
+namespace april
+{
+	/// @brief Bit count and position of every channel in RGBA order, a channel with 0 bits doesn't exist.
+	struct PackedLayout
+	{
+		int bits[4];
+		int shifts[4];
+	};
+
+	static inline PackedLayout _getPackedLayout(Image::Format format)
+	{
+		PackedLayout layout;
+		int rgb565[8] = {5, 6, 5, 0, 11, 5, 0, 0};
+		int rgba4444[8] = {4, 4, 4, 4, 12, 8, 4, 0};
+		int rgba5551[8] = {5, 5, 5, 1, 11, 6, 1, 0};
+		int* values = (format == Image::FORMAT_RGB565 ? rgb565 : (format == Image::FORMAT_RGBA4444 ? rgba4444 : rgba5551));
+		for_iter (c, 0, 4)
+		{
+			layout.bits[c] = values[c];
+			layout.shifts[c] = values[c + 4];
+		}
+		return layout;
+	}
+
+	/// @param[in] bias Added before dividing by 255, 127 rounds to the closest value and ordered dithering varies it per pixel.
+	static inline unsigned short _packPixel(const unsigned char* rgba, const PackedLayout& layout, int bias)
+	{
+		unsigned int result = 0;
+		int max = 0;
+		for_iter (c, 0, 4)
+		{
+			if (layout.bits[c] > 0)
+			{
+				max = (1 << layout.bits[c]) - 1;
+				result |= ((rgba[c] * max + bias) / 255) << layout.shifts[c];
+			}
+		}
+		return (unsigned short)result;
+	}
+
+	static inline void _unpackPixel(unsigned short value, const PackedLayout& layout, unsigned char* rgba)
+	{
+		int max = 0;
+		for_iter (c, 0, 4)
+		{
+			if (layout.bits[c] > 0)
+			{
+				max = (1 << layout.bits[c]) - 1;
+				rgba[c] = (unsigned char)((((value >> layout.shifts[c]) & max) * 255 + max / 2) / max);
+			}
+			else
+			{
+				rgba[c] = 255;
+			}
+		}
+	}
+
+	static inline Color _readPackedPixel(unsigned char* src, Image::Format format)
+	{
+		unsigned char rgba[4];
+		_unpackPixel(*(unsigned short*)src, _getPackedLayout(format), rgba);
+		return Color(rgba[0], rgba[1], rgba[2], rgba[3]);
+	}
+
+	static inline void _writePackedPixel(unsigned char* dest, Image::Format format, const Color& color)
+	{
+		unsigned char rgba[4] = {color.r, color.g, color.b, color.a};
+		*(unsigned short*)dest = _packPixel(rgba, _getPackedLayout(format), 127);
+	}
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hthread.h>
+
+#include "Image.h"
+#include "Timer.h"
+
+// how long an idle worker waits for the next operation before it stops, in milliseconds
+#define WORKER_IDLE_TIME 10.0f
+
+namespace april
+{
+	/// @brief Describes one whole-image operation that is being split into horizontal bands.
+	struct ParallelJob
+	{
+		bool (*function)(const Image::View&, const Image::View&, void*);
+		Image::View src;
+		Image::View dest;
+		void* args;
+		int bandHeight;
+		int bandCount;
+		int nextBand;
+		bool result;
+	};
+
+	static int threadCount = 1;
+	static int parallelMinPixels = 65536;
+	// both lists are only changed while holding the job mutex
+	static harray<hthread*> workers;
+	static harray<hthread*> idleWorkers;
+	static hmutex poolMutex;
+	static bool poolBusy = false;
+	static hmutex jobMutex;
+	static ParallelJob job;
+	/// @brief Number of workers that are processing bands of the current job.
+	static int activeWorkers = 0;
+
+	static void _processBands()
+	{
+		int band = 0;
+		int y = 0;
+		int h = 0;
+		bool result = true;
+		while (true)
+		{
+			jobMutex.lock();
+			band = job.nextBand;
+			if (band < job.bandCount)
+			{
+				++job.nextBand;
+			}
+			jobMutex.unlock();
+			if (band >= job.bandCount)
+			{
+				break;
+			}
+			y = band * job.bandHeight;
+			h = hmin(job.bandHeight, job.dest.h - y);
+			// bands don't overlap so they can be processed without any further locking
+			result = (*job.function)((job.src.data != NULL ? job.src.getSubView(0, y, job.src.w, h) : job.src),
+				job.dest.getSubView(0, y, job.dest.w, h), job.args);
+			if (!result)
+			{
+				jobMutex.lock();
+				job.result = false;
+				jobMutex.unlock();
+			}
+		}
+	}
+
+	// operations usually come in bursts so a worker waits a short time for the next one, then it stops and is restarted when it's needed again
+	static void _workerProcess(hthread* thread)
+	{
+		Timer timer;
+		float idleStart = timer.getTime();
+		bool working = false;
+		while (thread->isRunning())
+		{
+			jobMutex.lock();
+			working = (job.nextBand < job.bandCount);
+			if (working)
+			{
+				++activeWorkers;
+			}
+			else if (timer.getTime() - idleStart >= WORKER_IDLE_TIME)
+			{
+				// workers that are being destroyed aren't in the list anymore
+				if (workers.contains(thread))
+				{
+					idleWorkers += thread;
+				}
+				jobMutex.unlock();
+				break;
+			}
+			jobMutex.unlock();
+			if (working)
+			{
+				_processBands();
+				jobMutex.lock();
+				--activeWorkers;
+				jobMutex.unlock();
+				idleStart = timer.getTime();
+			}
+			else
+			{
+				hthread::sleep(0.0f);
+			}
+		}
+	}
+
+	static void _stopWorkers(int count)
+	{
+		hthread* worker = NULL;
+		while (true)
+		{
+			jobMutex.lock();
+			if (workers.size() <= count)
+			{
+				jobMutex.unlock();
+				break;
+			}
+			worker = workers.remove_last();
+			if (idleWorkers.contains(worker))
+			{
+				idleWorkers -= worker;
+			}
+			jobMutex.unlock();
+			worker->join();
+			delete worker;
+		}
+	}
+
+	void Image::setThreadCount(int value)
+	{
+		poolMutex.lock();
+		threadCount = hmax(value, 1);
+		// the calling thread does work as well so it doesn't need a worker
+		if (!poolBusy)
+		{
+			_stopWorkers(threadCount - 1);
+		}
+		poolMutex.unlock();
+	}
+
+	int Image::getThreadCount()
+	{
+		return threadCount;
+	}
+
+	void Image::setParallelMinPixels(int value)
+	{
+		parallelMinPixels = hmax(value, 0);
+	}
+
+	int Image::getParallelMinPixels()
+	{
+		return parallelMinPixels;
+	}
+
+	void Image::destroyThreads()
+	{
+		poolMutex.lock();
+		_stopWorkers(0);
+		poolMutex.unlock();
+	}
+
+	bool Image::_runParallel(bool (*function)(const View&, const View&, void*), const View& src, const View& dest, void* args)
+	{
+		if (threadCount <= 1 || dest.h < 2 || dest.w * dest.h < parallelMinPixels)
+		{
+			return (*function)(src, dest, args);
+		}
+		poolMutex.lock();
+		if (poolBusy)
+		{
+			// another operation is already using the workers, nesting them would only cause contention
+			poolMutex.unlock();
+			return (*function)(src, dest, args);
+		}
+		poolBusy = true;
+		int count = threadCount;
+		poolMutex.unlock();
+		// more bands than threads so uneven work gets balanced out, running workers pick the job up as soon as bands are available
+		jobMutex.lock();
+		job.function = function;
+		job.src = src;
+		job.dest = dest;
+		job.args = args;
+		job.bandCount = hmin(count * 4, dest.h);
+		job.bandHeight = (dest.h + job.bandCount - 1) / job.bandCount;
+		job.bandCount = (dest.h + job.bandHeight - 1) / job.bandHeight;
+		job.result = true;
+		job.nextBand = 0;
+		// workers that stopped in the meantime are started again, a worker can't stop anymore while bands are available
+		harray<hthread*> threads = idleWorkers;
+		idleWorkers.clear();
+		hthread* worker = NULL;
+		while (workers.size() < count - 1)
+		{
+			worker = new hthread(&_workerProcess, "april image worker");
+			workers += worker;
+			threads += worker;
+		}
+		jobMutex.unlock();
+		foreach (hthread*, it, threads)
+		{
+			// a stopped worker has already left its loop, it only has to finish returning
+			(*it)->join();
+			(*it)->start();
+		}
+		_processBands();
+		// all bands have been taken, but workers can still be processing theirs
+		bool finished = false;
+		while (true)
+		{
+			jobMutex.lock();
+			finished = (activeWorkers == 0);
+			jobMutex.unlock();
+			if (finished)
+			{
+				break;
+			}
+			hthread::sleep(0.0f);
+		}
+		bool result = job.result;
+		poolMutex.lock();
+		poolBusy = false;
+		poolMutex.unlock();
+		return result;
+	}
+
+}
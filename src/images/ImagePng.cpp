@@ -8,36 +8,111 @@
 /// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
 
 #include <png.h>
-#include <pngpriv.h>
-#include <pngstruct.h>
+#include <string.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hsbase.h>
 
+#include "april.h"
 #include "Image.h"
 
 namespace april
 {
 	void _pngZipRead(png_structp png, png_bytep data, png_size_t size)
 	{
-		((hsbase*)png->io_ptr)->read_raw(data, size);
+		((hsbase*)png_get_io_ptr(png))->read_raw(data, size);
 	}
 
-	Image* Image::_loadPng(hsbase& stream, int size)
+	struct PngMemorySource
+	{
+		unsigned char* data;
+		int size;
+		int position;
+	};
+
+	void _pngMemoryRead(png_structp png, png_bytep data, png_size_t size)
+	{
+		PngMemorySource* source = (PngMemorySource*)png_get_io_ptr(png);
+		int count = hmin((int)size, source->size - source->position);
+		memcpy(data, &source->data[source->position], count);
+		source->position += count;
+		if (count < (int)size) // like a stream at its end, libpng will complain about the data
+		{
+			memset(&data[count], 0, size - count);
+		}
+	}
+
+	// sets up libpng so it decodes straight into the given 3 or 4 BPP layout, returns the resulting format
+	static Image::Format _setupPngTransforms(png_structp pngPtr, int bpp, Image::Format format)
+	{
+		Image::Format straightFormat = format;
+		if (format == Image::FORMAT_RGBA_PREMULTIPLIED)
+		{
+			straightFormat = Image::FORMAT_RGBA;
+		}
+		else if (format == Image::FORMAT_BGRA_PREMULTIPLIED)
+		{
+			straightFormat = Image::FORMAT_BGRA;
+		}
+		int destBpp = Image::getFormatBpp(straightFormat);
+		if ((destBpp != 3 && destBpp != 4) || (bpp != 1 && bpp != 3 && bpp != 4))
+		{
+			return Image::FORMAT_INVALID;
+		}
+		bool bgr = (straightFormat == Image::FORMAT_BGR || straightFormat == Image::FORMAT_BGRA || straightFormat == Image::FORMAT_BGRX ||
+			straightFormat == Image::FORMAT_ABGR || straightFormat == Image::FORMAT_XBGR);
+		bool alphaFirst = (straightFormat == Image::FORMAT_ARGB || straightFormat == Image::FORMAT_XRGB ||
+			straightFormat == Image::FORMAT_ABGR || straightFormat == Image::FORMAT_XBGR);
+		if (bpp == 1)
+		{
+			png_set_gray_to_rgb(pngPtr);
+			bpp = 3;
+		}
+		if (destBpp == 3 && bpp == 4)
+		{
+			png_set_strip_alpha(pngPtr);
+		}
+		else if (destBpp == 4)
+		{
+			if (bpp == 3)
+			{
+				png_set_filler(pngPtr, 0xFF, alphaFirst ? PNG_FILLER_BEFORE : PNG_FILLER_AFTER);
+			}
+			else if (alphaFirst)
+			{
+				png_set_swap_alpha(pngPtr);
+			}
+		}
+		if (bgr)
+		{
+			png_set_bgr(pngPtr);
+		}
+		return straightFormat;
+	}
+
+	// reads the header and sets up all transformations, returns the format libpng decodes into or FORMAT_INVALID if it's the file's own layout
+	static Image::Format _setupPngDecoding(png_structp pngPtr, png_infop infoPtr, Image::Format format, bool keepPalette, int& bpp)
 	{
-		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-		png_infop infoPtr = png_create_info_struct(pngPtr);
-		png_infop endInfo = png_create_info_struct(pngPtr);
-		setjmp(png_jmpbuf(pngPtr));
-		png_set_read_fn(pngPtr, &stream, &_pngZipRead);
 		png_read_info(pngPtr, infoPtr);
 		png_get_IHDR(pngPtr, infoPtr, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 		png_set_interlace_handling(pngPtr);
-		int bpp = pngPtr->channels;
-		if (pngPtr->color_type == PNG_COLOR_TYPE_PALETTE)
+		int colorType = png_get_color_type(pngPtr, infoPtr);
+		bpp = png_get_channels(pngPtr, infoPtr);
+		if (colorType == PNG_COLOR_TYPE_PALETTE)
 		{
+			if (keepPalette)
+			{
+				// indices with fewer bits are unpacked to 1 byte each, transparency is part of the palette
+				png_set_packing(pngPtr);
+				png_read_update_info(pngPtr, infoPtr);
+				bpp = 1;
+				return Image::FORMAT_PALETTE;
+			}
 			png_set_palette_to_rgb(pngPtr);
 			bpp = 3;
 		}
-		if (pngPtr->color_type == PNG_COLOR_TYPE_GRAY_ALPHA && bpp > 1)
+		if (colorType == PNG_COLOR_TYPE_GRAY_ALPHA && bpp > 1)
 		{
 			png_set_strip_alpha(pngPtr);
 			bpp -= 1;
@@ -47,49 +122,357 @@ namespace april
 			png_set_tRNS_to_alpha(pngPtr);
 			++bpp;
 		}
-		if (pngPtr->bit_depth == 16)
+		if (png_get_bit_depth(pngPtr, infoPtr) == 16)
 		{
 			png_set_strip_16(pngPtr);
 		}
+		// reordering and adding channels is done by libpng while decoding so no conversion pass is needed afterwards
+		Image::Format decodedFormat = Image::FORMAT_INVALID;
+		if (format != Image::FORMAT_INVALID)
+		{
+			decodedFormat = _setupPngTransforms(pngPtr, bpp, format);
+		}
 		png_read_update_info(pngPtr, infoPtr);
-		int rowBytes = png_get_rowbytes(pngPtr, infoPtr);
-		png_byte* imageData = new png_byte[rowBytes * pngPtr->height];
-		png_bytep* rowPointers = new png_bytep[pngPtr->height];
-		for_itert (unsigned int, i, 0, pngPtr->height)
+		return decodedFormat;
+	}
+
+	// the file's palette with its transparency as RGBA, unused entries are transparent black
+	static unsigned char* _readPngPalette(png_structp pngPtr, png_infop infoPtr)
+	{
+		unsigned char* palette = new unsigned char[APRIL_PALETTE_SIZE * 4];
+		memset(palette, 0, APRIL_PALETTE_SIZE * 4);
+		png_colorp colors = NULL;
+		int count = 0;
+		png_get_PLTE(pngPtr, infoPtr, &colors, &count);
+		png_bytep alphas = NULL;
+		int alphaCount = 0;
+		if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS))
 		{
-			rowPointers[i] = imageData + i * rowBytes;
+			png_get_tRNS(pngPtr, infoPtr, &alphas, &alphaCount, NULL);
 		}
-		png_read_image(pngPtr, rowPointers);
-		png_read_end(pngPtr, infoPtr);
-		// assign Image data
-		Image* image = new Image();
-		image->data = (unsigned char*)imageData;
-		image->w = pngPtr->width;
-		image->h = pngPtr->height;
+		count = hmin(count, APRIL_PALETTE_SIZE);
+		for_iter (i, 0, count)
+		{
+			palette[i * 4] = colors[i].red;
+			palette[i * 4 + 1] = colors[i].green;
+			palette[i * 4 + 2] = colors[i].blue;
+			palette[i * 4 + 3] = (i < alphaCount ? alphas[i] : 255);
+		}
+		return palette;
+	}
+
+	// format of the file's own layout after the transformations
+	static Image::Format _getPngFormat(int bpp)
+	{
 		switch (bpp)
 		{
 		case 4:
-			image->format = FORMAT_RGBA;
-			break;
+			return Image::FORMAT_RGBA;
 		case 3:
-			image->format = FORMAT_RGB;
-			break;
+			return Image::FORMAT_RGB;
 		case 1:
-			image->format = FORMAT_ALPHA;
-			break;
+			return Image::FORMAT_ALPHA;
 		default:
-			image->format = FORMAT_RGBA; // TODOaa - maybe palette should go here
 			break;
 		}
+		return Image::FORMAT_RGBA; // TODOaa - maybe palette should go here
+	}
+
+	Image* Image::_loadPng(hsbase& stream, int size, Image::Format format, int downscale)
+	{
+		return Image::_loadPng(&stream, NULL, size, format, downscale);
+	}
+
+	Image* Image::_loadPng(unsigned char* compressedData, int size, Image::Format format, int downscale)
+	{
+		return Image::_loadPng(NULL, compressedData, size, format, downscale);
+	}
+
+	Image* Image::_loadPng(hsbase* stream, unsigned char* compressedData, int size, Image::Format format, int downscale)
+	{
+		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png_infop infoPtr = png_create_info_struct(pngPtr);
+		png_infop endInfo = png_create_info_struct(pngPtr);
+		setjmp(png_jmpbuf(pngPtr));
+		PngMemorySource source;
+		if (stream != NULL)
+		{
+			png_set_read_fn(pngPtr, stream, &_pngZipRead);
+		}
+		else
+		{
+			source.data = compressedData;
+			source.size = size;
+			source.position = 0;
+			png_set_read_fn(pngPtr, &source, &_pngMemoryRead);
+		}
+		int bpp = 0;
+		// averaging indices would mix unrelated colors so downscaled images are decoded to colors
+		Image::Format decodedFormat = _setupPngDecoding(pngPtr, infoPtr, format, (format == FORMAT_PALETTE && downscale == 1), bpp);
+		// premultiplied formats are decoded straight and then premultiplied
+		bool premultiply = (decodedFormat != FORMAT_INVALID && decodedFormat != format);
+		int rowBytes = png_get_rowbytes(pngPtr, infoPtr);
+		int width = png_get_image_width(pngPtr, infoPtr);
+		int height = png_get_image_height(pngPtr, infoPtr);
+		int channels = png_get_channels(pngPtr, infoPtr);
+		if (rowBytes != width * channels) // packed pixels can't be averaged
+		{
+			downscale = 1;
+		}
+		png_byte* imageData = NULL;
+		// interlaced images deliver rows in several passes so they have to be decoded completely first
+		if (downscale == 1 || png_get_interlace_type(pngPtr, infoPtr) != PNG_INTERLACE_NONE)
+		{
+			imageData = new png_byte[rowBytes * height];
+			png_bytep* rowPointers = new png_bytep[height];
+			for_iter (i, 0, height)
+			{
+				rowPointers[i] = imageData + i * rowBytes;
+			}
+			png_read_image(pngPtr, rowPointers);
+			delete [] rowPointers;
+		}
+		if (downscale > 1)
+		{
+			// every block of downscale x downscale pixels is averaged, rows are read one at a time if possible
+			png_byte* fullData = imageData;
+			int destWidth = (width + downscale - 1) / downscale;
+			int destHeight = (height + downscale - 1) / downscale;
+			int destRowBytes = destWidth * channels;
+			imageData = new png_byte[destRowBytes * destHeight];
+			png_byte* rowBuffer = (fullData == NULL ? new png_byte[rowBytes] : NULL);
+			png_byte* row = NULL;
+			png_byte* destRow = NULL;
+			unsigned int* sums = new unsigned int[destRowBytes];
+			int rows = 0;
+			int columns = 0;
+			int count = 0;
+			int x = 0;
+			for_iter (j, 0, destHeight)
+			{
+				memset(sums, 0, destRowBytes * sizeof(unsigned int));
+				rows = hmin(downscale, height - j * downscale);
+				for_iter (k, 0, rows)
+				{
+					if (fullData != NULL)
+					{
+						row = &fullData[(j * downscale + k) * rowBytes];
+					}
+					else
+					{
+						png_read_row(pngPtr, rowBuffer, NULL);
+						row = rowBuffer;
+					}
+					if (!premultiply)
+					{
+						for_iterx (x, 0, width)
+						{
+							for_iter (c, 0, channels)
+							{
+								sums[(x / downscale) * channels + c] += row[x * channels + c];
+							}
+						}
+					}
+					else
+					{
+						// averaging has to be done with premultiplied colors or transparent pixels would bleed into the result
+						for_iterx (x, 0, width)
+						{
+							for_iter (c, 0, 3)
+							{
+								sums[(x / downscale) * 4 + c] += (row[x * 4 + c] * row[x * 4 + 3] + 127) / 255;
+							}
+							sums[(x / downscale) * 4 + 3] += row[x * 4 + 3];
+						}
+					}
+				}
+				destRow = &imageData[j * destRowBytes];
+				for_iterx (x, 0, destWidth)
+				{
+					columns = hmin(downscale, width - x * downscale);
+					count = rows * columns;
+					for_iter (c, 0, channels)
+					{
+						destRow[x * channels + c] = (png_byte)((sums[x * channels + c] + count / 2) / count);
+					}
+				}
+			}
+			delete [] sums;
+			if (rowBuffer != NULL)
+			{
+				delete [] rowBuffer;
+			}
+			if (fullData != NULL)
+			{
+				delete [] fullData;
+			}
+			width = destWidth;
+			height = destHeight;
+			premultiply = false;
+		}
+		png_read_end(pngPtr, infoPtr);
+		// assign Image data
+		Image* image = new Image();
+		image->data = (unsigned char*)imageData;
+		image->w = width;
+		image->h = height;
+		if (decodedFormat != FORMAT_INVALID)
+		{
+			image->format = format;
+		}
+		else
+		{
+			image->format = _getPngFormat(bpp);
+		}
+		if (image->format == FORMAT_PALETTE)
+		{
+			image->palette = _readPngPalette(pngPtr, infoPtr);
+		}
 		// clean up
 		png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
-		delete [] rowPointers;
+		if (premultiply)
+		{
+			Image::_premultiplyAlpha(image->getView());
+		}
 		return image;
 	}
 
-	Image* Image::_loadPng(hsbase& stream)
+	Image* Image::_loadPng(hsbase& stream, Image::Format format, int downscale)
+	{
+		return Image::_loadPng(stream, stream.size(), format, downscale);
+	}
+
+	bool Image::_readPngBands(hsbase& stream, Image::Format format, int bandHeight, bool (*callback)(const View&, int, void*), void* args)
+	{
+		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png_infop infoPtr = png_create_info_struct(pngPtr);
+		// has to survive the jump back from libpng's error handling
+		png_byte* volatile imageData = NULL;
+		unsigned char* volatile convertedData = NULL;
+		if (setjmp(png_jmpbuf(pngPtr)))
+		{
+			hlog::error(april::logTag, "Failed to decode PNG image!");
+			png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+			if (imageData != NULL)
+			{
+				delete [] imageData;
+			}
+			if (convertedData != NULL)
+			{
+				delete [] convertedData;
+			}
+			return false;
+		}
+		png_set_read_fn(pngPtr, &stream, &_pngZipRead);
+		int bpp = 0;
+		Image::Format decodedFormat = _setupPngDecoding(pngPtr, infoPtr, format, false, bpp);
+		int rowBytes = png_get_rowbytes(pngPtr, infoPtr);
+		int width = png_get_image_width(pngPtr, infoPtr);
+		int height = png_get_image_height(pngPtr, infoPtr);
+		if (rowBytes != width * png_get_channels(pngPtr, infoPtr))
+		{
+			hlog::error(april::logTag, "Cannot read PNG image with packed pixels in bands!");
+			png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+			return false;
+		}
+		if (decodedFormat == FORMAT_INVALID)
+		{
+			decodedFormat = _getPngFormat(bpp);
+		}
+		// interlaced images deliver rows in several passes so they have to be decoded completely first
+		bool interlaced = (png_get_interlace_type(pngPtr, infoPtr) != PNG_INTERLACE_NONE);
+		int rows = (interlaced ? height : hmin(bandHeight, height));
+		imageData = new png_byte[rowBytes * rows];
+		if (interlaced)
+		{
+			png_bytep* rowPointers = new png_bytep[height];
+			for_iter (i, 0, height)
+			{
+				rowPointers[i] = imageData + i * rowBytes;
+			}
+			png_read_image(pngPtr, rowPointers);
+			delete [] rowPointers;
+		}
+		View band(imageData, width, rows, decodedFormat);
+		unsigned char* converted = NULL;
+		bool result = true;
+		for (int y = 0; y < height && result; y += bandHeight)
+		{
+			rows = hmin(bandHeight, height - y);
+			if (!interlaced)
+			{
+				for_iter (i, 0, rows)
+				{
+					png_read_row(pngPtr, imageData + i * rowBytes, NULL);
+				}
+				band.h = rows;
+			}
+			else
+			{
+				band = View(imageData + y * rowBytes, width, rows, decodedFormat);
+			}
+			converted = convertedData;
+			result = Image::_passBand(band, y, format, &converted, callback, args);
+			convertedData = converted;
+		}
+		if (result)
+		{
+			png_read_end(pngPtr, infoPtr);
+		}
+		png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+		delete [] imageData;
+		if (convertedData != NULL)
+		{
+			delete [] convertedData;
+		}
+		return result;
+	}
+
+	bool Image::_probePng(hsbase& stream, Image::Info& info)
 	{
-		return Image::_loadPng(stream, stream.size());
+		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png_infop infoPtr = png_create_info_struct(pngPtr);
+		if (setjmp(png_jmpbuf(pngPtr)))
+		{
+			png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+			return false;
+		}
+		png_set_read_fn(pngPtr, &stream, &_pngZipRead);
+		// stops right before the first IDAT chunk so no image data is read
+		png_read_info(pngPtr, infoPtr);
+		info.w = png_get_image_width(pngPtr, infoPtr);
+		info.h = png_get_image_height(pngPtr, infoPtr);
+		info.channels = png_get_channels(pngPtr, infoPtr);
+		info.bitDepth = png_get_bit_depth(pngPtr, infoPtr);
+		// same channel transformations as in _loadPng()
+		int colorType = png_get_color_type(pngPtr, infoPtr);
+		int bpp = info.channels;
+		if (colorType == PNG_COLOR_TYPE_PALETTE)
+		{
+			bpp = 3;
+		}
+		if (colorType == PNG_COLOR_TYPE_GRAY_ALPHA && bpp > 1)
+		{
+			bpp -= 1;
+		}
+		if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS))
+		{
+			++bpp;
+		}
+		switch (bpp)
+		{
+		case 3:
+			info.format = FORMAT_RGB;
+			break;
+		case 1:
+			info.format = FORMAT_ALPHA;
+			break;
+		default:
+			info.format = FORMAT_RGBA;
+			break;
+		}
+		png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+		return true;
 	}
 
 }
@@ -0,0 +1,517 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <math.h>
+#include <string.h>
+
+#include <hltypes/hltypesUtil.h>
+
+#include "Image.h"
+#include "ImageSimd.h"
+
+// weights have to fit into 16 bits so SSE2 can multiply-add pairs of them
+#define PRECISION_BITS 14
+#define PRECISION_ROUNDING (1 << (PRECISION_BITS - 1))
+#define RESAMPLE_PI 3.14159265358979323846
+
+namespace april
+{
+	static double _filterBox(double x)
+	{
+		return (x > -0.5 && x <= 0.5 ? 1.0 : 0.0);
+	}
+
+	static double _filterLinear(double x)
+	{
+		x = fabs(x);
+		return (x < 1.0 ? 1.0 - x : 0.0);
+	}
+
+	static double _sinc(double x)
+	{
+		if (x == 0.0)
+		{
+			return 1.0;
+		}
+		x *= RESAMPLE_PI;
+		return (sin(x) / x);
+	}
+
+	static double _filterLanczos3(double x)
+	{
+		return (x > -3.0 && x < 3.0 ? _sinc(x) * _sinc(x / 3.0) : 0.0);
+	}
+
+	static inline unsigned char _clampValue(int value)
+	{
+		return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	/// @brief Precomputes which source pixels and with what weights make up every destination pixel of one axis.
+	/// @note When shrinking, the filter is widened by the scale factor so every source pixel contributes and nothing aliases.
+	/// @return Number of weights reserved per destination pixel.
+	static int _createCoefficients(int srcSize, int destSize, Image::Filter filter, int* starts, int* counts, short** weights)
+	{
+		double (*function)(double) = _filterLinear;
+		double support = 1.0;
+		if (filter == Image::FILTER_BOX)
+		{
+			function = _filterBox;
+			support = 0.5;
+		}
+		else if (filter == Image::FILTER_LANCZOS3)
+		{
+			function = _filterLanczos3;
+			support = 3.0;
+		}
+		double scale = (double)srcSize / destSize;
+		double filterScale = hmax(scale, 1.0);
+		support *= filterScale;
+		int maxCount = (int)ceil(support) * 2 + 1;
+		*weights = new short[destSize * maxCount];
+		memset(*weights, 0, destSize * maxCount * sizeof(short));
+		double* values = new double[maxCount];
+		short* row = NULL;
+		double center = 0.0;
+		double sum = 0.0;
+		int start = 0;
+		int count = 0;
+		int total = 0;
+		int largest = 0;
+		for_iter (i, 0, destSize)
+		{
+			// pixel centers are used for mapping so both edges are treated the same way
+			center = (i + 0.5) * scale;
+			start = hmax((int)(center - support + 0.5), 0);
+			count = hmin(hmin((int)(center + support + 0.5), srcSize) - start, maxCount);
+			sum = 0.0;
+			for_iter (j, 0, count)
+			{
+				values[j] = function((j + start - center + 0.5) / filterScale);
+				sum += values[j];
+			}
+			row = &(*weights)[i * maxCount];
+			total = 0;
+			largest = 0;
+			for_iter (j, 0, count)
+			{
+				row[j] = (short)floor((sum != 0.0 ? values[j] / sum : 0.0) * (1 << PRECISION_BITS) + 0.5);
+				total += row[j];
+				if (row[j] > row[largest])
+				{
+					largest = j;
+				}
+			}
+			// rounding errors go into the strongest weight so flat areas keep their exact color
+			row[largest] += (short)((1 << PRECISION_BITS) - total);
+			starts[i] = start;
+			counts[i] = count;
+		}
+		delete [] values;
+		return maxCount;
+	}
+
+	static void _resampleRowScalar(unsigned char* src, unsigned char* dest, int destWidth, int bpp, int* starts, int* counts, short* weights, int maxCount)
+	{
+		unsigned char* pixel = NULL;
+		short* k = NULL;
+		int sum = 0;
+		for_iter (i, 0, destWidth)
+		{
+			pixel = &src[starts[i] * bpp];
+			k = &weights[i * maxCount];
+			for_iter (c, 0, bpp)
+			{
+				sum = PRECISION_ROUNDING;
+				for_iter (j, 0, counts[i])
+				{
+					sum += pixel[j * bpp + c] * k[j];
+				}
+				dest[i * bpp + c] = _clampValue(sum >> PRECISION_BITS);
+			}
+		}
+	}
+
+	/// @param[in] rows Source rows that contribute to this destination row.
+	/// @param[in] size Number of bytes in a row, channels don't matter for the vertical pass.
+	static void _resampleColumnScalar(unsigned char** rows, unsigned char* dest, int offset, int size, int count, short* k)
+	{
+		int sum = 0;
+		for_iter (x, offset, size)
+		{
+			sum = PRECISION_ROUNDING;
+			for_iter (j, 0, count)
+			{
+				sum += rows[j][x] * k[j];
+			}
+			dest[x] = _clampValue(sum >> PRECISION_BITS);
+		}
+	}
+
+#ifdef _SIMD_SSE
+	static inline __m128i _makeWeightPair(short first, short second)
+	{
+		return _mm_set1_epi32((int)(((unsigned int)(unsigned short)second << 16) | (unsigned short)first));
+	}
+
+	// two source pixels per step, their channels interleaved so one madd applies both weights
+	static void _resampleRow4Sse2(unsigned char* src, unsigned char* dest, int destWidth, int* starts, int* counts, short* weights, int maxCount)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i sum;
+		__m128i pixels;
+		unsigned char* pixel = NULL;
+		short* k = NULL;
+		int value = 0;
+		int j = 0;
+		for_iter (i, 0, destWidth)
+		{
+			pixel = &src[starts[i] * 4];
+			k = &weights[i * maxCount];
+			sum = _mm_set1_epi32(PRECISION_ROUNDING);
+			for (j = 0; j + 1 < counts[i]; j += 2)
+			{
+				pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&pixel[j * 4]), zero);
+				pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _makeWeightPair(k[j], k[j + 1])));
+			}
+			if (j < counts[i])
+			{
+				memcpy(&value, &pixel[j * 4], 4);
+				pixels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _makeWeightPair(k[j], 0)));
+			}
+			sum = _mm_srai_epi32(sum, PRECISION_BITS);
+			sum = _mm_packs_epi32(sum, sum);
+			value = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+			memcpy(&dest[i * 4], &value, 4);
+		}
+	}
+
+	// 16 bytes per step, bytes of two rows are interleaved so one madd applies both weights
+	static int _resampleColumnSse2(unsigned char** rows, unsigned char* dest, int size, int count, short* k)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i rounding = _mm_set1_epi32(PRECISION_ROUNDING);
+		__m128i sum0;
+		__m128i sum1;
+		__m128i sum2;
+		__m128i sum3;
+		__m128i first;
+		__m128i second;
+		__m128i weight;
+		__m128i low;
+		__m128i high;
+		int x = 0;
+		int j = 0;
+		for (x = 0; x + 16 <= size; x += 16)
+		{
+			sum0 = sum1 = sum2 = sum3 = rounding;
+			for (j = 0; j < count; j += 2)
+			{
+				first = _mm_loadu_si128((__m128i*)&rows[j][x]);
+				if (j + 1 < count)
+				{
+					second = _mm_loadu_si128((__m128i*)&rows[j + 1][x]);
+					weight = _makeWeightPair(k[j], k[j + 1]);
+				}
+				else
+				{
+					second = zero;
+					weight = _makeWeightPair(k[j], 0);
+				}
+				low = _mm_unpacklo_epi8(first, second);
+				high = _mm_unpackhi_epi8(first, second);
+				sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), weight));
+				sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), weight));
+				sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), weight));
+				sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), weight));
+			}
+			low = _mm_packs_epi32(_mm_srai_epi32(sum0, PRECISION_BITS), _mm_srai_epi32(sum1, PRECISION_BITS));
+			high = _mm_packs_epi32(_mm_srai_epi32(sum2, PRECISION_BITS), _mm_srai_epi32(sum3, PRECISION_BITS));
+			_mm_storeu_si128((__m128i*)&dest[x], _mm_packus_epi16(low, high));
+		}
+		return x;
+	}
+#endif
+
+#ifdef _SIMD_NEON
+	static int _resampleColumnNeon(unsigned char** rows, unsigned char* dest, int size, int count, short* k)
+	{
+		int32x4_t low;
+		int32x4_t high;
+		int16x8_t values;
+		int x = 0;
+		for (x = 0; x + 8 <= size; x += 8)
+		{
+			low = vdupq_n_s32(PRECISION_ROUNDING);
+			high = vdupq_n_s32(PRECISION_ROUNDING);
+			for_iter (j, 0, count)
+			{
+				values = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&rows[j][x])));
+				low = vmlal_n_s16(low, vget_low_s16(values), k[j]);
+				high = vmlal_n_s16(high, vget_high_s16(values), k[j]);
+			}
+			values = vcombine_s16(vqshrn_n_s32(low, PRECISION_BITS), vqshrn_n_s32(high, PRECISION_BITS));
+			vst1_u8(&dest[x], vqmovun_s16(values));
+		}
+		return x;
+	}
+#endif
+
+	/// @brief Produces the stretched image row by row so callers can consume every row while it's still in the cache.
+	/// @note Rows have to be requested in increasing order. Horizontally filtered source rows are kept in a small ring
+	/// buffer that only holds as many rows as the vertical filter needs at once.
+	class Resampler
+	{
+	public:
+		Resampler(const Image::View& source, int destWidth, int destHeight, Image::Filter filter)
+		{
+			this->source = source;
+			this->destWidth = destWidth;
+			this->destHeight = destHeight;
+			this->filter = filter;
+			this->bpp = source.getBpp();
+			this->rowSize = destWidth * this->bpp;
+			this->features = _getSimdFeatures();
+			this->xStarts = NULL;
+			this->xCounts = NULL;
+			this->xWeights = NULL;
+			this->xMaxCount = 0;
+			this->yStarts = NULL;
+			this->yCounts = NULL;
+			this->yWeights = NULL;
+			this->yMaxCount = 0;
+			this->ring = NULL;
+			this->ringSize = 0;
+			this->filledRow = -1;
+			this->rows = NULL;
+			if (filter == Image::FILTER_NEAREST)
+			{
+				this->xStarts = new int[destWidth];
+				for_iter (i, 0, destWidth)
+				{
+					this->xStarts[i] = (int)(((long long)i * 2 + 1) * source.w / (destWidth * 2)) * this->bpp;
+				}
+				return;
+			}
+			if (source.w != destWidth)
+			{
+				this->xStarts = new int[destWidth];
+				this->xCounts = new int[destWidth];
+				this->xMaxCount = _createCoefficients(source.w, destWidth, filter, this->xStarts, this->xCounts, &this->xWeights);
+			}
+			if (source.h != destHeight)
+			{
+				this->yStarts = new int[destHeight];
+				this->yCounts = new int[destHeight];
+				this->yMaxCount = _createCoefficients(source.h, destHeight, filter, this->yStarts, this->yCounts, &this->yWeights);
+				this->rows = new unsigned char*[this->yMaxCount];
+				if (this->xWeights != NULL)
+				{
+					this->ringSize = hmin(this->yMaxCount, source.h);
+					this->ring = new unsigned char[this->ringSize * this->rowSize];
+				}
+			}
+		}
+
+		~Resampler()
+		{
+			if (this->xStarts != NULL)
+			{
+				delete [] this->xStarts;
+			}
+			if (this->xCounts != NULL)
+			{
+				delete [] this->xCounts;
+			}
+			if (this->xWeights != NULL)
+			{
+				delete [] this->xWeights;
+			}
+			if (this->yStarts != NULL)
+			{
+				delete [] this->yStarts;
+			}
+			if (this->yCounts != NULL)
+			{
+				delete [] this->yCounts;
+			}
+			if (this->yWeights != NULL)
+			{
+				delete [] this->yWeights;
+			}
+			if (this->ring != NULL)
+			{
+				delete [] this->ring;
+			}
+			if (this->rows != NULL)
+			{
+				delete [] this->rows;
+			}
+		}
+
+		void getRow(int y, unsigned char* output)
+		{
+			if (this->filter == Image::FILTER_NEAREST)
+			{
+				this->_getNearestRow(y, output);
+				return;
+			}
+			if (this->yWeights == NULL) // only horizontal filtering
+			{
+				this->_filterRow(y, output);
+				return;
+			}
+			int count = this->yCounts[y];
+			for_iter (j, 0, count)
+			{
+				this->rows[j] = this->_getFilteredRow(this->yStarts[y] + j);
+			}
+			short* k = &this->yWeights[y * this->yMaxCount];
+			int done = 0;
+#ifdef _SIMD_SSE
+			if ((this->features & SIMD_SSE2) != 0)
+			{
+				done = _resampleColumnSse2(this->rows, output, this->rowSize, count, k);
+			}
+#elif defined(_SIMD_NEON)
+			done = _resampleColumnNeon(this->rows, output, this->rowSize, count, k);
+#endif
+			_resampleColumnScalar(this->rows, output, done, this->rowSize, count, k);
+		}
+
+	protected:
+		Image::View source;
+		int destWidth;
+		int destHeight;
+		Image::Filter filter;
+		int bpp;
+		int rowSize;
+		int features;
+		int* xStarts;
+		int* xCounts;
+		short* xWeights;
+		int xMaxCount;
+		int* yStarts;
+		int* yCounts;
+		short* yWeights;
+		int yMaxCount;
+		unsigned char* ring;
+		int ringSize;
+		int filledRow;
+		unsigned char** rows;
+
+		void _getNearestRow(int y, unsigned char* output)
+		{
+			unsigned char* srcRow = &this->source.data[(int)(((long long)y * 2 + 1) * this->source.h / (this->destHeight * 2)) * this->source.pitch];
+			if (this->bpp == 4)
+			{
+				for_iter (i, 0, this->destWidth)
+				{
+					memcpy(&output[i * 4], &srcRow[this->xStarts[i]], 4);
+				}
+				return;
+			}
+			for_iter (i, 0, this->destWidth)
+			{
+				for_iter (c, 0, this->bpp)
+				{
+					output[i * this->bpp + c] = srcRow[this->xStarts[i] + c];
+				}
+			}
+		}
+
+		void _filterRow(int y, unsigned char* output)
+		{
+			unsigned char* srcRow = &this->source.data[y * this->source.pitch];
+			if (this->xWeights == NULL)
+			{
+				memcpy(output, srcRow, this->rowSize);
+				return;
+			}
+#ifdef _SIMD_SSE
+			if (this->bpp == 4 && (this->features & SIMD_SSE2) != 0)
+			{
+				_resampleRow4Sse2(srcRow, output, this->destWidth, this->xStarts, this->xCounts, this->xWeights, this->xMaxCount);
+				return;
+			}
+#endif
+			_resampleRowScalar(srcRow, output, this->destWidth, this->bpp, this->xStarts, this->xCounts, this->xWeights, this->xMaxCount);
+		}
+
+		unsigned char* _getFilteredRow(int y)
+		{
+			if (this->ring == NULL) // source rows can be used directly
+			{
+				return &this->source.data[y * this->source.pitch];
+			}
+			while (this->filledRow < y)
+			{
+				++this->filledRow;
+				this->_filterRow(this->filledRow, &this->ring[(this->filledRow % this->ringSize) * this->rowSize]);
+			}
+			return &this->ring[(y % this->ringSize) * this->rowSize];
+		}
+
+	};
+
+	bool Image::_resample(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, Filter filter)
+	{
+		int bpp = dest.getBpp();
+		if (src.getBpp() != bpp || (bpp != 1 && bpp != 3 && bpp != 4))
+		{
+			return false;
+		}
+		Resampler resampler(src.getSubView(sx, sy, sw, sh), dw, dh, filter);
+		for_iter (j, 0, dh)
+		{
+			resampler.getRow(j, dest.getPixelData(dx, dy + j));
+		}
+		return true;
+	}
+
+	bool Image::_resampleBlit(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, const View& src, const View& dest, Filter filter, unsigned char alpha)
+	{
+		int srcBpp = src.getBpp();
+		if (srcBpp != 1 && srcBpp != 3 && srcBpp != 4)
+		{
+			return false;
+		}
+		Resampler resampler(src.getSubView(sx, sy, sw, sh), dw, dh, filter);
+		// every stretched row is blended right away while it's still in the cache
+		View row(new unsigned char[dw * srcBpp], dw, 1, src.format);
+		bool result = true;
+		for_iter (j, 0, dh)
+		{
+			resampler.getRow(j, row.data);
+			if (srcBpp == 1)
+			{
+				// blit() takes care of alpha maps on premultiplied destinations
+				result = (Image::isPremultipliedFormat(dest.format) ? Image::blit(0, 0, dw, 1, dx, dy + j, row, dest, alpha) :
+					Image::_blitFrom1Bpp(0, 0, dw, 1, dx, dy + j, row, dest, alpha));
+			}
+			else if (srcBpp == 3)
+			{
+				result = Image::_blitFrom3Bpp(0, 0, dw, 1, dx, dy + j, row, dest, alpha);
+			}
+			else
+			{
+				result = Image::_blitFrom4Bpp(0, 0, dw, 1, dx, dy + j, row, dest, alpha);
+			}
+			if (!result)
+			{
+				break;
+			}
+		}
+		delete [] row.data;
+		return result;
+	}
+
+}
@@ -0,0 +1,654 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+
+#include <hltypes/hltypesUtil.h>
+
+#include "Image.h"
+#include "ImageSimd.h"
+
+#ifdef _SIMD_SSE
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#define CHECK_PREMULTIPLIED_FORMAT(format) \
+	((format) == FORMAT_RGBA_PREMULTIPLIED || (format) == FORMAT_BGRA_PREMULTIPLIED)
+#define CHECK_ALPHA_FORMAT(format) \
+	((format) == FORMAT_RGBA || (format) == FORMAT_ARGB || (format) == FORMAT_BGRA || (format) == FORMAT_ABGR || CHECK_PREMULTIPLIED_FORMAT(format))
+
+namespace april
+{
+	static int _simdFeatures = -1;
+
+	int _getSimdFeatures()
+	{
+		if (_simdFeatures < 0)
+		{
+			int features = 0;
+#ifdef _SIMD_SSE
+			unsigned int ecx = 0;
+			unsigned int edx = 0;
+#ifdef _MSC_VER
+			int info[4] = {0, 0, 0, 0};
+			__cpuid(info, 1);
+			ecx = (unsigned int)info[2];
+			edx = (unsigned int)info[3];
+#else
+			unsigned int eax = 0;
+			unsigned int ebx = 0;
+			if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+			{
+				ecx = edx = 0;
+			}
+#endif
+			if ((edx & (1 << 26)) != 0)
+			{
+				features |= SIMD_SSE2;
+				if ((ecx & (1 << 9)) != 0)
+				{
+					features |= SIMD_SSSE3;
+				}
+			}
+#elif defined(_SIMD_NEON)
+			// NEON code is only compiled when the target guarantees its availability
+			features |= SIMD_NEON;
+#endif
+			_simdFeatures = features;
+		}
+		return _simdFeatures;
+	}
+
+	/// @param[in] channels Source channel index for every destination channel, -1 means that the channel is filled with 255.
+	static void _convertScalar(unsigned char* src, int srcBpp, unsigned char* dest, int destBpp, int* channels, int count)
+	{
+		int i = 0;
+		int j = 0;
+		for_iter (k, 0, count)
+		{
+			i = k * srcBpp;
+			j = k * destBpp;
+			for_iter (c, 0, destBpp)
+			{
+				dest[j + c] = (channels[c] >= 0 ? src[i + channels[c]] : 255);
+			}
+		}
+	}
+
+#ifdef _SIMD_SSE
+	// any combination of 1, 3 and 4 BPP, pshufb does all the work
+	_SSSE3_FUNCTION static int _convertSsse3(unsigned char* src, int srcBpp, unsigned char* dest, int destBpp, int* channels, int count)
+	{
+		int step = 16 / hmax(srcBpp, destBpp);
+		int used = step * destBpp;
+		unsigned char shuffle[16];
+		unsigned char fill[16];
+		int c = 0;
+		for_iter (j, 0, 16)
+		{
+			c = channels[j % destBpp];
+			shuffle[j] = (j < used && c >= 0 ? (unsigned char)((j / destBpp) * srcBpp + c) : 0x80);
+			fill[j] = (j < used && c < 0 ? 0xFF : 0);
+		}
+		__m128i mask = _mm_loadu_si128((__m128i*)shuffle);
+		__m128i filler = _mm_loadu_si128((__m128i*)fill);
+		// full 16 byte loads and stores must stay within both buffers, bytes stored past "used" are overwritten by the next step
+		int minBpp = hmin(srcBpp, destBpp);
+		int last = count - (16 + minBpp - 1) / minBpp;
+		int i = 0;
+		for (; i <= last; i += step)
+		{
+			_mm_storeu_si128((__m128i*)&dest[i * destBpp], _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((__m128i*)&src[i * srcBpp]), mask), filler));
+		}
+		return i;
+	}
+
+	static int _convert4To4Sse2(unsigned char* src, unsigned char* dest, int* channels, int count)
+	{
+		__m128i byteMask = _mm_set1_epi32(0xFF);
+		__m128i srcShifts[4];
+		__m128i destShifts[4];
+		unsigned int fill = 0;
+		for_iter (c, 0, 4)
+		{
+			if (channels[c] >= 0)
+			{
+				srcShifts[c] = _mm_cvtsi32_si128(channels[c] * 8);
+				destShifts[c] = _mm_cvtsi32_si128(c * 8);
+			}
+			else
+			{
+				fill |= 0xFF << (c * 8);
+			}
+		}
+		__m128i filler = _mm_set1_epi32((int)fill);
+		__m128i value;
+		__m128i result;
+		int i = 0;
+		for (; i <= count - 4; i += 4)
+		{
+			value = _mm_loadu_si128((__m128i*)&src[i * 4]);
+			result = filler;
+			for_iter (c, 0, 4)
+			{
+				if (channels[c] >= 0)
+				{
+					result = _mm_or_si128(result, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(value, srcShifts[c]), byteMask), destShifts[c]));
+				}
+			}
+			_mm_storeu_si128((__m128i*)&dest[i * 4], result);
+		}
+		return i;
+	}
+
+	static int _convert1To4Sse2(unsigned char* src, unsigned char* dest, int* channels, int count)
+	{
+		unsigned int fill = 0;
+		for_iter (c, 0, 4)
+		{
+			if (channels[c] < 0)
+			{
+				fill |= 0xFF << (c * 8);
+			}
+		}
+		__m128i filler = _mm_set1_epi32((int)fill);
+		__m128i colorMask = _mm_set1_epi32((int)~fill);
+		__m128i value;
+		__m128i low;
+		__m128i high;
+		int i = 0;
+		for (; i <= count - 16; i += 16)
+		{
+			value = _mm_loadu_si128((__m128i*)&src[i]);
+			low = _mm_unpacklo_epi8(value, value);
+			high = _mm_unpackhi_epi8(value, value);
+			_mm_storeu_si128((__m128i*)&dest[i * 4], _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(low, low), colorMask), filler));
+			_mm_storeu_si128((__m128i*)&dest[i * 4 + 16], _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi16(low, low), colorMask), filler));
+			_mm_storeu_si128((__m128i*)&dest[i * 4 + 32], _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(high, high), colorMask), filler));
+			_mm_storeu_si128((__m128i*)&dest[i * 4 + 48], _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi16(high, high), colorMask), filler));
+		}
+		return i;
+	}
+
+	static int _convert4To1Sse2(unsigned char* src, unsigned char* dest, int* channels, int count)
+	{
+		__m128i byteMask = _mm_set1_epi32(0xFF);
+		__m128i shift = _mm_cvtsi32_si128(channels[0] * 8);
+		__m128i a;
+		__m128i b;
+		__m128i c;
+		__m128i d;
+		int i = 0;
+		for (; i <= count - 16; i += 16)
+		{
+			a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((__m128i*)&src[i * 4]), shift), byteMask);
+			b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((__m128i*)&src[i * 4 + 16]), shift), byteMask);
+			c = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((__m128i*)&src[i * 4 + 32]), shift), byteMask);
+			d = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((__m128i*)&src[i * 4 + 48]), shift), byteMask);
+			_mm_storeu_si128((__m128i*)&dest[i], _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+		}
+		return i;
+	}
+#endif
+
+#ifdef _SIMD_NEON
+	// any combination of 1, 3 and 4 BPP, the interleaved loads and stores do all the work
+	static int _convertNeon(unsigned char* src, int srcBpp, unsigned char* dest, int destBpp, int* channels, int count)
+	{
+		uint8x16_t full = vdupq_n_u8(255);
+		uint8x16_t in[4];
+		uint8x16x3_t in3;
+		uint8x16x4_t in4;
+		uint8x16x3_t out3;
+		uint8x16x4_t out4;
+		int i = 0;
+		for (; i <= count - 16; i += 16)
+		{
+			if (srcBpp == 1)
+			{
+				in[0] = vld1q_u8(&src[i]);
+			}
+			else if (srcBpp == 3)
+			{
+				in3 = vld3q_u8(&src[i * 3]);
+				in[0] = in3.val[0];
+				in[1] = in3.val[1];
+				in[2] = in3.val[2];
+			}
+			else
+			{
+				in4 = vld4q_u8(&src[i * 4]);
+				in[0] = in4.val[0];
+				in[1] = in4.val[1];
+				in[2] = in4.val[2];
+				in[3] = in4.val[3];
+			}
+			if (destBpp == 1)
+			{
+				vst1q_u8(&dest[i], (channels[0] >= 0 ? in[channels[0]] : full));
+			}
+			else if (destBpp == 3)
+			{
+				out3.val[0] = (channels[0] >= 0 ? in[channels[0]] : full);
+				out3.val[1] = (channels[1] >= 0 ? in[channels[1]] : full);
+				out3.val[2] = (channels[2] >= 0 ? in[channels[2]] : full);
+				vst3q_u8(&dest[i * 3], out3);
+			}
+			else
+			{
+				out4.val[0] = (channels[0] >= 0 ? in[channels[0]] : full);
+				out4.val[1] = (channels[1] >= 0 ? in[channels[1]] : full);
+				out4.val[2] = (channels[2] >= 0 ? in[channels[2]] : full);
+				out4.val[3] = (channels[3] >= 0 ? in[channels[3]] : full);
+				vst4q_u8(&dest[i * 4], out4);
+			}
+		}
+		return i;
+	}
+#endif
+
+	// converts one run of pixels, returns false if there is no vector kernel for this combination
+	static bool _convertRun(unsigned char* src, int srcBpp, unsigned char* dest, int destBpp, int* channels, int count, int features)
+	{
+		int done = 0;
+#ifdef _SIMD_SSE
+		if ((features & SIMD_SSE2) != 0 && srcBpp == 1 && destBpp == 4)
+		{
+			done = _convert1To4Sse2(src, dest, channels, count);
+		}
+		else if ((features & SIMD_SSE2) != 0 && srcBpp == 4 && destBpp == 1)
+		{
+			done = _convert4To1Sse2(src, dest, channels, count);
+		}
+		else if ((features & SIMD_SSSE3) != 0)
+		{
+			done = _convertSsse3(src, srcBpp, dest, destBpp, channels, count);
+		}
+		else if ((features & SIMD_SSE2) != 0 && srcBpp == 4 && destBpp == 4)
+		{
+			done = _convert4To4Sse2(src, dest, channels, count);
+		}
+		else
+		{
+			return false;
+		}
+#elif defined(_SIMD_NEON)
+		done = _convertNeon(src, srcBpp, dest, destBpp, channels, count);
+#endif
+		_convertScalar(&src[done * srcBpp], srcBpp, &dest[done * destBpp], destBpp, channels, count - done);
+		return true;
+	}
+
+	bool Image::_convertSimd(const View& src, const View& dest)
+	{
+		int features = _getSimdFeatures();
+		if (features == 0 || src.format == dest.format || src.format == FORMAT_PALETTE || dest.format == FORMAT_PALETTE)
+		{
+			return false;
+		}
+		int srcBpp = src.getBpp();
+		int destBpp = dest.getBpp();
+		if ((srcBpp != 1 && srcBpp != 3 && srcBpp != 4) || (destBpp != 1 && destBpp != 3 && destBpp != 4))
+		{
+			return false;
+		}
+		// same channel semantics as the scalar conversions: red is used as main component for 1 BPP,
+		// alpha is copied only if both formats have it and is set to 255 otherwise
+		int channels[4] = {-1, -1, -1, -1};
+		int sr = 0;
+		int sg = 0;
+		int sb = 0;
+		int sa = 0;
+		Image::_getFormatIndices(src.format, &sr, &sg, &sb, &sa);
+		if (destBpp == 1)
+		{
+			channels[0] = sr;
+		}
+		else
+		{
+			int dr = 0;
+			int dg = 0;
+			int db = 0;
+			int da = 0;
+			Image::_getFormatIndices(dest.format, &dr, &dg, &db, &da);
+			channels[dr] = sr;
+			channels[dg] = sg;
+			channels[db] = sb;
+			if (destBpp == 4 && srcBpp == 4 && CHECK_ALPHA_FORMAT(src.format) && CHECK_ALPHA_FORMAT(dest.format))
+			{
+				channels[da] = sa;
+			}
+		}
+		// tightly packed data is processed as one long row
+		if (src.isContiguous() && dest.isContiguous())
+		{
+			return _convertRun(src.data, srcBpp, dest.data, destBpp, channels, src.w * src.h, features);
+		}
+		for_iter (j, 0, src.h)
+		{
+			if (!_convertRun(&src.data[j * src.pitch], srcBpp, &dest.data[j * dest.pitch], destBpp, channels, src.w, features))
+			{
+				return false; // only possible on the first row since the kernel choice doesn't depend on the row
+			}
+		}
+		return true;
+	}
+
+#ifdef _SIMD_SSE
+	struct BlendSse2
+	{
+		__m128i alphaMask; // 0xFF in the destination's alpha channel of every pixel
+		__m128i alphaLanes; // the same for pixels widened to 16 bits
+		__m128i transparentMask; // bytes that have to be 0 in a fully transparent source pixel
+		__m128i alpha;
+		bool alphaFirst;
+		bool globalAlpha;
+		bool destAlpha;
+		bool premultiplied;
+	};
+
+	// same as _div255() in Image.cpp, exact for all values up to 255 * 255
+	static inline __m128i _div255Sse2(__m128i value)
+	{
+		return _mm_mulhi_epu16(_mm_add_epi16(value, _mm_set1_epi16(128)), _mm_set1_epi16(257));
+	}
+
+	// copies the alpha value of 2 pixels widened to 16 bits into all of their channels
+	static inline __m128i _broadcastAlphaSse2(__m128i pixels, bool alphaFirst)
+	{
+		if (alphaFirst)
+		{
+			return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(0, 0, 0, 0)), _MM_SHUFFLE(0, 0, 0, 0));
+		}
+		return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	// blends 2 pixels widened to 16 bits
+	static inline __m128i _blend2Sse2(__m128i src, __m128i dest, const BlendSse2& blend)
+	{
+		__m128i a0 = _broadcastAlphaSse2(src, blend.alphaFirst);
+		if (blend.globalAlpha)
+		{
+			a0 = _div255Sse2(_mm_mullo_epi16(a0, blend.alpha));
+		}
+		if (blend.premultiplied)
+		{
+			// every channel, including alpha, is src + dest * (255 - a0) / 255, packing saturates like the scalar code
+			if (blend.globalAlpha)
+			{
+				src = _div255Sse2(_mm_mullo_epi16(src, blend.alpha));
+			}
+			return _mm_add_epi16(src, _div255Sse2(_mm_mullo_epi16(dest, _mm_sub_epi16(_mm_set1_epi16(255), a0))));
+		}
+		// with 255 in the source alpha channel the alpha result is a0 + da * (255 - a0) / 255
+		src = _mm_or_si128(src, blend.alphaLanes);
+		return _div255Sse2(_mm_add_epi16(_mm_mullo_epi16(src, a0), _mm_mullo_epi16(dest, _mm_sub_epi16(_mm_set1_epi16(255), a0))));
+	}
+
+	// blends 4 pixels that already use the destination's channel order
+	static inline void _blend4Sse2(__m128i src, unsigned char* dest, const BlendSse2& blend)
+	{
+		__m128i zero = _mm_setzero_si128();
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(src, blend.transparentMask), zero)) == 0xFFFF) // fully transparent
+		{
+			return;
+		}
+		__m128i destValue = _mm_loadu_si128((__m128i*)dest);
+		__m128i result = src;
+		if (blend.globalAlpha || _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(src, blend.alphaMask), blend.alphaMask)) != 0xFFFF) // not fully opaque
+		{
+			result = _mm_packus_epi16(_blend2Sse2(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(destValue, zero), blend),
+				_blend2Sse2(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(destValue, zero), blend));
+		}
+		if (!blend.destAlpha) // the X channel stays untouched
+		{
+			result = _mm_or_si128(_mm_andnot_si128(blend.alphaMask, result), _mm_and_si128(destValue, blend.alphaMask));
+		}
+		_mm_storeu_si128((__m128i*)dest, result);
+	}
+
+	// source and destination have the same channel order
+	static int _blit4To4Sse2(unsigned char* src, unsigned char* dest, int count, const BlendSse2& blend)
+	{
+		int i = 0;
+		for (; i <= count - 4; i += 4)
+		{
+			_blend4Sse2(_mm_loadu_si128((__m128i*)&src[i * 4]), &dest[i * 4], blend);
+		}
+		return i;
+	}
+
+	_SSSE3_FUNCTION static int _blit4To4Ssse3(unsigned char* src, unsigned char* dest, int count, __m128i shuffle, const BlendSse2& blend)
+	{
+		int i = 0;
+		for (; i <= count - 4; i += 4)
+		{
+			_blend4Sse2(_mm_shuffle_epi8(_mm_loadu_si128((__m128i*)&src[i * 4]), shuffle), &dest[i * 4], blend);
+		}
+		return i;
+	}
+#endif
+
+#ifdef _SIMD_NEON
+	// same as _div255() in Image.cpp, exact for all values up to 255 * 255
+	static inline uint8x8_t _div255Neon(uint16x8_t value)
+	{
+		return vrshrn_n_u16(vrsraq_n_u16(value, value, 8), 8);
+	}
+
+	static inline uint8x16_t _blendChannelNeon(uint8x16_t src, uint8x16_t dest, uint8x16_t a0, uint8x16_t a1)
+	{
+		uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(src), vget_low_u8(a0)), vget_low_u8(dest), vget_low_u8(a1));
+		uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(src), vget_high_u8(a0)), vget_high_u8(dest), vget_high_u8(a1));
+		return vcombine_u8(_div255Neon(low), _div255Neon(high));
+	}
+
+	/// @param[in] channels Source channel index for every destination channel, the destination's alpha (or X) channel gets the source alpha.
+	static int _blit4To4Neon(unsigned char* src, unsigned char* dest, int count, int* channels, int da, bool destAlpha, bool premultiplied, unsigned char alpha)
+	{
+		uint8x16_t zero = vdupq_n_u8(0);
+		uint8x16_t full = vdupq_n_u8(255);
+		uint8x8_t globalAlpha = vdup_n_u8(alpha);
+		uint8x16x4_t in;
+		uint8x16x4_t out;
+		uint8x16_t a0;
+		uint8x16_t a1;
+		uint8x16_t value;
+		uint64x2_t check;
+		int i = 0;
+		for (; i <= count - 16; i += 16)
+		{
+			in = vld4q_u8(&src[i * 4]);
+			a0 = in.val[channels[da]];
+			// premultiplied pixels are only fully transparent if all of their channels are 0
+			check = vreinterpretq_u64_u8(premultiplied ? vorrq_u8(vorrq_u8(in.val[0], in.val[1]), vorrq_u8(in.val[2], in.val[3])) : a0);
+			if ((vgetq_lane_u64(check, 0) | vgetq_lane_u64(check, 1)) == 0) // fully transparent
+			{
+				continue;
+			}
+			out = vld4q_u8(&dest[i * 4]);
+			check = vreinterpretq_u64_u8(vmvnq_u8(a0));
+			if (alpha == 255 && (vgetq_lane_u64(check, 0) | vgetq_lane_u64(check, 1)) == 0) // fully opaque
+			{
+				for_iter (c, 0, 4)
+				{
+					if (c != da || destAlpha)
+					{
+						out.val[c] = in.val[channels[c]];
+					}
+				}
+			}
+			else
+			{
+				if (alpha < 255)
+				{
+					a0 = vcombine_u8(_div255Neon(vmull_u8(vget_low_u8(a0), globalAlpha)), _div255Neon(vmull_u8(vget_high_u8(a0), globalAlpha)));
+				}
+				a1 = vsubq_u8(full, a0);
+				for_iter (c, 0, 4)
+				{
+					value = in.val[channels[c]];
+					if (premultiplied)
+					{
+						if (c != da || destAlpha)
+						{
+							if (alpha < 255)
+							{
+								value = vcombine_u8(_div255Neon(vmull_u8(vget_low_u8(value), globalAlpha)), _div255Neon(vmull_u8(vget_high_u8(value), globalAlpha)));
+							}
+							out.val[c] = vqaddq_u8(value, _blendChannelNeon(zero, out.val[c], zero, a1));
+						}
+					}
+					else if (c != da)
+					{
+						out.val[c] = _blendChannelNeon(value, out.val[c], a0, a1);
+					}
+					else if (destAlpha)
+					{
+						out.val[c] = vaddq_u8(a0, _blendChannelNeon(zero, out.val[c], zero, a1));
+					}
+				}
+			}
+			vst4q_u8(&dest[i * 4], out);
+		}
+		return i;
+	}
+#endif
+
+#ifdef _SIMD_SSE
+	static int _premultiplySse2(unsigned char* data, int count, bool alphaFirst)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i alphaMask = _mm_set1_epi32(alphaFirst ? 0xFF : 0xFF << 24);
+		__m128i value;
+		__m128i low;
+		__m128i high;
+		int i = 0;
+		for (; i <= count - 4; i += 4)
+		{
+			value = _mm_loadu_si128((__m128i*)&data[i * 4]);
+			low = _mm_unpacklo_epi8(value, zero);
+			high = _mm_unpackhi_epi8(value, zero);
+			low = _div255Sse2(_mm_mullo_epi16(low, _broadcastAlphaSse2(low, alphaFirst)));
+			high = _div255Sse2(_mm_mullo_epi16(high, _broadcastAlphaSse2(high, alphaFirst)));
+			// alpha * alpha / 255 isn't alpha so the original one is put back
+			_mm_storeu_si128((__m128i*)&data[i * 4], _mm_or_si128(_mm_andnot_si128(alphaMask, _mm_packus_epi16(low, high)), _mm_and_si128(value, alphaMask)));
+		}
+		return i;
+	}
+#endif
+
+#ifdef _SIMD_NEON
+	static int _premultiplyNeon(unsigned char* data, int count, int a)
+	{
+		uint8x16x4_t value;
+		int i = 0;
+		for (; i <= count - 16; i += 16)
+		{
+			value = vld4q_u8(&data[i * 4]);
+			for_iter (c, 0, 4)
+			{
+				if (c != a)
+				{
+					value.val[c] = vcombine_u8(_div255Neon(vmull_u8(vget_low_u8(value.val[c]), vget_low_u8(value.val[a]))),
+						_div255Neon(vmull_u8(vget_high_u8(value.val[c]), vget_high_u8(value.val[a]))));
+				}
+			}
+			vst4q_u8(&data[i * 4], value);
+		}
+		return i;
+	}
+#endif
+
+	int Image::_premultiplySimd(const View& view)
+	{
+		int features = _getSimdFeatures();
+		if (features == 0 || view.getBpp() != 4)
+		{
+			return 0;
+		}
+		int a = 0;
+		Image::_getFormatIndices(view.format, NULL, NULL, NULL, &a);
+		int done = 0;
+		for_iter (j, 0, view.h)
+		{
+#ifdef _SIMD_SSE
+			done = _premultiplySse2(view.getPixelData(0, j), view.w, (a == 0));
+#elif defined(_SIMD_NEON)
+			done = _premultiplyNeon(view.getPixelData(0, j), view.w, a);
+#endif
+		}
+		return done;
+	}
+
+	int Image::_blitSimd(int sx, int sy, int sw, int sh, int dx, int dy, const View& src, const View& dest, unsigned char alpha)
+	{
+		int features = _getSimdFeatures();
+		if (features == 0 || src.getBpp() != 4 || dest.getBpp() != 4)
+		{
+			return 0;
+		}
+		// the destination's alpha channel (or X channel) receives the source alpha
+		int sr = 0;
+		int sg = 0;
+		int sb = 0;
+		int sa = 0;
+		Image::_getFormatIndices(src.format, &sr, &sg, &sb, &sa);
+		int dr = 0;
+		int dg = 0;
+		int db = 0;
+		int da = 0;
+		Image::_getFormatIndices(dest.format, &dr, &dg, &db, &da);
+		int channels[4] = {-1, -1, -1, -1};
+		channels[dr] = sr;
+		channels[dg] = sg;
+		channels[db] = sb;
+		channels[da] = sa;
+		bool destAlpha = CHECK_ALPHA_FORMAT(dest.format);
+		bool premultiplied = CHECK_PREMULTIPLIED_FORMAT(src.format);
+		int done = 0;
+#ifdef _SIMD_SSE
+		bool reorder = (channels[0] != 0 || channels[1] != 1 || channels[2] != 2 || channels[3] != 3);
+		if ((features & SIMD_SSE2) == 0 || (reorder && (features & SIMD_SSSE3) == 0))
+		{
+			return 0;
+		}
+		BlendSse2 blend;
+		blend.alphaMask = _mm_set1_epi32(0xFF << (da * 8));
+		blend.alphaLanes = (da == 0 ? _mm_set_epi16(0, 0, 0, 255, 0, 0, 0, 255) : _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+		blend.transparentMask = (premultiplied ? _mm_set1_epi32(-1) : blend.alphaMask);
+		blend.alpha = _mm_set1_epi16(alpha);
+		blend.alphaFirst = (da == 0);
+		blend.globalAlpha = (alpha < 255);
+		blend.destAlpha = destAlpha;
+		blend.premultiplied = premultiplied;
+		unsigned char shuffle[16];
+		for_iter (j, 0, 16)
+		{
+			shuffle[j] = (unsigned char)((j / 4) * 4 + channels[j % 4]);
+		}
+		__m128i shuffleMask = _mm_loadu_si128((__m128i*)shuffle);
+#endif
+		for_iter (j, 0, sh)
+		{
+			unsigned char* srcRow = src.getPixelData(sx, sy + j);
+			unsigned char* destRow = dest.getPixelData(dx, dy + j);
+#ifdef _SIMD_SSE
+			done = (reorder ? _blit4To4Ssse3(srcRow, destRow, sw, shuffleMask, blend) : _blit4To4Sse2(srcRow, destRow, sw, blend));
+#elif defined(_SIMD_NEON)
+			done = _blit4To4Neon(srcRow, destRow, sw, channels, da, destAlpha, premultiplied, alpha);
+#endif
+		}
+		// the column count doesn't depend on the row
+		return done;
+	}
+
+}
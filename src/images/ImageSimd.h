@@ -0,0 +1,43 @@
+/// @file
+/// @author  Boris Mikic
+/// @version 3.33
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://www.opensource.org/licenses/bsd-license.php
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines internal SIMD detection used by the image processing code.
+
+#ifndef APRIL_IMAGE_SIMD_H
+#define APRIL_IMAGE_SIMD_H
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define _SIMD_SSE
+#include <emmintrin.h>
+#include <tmmintrin.h>
+// allows SSSE3 code to be compiled without enabling it for the whole project, it's only used after a runtime check
+#if defined(__GNUC__) && !defined(__SSSE3__)
+#define _SSSE3_FUNCTION __attribute__((target("ssse3")))
+#else
+#define _SSSE3_FUNCTION
+#endif
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(_M_ARM)
+#define _SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#define SIMD_SSE2 0x1
+#define SIMD_SSSE3 0x2
+#define SIMD_NEON 0x4
+
+namespace april
+{
+	/// @return Combination of the SIMD_* flags supported by the running CPU.
+	int _getSimdFeatures();
+
+}
+
+#endif
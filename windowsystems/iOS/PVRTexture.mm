@@ -323,7 +323,7 @@ namespace april
 		Image* image = Image::create(pvrtex.width, pvrtex.height, NULL, Image::FORMAT_INVALID);
 		image->data = new unsigned char[data.length];
 		memcpy(image->data, data.bytes, data.length);
-		image->format = Image::FORMAT_PALETTE;
+		image->format = Image::FORMAT_COMPRESSED;
 		image->internalFormat = pvrtex.internalFormat;
 		image->compressedSize = data.length;
 		